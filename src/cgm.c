@@ -1,6 +1,7 @@
 #include "pebble.h"
 #include "stddef.h"
 #include "string.h"
+#include "icon_atlas.h"
   
 // global window variables
 // ANYTHING THAT IS CALLED BY PEBBLE API HAS TO BE NOT STATIC
@@ -12,33 +13,104 @@
   
 Window *window_cgm = NULL;
 
-TextLayer *tophalf_layer = NULL;
-TextLayer *bg_layer = NULL;
-TextLayer *cgmtime_layer = NULL;
-TextLayer *message_layer = NULL;    // BG DELTA & MESSAGE LAYER
-TextLayer *rig_battlevel_layer = NULL;
-TextLayer *watch_battlevel_layer = NULL;
-TextLayer *t1dname_layer = NULL;
-TextLayer *time_watch_layer = NULL;
-TextLayer *date_app_layer = NULL;
-TextLayer *happymsg_layer = NULL;
-TextLayer *raw_calc_layer = NULL;
-TextLayer *raw_unfilt_layer = NULL;
-TextLayer *noise_layer = NULL;
-TextLayer *calcraw_last1_layer = NULL;
-TextLayer *calcraw_last2_layer = NULL;
-TextLayer *calcraw_last3_layer = NULL;
-
-BitmapLayer *icon_layer = NULL;
-BitmapLayer *cgmicon_layer = NULL;
-BitmapLayer *perfectbg_layer = NULL;
-
-GBitmap *icon_bitmap = NULL;
-GBitmap *cgmicon_bitmap = NULL;
-GBitmap *specialvalue_bitmap = NULL;
-GBitmap *perfectbg_bitmap = NULL;
-
-InverterLayer *inv_rig_battlevel_layer = NULL;
+// face elements, in drawing order, bottom first; each one is a layer, or a region of the canvas in canvas mode
+enum FaceElement {
+  FACE_TOPHALF = 0,
+  FACE_HAPPYMSG = 1,
+  FACE_MESSAGE = 2,             // BG DELTA & MESSAGE
+  FACE_ICON = 3,                // ARROW OR SPECIAL VALUE
+  FACE_RIG_BATTLEVEL = 4,
+  FACE_INV_RIG_BATTLEVEL = 5,
+  FACE_BG = 6,
+  FACE_CALCRAW_LAST1 = 7,
+  FACE_CALCRAW_LAST2 = 8,
+  FACE_CALCRAW_LAST3 = 9,
+  FACE_PERFECTBG = 10,
+  FACE_CGMICON = 11,
+  FACE_CGMTIME = 12,
+  FACE_T1DNAME = 13,
+  FACE_WATCH_BATTLEVEL = 14,
+  FACE_SPARKLINE = 15,
+  FACE_TIME_WATCH = 16,
+  FACE_DATE_APP = 17,
+  FACE_RAW_CALC = 18,
+  FACE_NOISE = 19,
+  FACE_RAW_UNFILT = 20,
+  FACE_ELEMENT_COUNT = 21
+};
+
+enum FaceKind {
+  FACE_KIND_TEXT = 0,
+  FACE_KIND_BITMAP = 1,
+  FACE_KIND_INVERTER = 2,
+  FACE_KIND_SPARKLINE = 3
+};
+
+// alignment is a GTextAlignment for text, a GAlign for bitmaps; font and text color are for text only
+// optional is 111 (true) for raw data and animations; their layers only exist while they have something to show
+typedef struct {
+  uint8_t kind;
+  GRect frame;
+  const char *font_key;
+  GColor text_color;
+  GColor background_color;
+  uint8_t alignment;
+  uint8_t optional;
+} FaceLayout;
+
+static const FaceLayout FACE_LAYOUT[FACE_ELEMENT_COUNT] = {
+  { FACE_KIND_TEXT, {{0, 0}, {144, 83}}, FONT_KEY_GOTHIC_28_BOLD, GColorBlack, GColorWhite, GTextAlignmentCenter, 100 },      // TOPHALF WHITE
+  { FACE_KIND_TEXT, {{-10, 33}, {144, 55}}, FONT_KEY_GOTHIC_24_BOLD, GColorBlack, GColorClear, GTextAlignmentCenter, 111 },   // HAPPY MSG
+  { FACE_KIND_TEXT, {{0, 33}, {144, 55}}, FONT_KEY_GOTHIC_28_BOLD, GColorBlack, GColorClear, GTextAlignmentCenter, 100 },     // DELTA BG / MESSAGE
+  { FACE_KIND_BITMAP, {{78, -2}, {78, 50}}, NULL, GColorBlack, GColorClear, GAlignCenter, 100 },                              // ICON, ARROW OR SPECIAL VALUE
+  { FACE_KIND_TEXT, {{70, 61}, {72, 22}}, FONT_KEY_GOTHIC_18_BOLD, GColorBlack, GColorClear, GTextAlignmentRight, 100 },      // RIG BATTERY LEVEL
+  { FACE_KIND_INVERTER, {{112, 66}, {30, 15}}, NULL, GColorBlack, GColorClear, 0, 100 },                                      // INVERTER BATTERY
+  { FACE_KIND_TEXT, {{0, -5}, {95, 47}}, FONT_KEY_BITHAM_42_BOLD, GColorBlack, GColorClear, GTextAlignmentCenter, 100 },      // BG
+  { FACE_KIND_TEXT, {{0, -7}, {40, 25}}, FONT_KEY_GOTHIC_24_BOLD, GColorBlack, GColorClear, GTextAlignmentLeft, 111 },        // CALCULATED RAW - LAST VALUE (1)
+  { FACE_KIND_TEXT, {{32, 3}, {40, 25}}, FONT_KEY_GOTHIC_24_BOLD, GColorBlack, GColorClear, GTextAlignmentLeft, 111 },        // CALCULATED RAW - 2ND LAST VALUE (2)
+  { FACE_KIND_TEXT, {{63, 16}, {40, 25}}, FONT_KEY_GOTHIC_24_BOLD, GColorBlack, GColorClear, GTextAlignmentLeft, 111 },       // CALCULATED RAW - 3RD LAST VALUE (3)
+  { FACE_KIND_BITMAP, {{0, -7}, {95, 47}}, NULL, GColorBlack, GColorClear, GAlignTopLeft, 111 },                              // PERFECT BG
+  { FACE_KIND_BITMAP, {{0, 63}, {40, 19}}, NULL, GColorBlack, GColorWhite, GAlignLeft, 100 },                                 // CGM TIME AGO ICON
+  { FACE_KIND_TEXT, {{26, 56}, {50, 24}}, FONT_KEY_GOTHIC_24_BOLD, GColorBlack, GColorClear, GTextAlignmentLeft, 100 },       // CGM TIME AGO READING
+  { FACE_KIND_TEXT, {{2, 140}, {69, 28}}, FONT_KEY_GOTHIC_24_BOLD, GColorWhite, GColorClear, GTextAlignmentLeft, 100 },       // T1D NAME
+  { FACE_KIND_TEXT, {{71, 145}, {72, 22}}, FONT_KEY_GOTHIC_18_BOLD, GColorWhite, GColorBlack, GTextAlignmentRight, 100 },     // WATCH BATTERY LEVEL
+  { FACE_KIND_SPARKLINE, {{0, 104}, {144, 10}}, NULL, GColorWhite, GColorClear, 0, 100 },                                     // SPARKLINE, UNDER THE TIME
+  { FACE_KIND_TEXT, {{0, 102}, {144, 44}}, FONT_KEY_BITHAM_42_BOLD, GColorWhite, GColorClear, GTextAlignmentCenter, 100 },    // TIME; CURRENT ACTUAL TIME FROM WATCH
+  { FACE_KIND_TEXT, {{39, 80}, {72, 28}}, FONT_KEY_GOTHIC_28_BOLD, GColorWhite, GColorClear, GTextAlignmentCenter, 100 },     // DATE
+  { FACE_KIND_TEXT, {{0, 76}, {40, 25}}, FONT_KEY_GOTHIC_24_BOLD, GColorWhite, GColorClear, GTextAlignmentLeft, 111 },        // RAW CALCULATED
+  { FACE_KIND_TEXT, {{85, 76}, {58, 27}}, FONT_KEY_GOTHIC_24_BOLD, GColorWhite, GColorClear, GTextAlignmentRight, 100 },      // NOISE
+  { FACE_KIND_TEXT, {{0, 92}, {40, 25}}, FONT_KEY_GOTHIC_24_BOLD, GColorWhite, GColorClear, GTextAlignmentLeft, 111 }         // RAW UNFILT
+};
+
+// what the face shows; every text and icon change goes through here, and the canvas draws only from this
+// text is the pointer last set and a hash of it, so setting the same text again doesn't mark anything dirty
+// hidden is 111 (true) for a hidden element
+typedef struct {
+  const char *text[FACE_ELEMENT_COUNT];
+  uint32_t text_hash[FACE_ELEMENT_COUNT];
+  GBitmap *bitmap[FACE_ELEMENT_COUNT];
+  uint8_t hidden[FACE_ELEMENT_COUNT];
+} FaceViewModel;
+
+static FaceViewModel face_view_cgm;
+
+// layer mode; one layer per element, the typed pointer for text and bitmap elements
+// face_root_layer_cgm is the window layer they go in, NULL when there is no window
+static Layer *face_root_layer_cgm = NULL;
+static Layer *face_layers_cgm[FACE_ELEMENT_COUNT];
+static TextLayer *face_text_layers_cgm[FACE_ELEMENT_COUNT];
+static BitmapLayer *face_bitmap_layers_cgm[FACE_ELEMENT_COUNT];
+static InverterLayer *face_inverter_layer_cgm = NULL;
+
+// canvas mode; one layer draws every element except the inverter, which has to invert what is under it
+static Layer *face_canvas_layer_cgm = NULL;
+static GFont face_fonts_cgm[FACE_ELEMENT_COUNT];
+
+// icon atlas and cache; the atlas is decoded once at window load and every icon
+// is a sub bitmap of it, created on first use and kept until window unload
+// the face view model only tracks which cached icon each element is showing
+static GBitmap *icon_atlas_bitmap = NULL;
+static GBitmap *icon_cache_cgm[ICON_ATLAS_COUNT];
 
 PropertyAnimation *perfectbg_animation = NULL;
 PropertyAnimation *happymsg_animation = NULL;
@@ -46,27 +118,53 @@ PropertyAnimation *happymsg_animation = NULL;
 static char time_watch_text[] = "00:00";
 static char date_app_text[] = "Wed 13 ";
 
-// variables for AppSync
-AppSync sync_cgm;
+// variables for app message errors
 uint8_t AppSyncErrAlert = 100;
-// CGM message is 110 bytes
-// Pebble needs additional 62 Bytes?!? Pad with additional 60 bytes
-static uint8_t sync_buffer_cgm[212];
 
 // variables for timers and time
-AppTimer *timer_cgm = NULL;
-AppTimer *BT_timer = NULL;
+// the fetch, bluetooth and retry timers share one AppTimer; see schedule_timer_cgm
+enum WatchTimer {
+  WATCH_TIMER_FETCH = 0,
+  WATCH_TIMER_BT = 1,
+  WATCH_TIMER_RETRY = 2,
+  WATCH_TIMER_COUNT = 3
+};
+
+// slack_ms is how early the timer may fire, so it can share a wakeup with another timer or the minute tick
+typedef struct {
+  uint32_t deadline_ms;
+  uint32_t slack_ms;
+  uint8_t armed;
+} WatchTimerSlot;
+
+static WatchTimerSlot watch_timers_cgm[WATCH_TIMER_COUNT];
+static AppTimer *wheel_timer_cgm = NULL;
+static uint32_t wheel_deadline_ms = 0;
 time_t cgm_time_now = 0;
 time_t app_time_now = 0;
 int timeformat = 0;
 
 // global variable for bluetooth connection
+// cached; only the bluetooth handler changes it, everything else reads it instead of a peek
 bool bluetooth_connected_cgm = true;
 
-// global variables for sync tuple functions
-char current_icon[2] = {0};
+// bluetooth connection stats; a flap is a disconnect that came back before the alert went off
+// recent_flaps stretches the alert wait, and is cleared by a connection that stays up
+typedef struct {
+  time_t changed_time;
+  uint32_t last_up_secs;
+  uint32_t last_down_secs;
+  uint16_t disconnects;
+  uint16_t flaps;
+  uint8_t recent_flaps;
+} BTConnStats;
+
+static BTConnStats bt_stats_cgm = {0};
+
+// global variables for message functions
+uint8_t current_icon = 10;
 char last_bg[6] = {0};
-char last_battlevel[4] = {0};
+uint8_t last_battlevel = 255;
 
 uint32_t current_cgm_time = 0;
 uint32_t stored_cgm_time = 0;
@@ -80,22 +178,84 @@ int cgm_timeago_diff = 0;
 uint8_t ClearedOutage = 100;
 uint8_t ClearedBTOutage = 100;
 
+// BG values are fixed point and carry their units; MG/DL, or MMOL X10 so the last digit is the decimal
+// parsed once when the message is decoded, everything after that is integer compares
+enum BgUnits {
+  BG_UNITS_MGDL = 0,
+  BG_UNITS_MMOL = 1,
+  BG_UNITS_COUNT = 2
+};
+
+typedef struct {
+  int16_t value;
+  uint8_t units;
+} Glucose;
+
+// per units; delta label, what a delta too big to trust shows, and mg/dL per unit X1000 for conversions
+typedef struct {
+  const char *delta_label;
+  const char *delta_zero_text;
+  int16_t delta_max;
+  uint16_t mgdl_per_unit_x1000;
+} GlucoseUnitsInfo;
+
+static const GlucoseUnitsInfo GLUCOSE_UNITS[BG_UNITS_COUNT] = {
+  { " mg/dL", "0", 100, 1000 },    // BG_UNITS_MGDL
+  { " mmol", "0.0", 55, 1802 }     // BG_UNITS_MMOL; 18.0182 mg/dL per mmol
+};
+
+// what the delta line shows; set when the message is committed
+enum DeltaStatus {
+  DELTA_STATUS_NONE = 0,    // nothing yet, no message
+  DELTA_STATUS_VALUE = 1,   // current_bg_delta
+  DELTA_STATUS_ERR = 2,     // phone couldn't compute a delta
+  DELTA_STATUS_LOAD = 3,    // loading
+  DELTA_STATUS_NOEP = 4,    // no endpoint
+  DELTA_STATUS_PRSS = 5,    // compression low
+  DELTA_STATUS_OFF = 6      // data offline
+};
+
 uint32_t current_app_time = 0;
-char current_bg_delta[10] = {0};
+uint8_t current_delta_status = DELTA_STATUS_NONE;
+Glucose current_bg_delta = { 0, BG_UNITS_MGDL };
 char last_calc_raw[6] = {0};
 char last_raw_unfilt[6] = {0};
 uint8_t current_noise_value = 0;
 char last_calc_raw1[6] = {0};
 char last_calc_raw2[6] = {0};
 char last_calc_raw3[6] = {0};
-int current_bg = 0;
-int current_calc_raw = 0;
-int current_calc_raw1 = 0;
-uint8_t currentBG_isMMOL = 100;
-int converted_bgDelta = 0;
-char current_values[25] = {0};
+Glucose current_bg = { 0, BG_UNITS_MGDL };
+Glucose current_calc_raw = { 0, BG_UNITS_MGDL };
+char current_t1dname[10] = {0};
 uint8_t HaveCalcRaw = 100;
 
+// config version of the settings we have; 0 = never got settings
+// sent with every request so the phone only sends settings again when they changed
+uint16_t current_cfg_version = 0;
+
+// global history of recent readings; ring buffer, newest at history_head_cgm - 1
+// bg and calc_raw are the same integers as the message (MMOL X10), delta_min is minutes since the reading before
+#define HISTORY_SIZE 36
+typedef struct {
+  int16_t bg;
+  int16_t calc_raw;
+  uint8_t delta_min;
+  uint8_t arrow : 4;
+  uint8_t noise : 4;
+} HistoryEntry;
+
+static HistoryEntry history_cgm[HISTORY_SIZE];
+static uint8_t history_head_cgm = 0;
+static uint8_t history_count_cgm = 0;
+static uint32_t history_last_time_cgm = 0;
+static uint8_t history_units_cgm = BG_UNITS_MGDL;
+
+// cached sparkline points, one per 5 minute slot, slot 0 is the newest; only the new slot is computed per reading
+#define SPARKLINE_EMPTY 0xFF
+static uint8_t sparkline_y_cgm[HISTORY_SIZE];
+static uint8_t sparkline_low_y_cgm = SPARKLINE_EMPTY;
+static uint8_t sparkline_high_y_cgm = SPARKLINE_EMPTY;
+
 // global BG snooze timer
 static uint8_t lastAlertTime = 0;
 
@@ -112,10 +272,43 @@ static uint8_t high_overwrite = 100;
 static uint8_t midhigh_overwrite = 100;
 static uint8_t bighigh_overwrite = 100;
 
+// AppMessageResult codes are single bits; app message errors are counted per bit
+#define APPMSG_RESULT_BITS 16
+
+// global performance counters; only logged if TurnOnPerfStats is set
+// cpu_ms is the time spent decoding and committing messages, draws are text and bitmap updates
+typedef struct {
+  uint16_t messages;
+  uint32_t cpu_ms;
+  uint16_t bitmap_creates;
+  uint16_t bitmap_destroys;
+  uint16_t text_draws;
+  uint16_t text_draws_skipped;
+  uint16_t bitmap_draws;
+  uint16_t bitmap_draws_skipped;
+  uint16_t icon_cache_hits;
+  uint16_t icon_cache_misses;
+  uint16_t fetch_requests;
+  uint16_t fetch_new_readings;
+  uint16_t timer_wakeups;
+  uint16_t timer_fires;
+  uint16_t face_layer_creates;
+  uint16_t face_layer_destroys;
+  uint16_t appmsg_errors[APPMSG_RESULT_BITS];
+} PerfStats;
+
+static PerfStats perf_stats_cgm = {0};
+
 // global retries counters for timeout problems
 static uint8_t appsyncandmsg_retries_counter = 0;
 static uint8_t dataoffline_retries_counter = 0;
 
+// global variables for the fetch scheduler
+// latency is how long after the CGM time a new reading usually gets to us, learned from arrivals
+static uint16_t fetch_latency_est_secs = 30;
+static uint8_t fetch_pending_cgm = 100;
+static time_t fetch_start_time_cgm = 0;
+
 // global variables for vibrating in special conditions
 static uint8_t BluetoothAlert = 100;
 static uint8_t BT_timer_pop = 100;
@@ -253,17 +446,32 @@ uint8_t TurnOffStrongVibrations = 100;
 // TRY EXTENDING THIS TIME TO SEE IF IT WIL HELP SMOOTH CONNECTION
 // CGM DATA RECEIVED EVERY 60 SECONDS, GOING BEYOND THAT MAY RESULT IN MISSED DATA
 static const uint8_t BT_ALERT_WAIT_SECS = 45;
+// BT TIMER CAN GO THIS MUCH EARLY TO SHARE A WAKEUP, IN MS
+static const uint16_t BT_TIMER_SLACK_MS = 5000;
+// FLAPPING CONNECTIONS WAIT BT_ALERT_WAIT_SECS MORE PER RECENT FLAP, UP TO BT_FLAP_WAIT_STEPS_MAX MORE
+// A CONNECTION THAT STAYS UP BT_STABLE_SECS CLEARS THE RECENT FLAPS
+static const uint8_t BT_FLAP_WAIT_STEPS_MAX = 2;
+static const uint16_t BT_STABLE_SECS = 600;
 
 // Message Timer & Animate Wait Times, in Seconds
+// WATCH_MSGSEND_SECS is used until we have a reading, and while data is offline
 static const uint8_t WATCH_MSGSEND_SECS = 60;
-static const uint8_t LOADING_MSGSEND_SECS = 10;
+// once we have a reading, only ask around the time the next one is due
+// CGM sends a reading every 5 minutes; the window opens a little before we expect it to get to us
+// and polls every FETCH_WINDOW_POLL_SECS until FETCH_WINDOW_LATE_SECS after; then wait for the next one
+static const uint16_t CGM_READING_INTERVAL_SECS = 300;
+static const uint8_t FETCH_WINDOW_EARLY_SECS = 10;
+static const uint8_t FETCH_WINDOW_POLL_SECS = 15;
+static const uint8_t FETCH_WINDOW_LATE_SECS = 90;
+// first request goes out right after load; app message retries cover the phone app still starting up
+static const uint16_t LOADING_MSGSEND_MS = 500;
 static const uint8_t PERFECTBG_ANIMATE_SECS = 10;
 static const uint8_t HAPPYMSG_ANIMATE_SECS = 10;
 
 // App Sync / Message retries, for timeout / busy problems
 // Change to see if there is a temp or long term problem
-// This is approximately number of seconds, so if set to 50, timeout is at 50 seconds
-// However, this can vary widely - can be up to 6 seconds .... for 50, timeout can be up to 3 minutes
+// This is the number of errors in a row before the watch asks for a restart
+// Retries back off per error, see APPMSG_RETRY_POLICIES, so the time this takes depends on the error
 static const uint8_t APPSYNCANDMSG_RETRIES_MAX = 50;
 
 // HTML Request retries, for timeout / busy problems
@@ -271,32 +479,191 @@ static const uint8_t APPSYNCANDMSG_RETRIES_MAX = 50;
 // This is number of minutes, so if set to 11 timeout is at 11 minutes
 static const uint8_t DATAOFFLINE_RETRIES_MAX = 14;
 
+// Performance Stats
+// If you want CPU time, allocations and draw calls logged for every message, set to 111 (true)
+// Use for profiling only; logging itself costs time
+static const uint8_t TurnOnPerfStats = 100;
+
+// Canvas Mode
+// If you want the whole face drawn by one layer instead of a layer per text and icon, set to 111 (true)
+// Saves heap and layer tree work; no happy message or perfect BG animations in this mode
+static const uint8_t TurnOnCanvasMode = 100;
+
+// Message wire format; every key is one TUPLE_BYTE_ARRAY, all numbers little endian
+// BG values are integers; for MMOL the last digit is the decimal, same as the BG ranges above
+// If the layout changes, bump CGM_PROTOCOL_VERSION here and in the JS
+static const uint8_t CGM_PROTOCOL_VERSION = 3;
+
 enum CgmKey {
-	CGM_ICON_KEY = 0x0,		// TUPLE_CSTRING, MAX 2 BYTES (10)
-	CGM_BG_KEY = 0x1,		// TUPLE_CSTRING, MAX 4 BYTES (253 OR 22.2)
-	CGM_TCGM_KEY = 0x2,		// TUPLE_INT, 4 BYTES (CGM TIME)
-	CGM_TAPP_KEY = 0x3,		// TUPLE_INT, 4 BYTES (APP / PHONE TIME)
-	CGM_DLTA_KEY = 0x4,		// TUPLE_CSTRING, MAX 5 BYTES (BG DELTA, -100 or -10.0)
-	CGM_UBAT_KEY = 0x5,		// TUPLE_CSTRING, MAX 3 BYTES (UPLOADER BATTERY, 100)
-	CGM_NAME_KEY = 0x6,		// TUPLE_CSTRING, MAX 9 BYTES (Christine)
-	CGM_VALS_KEY = 0x7,   // TUPLE_CSTRING, MAX 25 BYTES (0,000,000,000,000,0,0,0,0)
-	CGM_CLRW_KEY = 0x8,   // TUPLE_CSTRING, MAX 4 BYTES (253 OR 22.2)
-	CGM_RWUF_KEY = 0x9,   // TUPLE_CSTRING, MAX 4 BYTES (253 OR 22.2)
-	CGM_NOIZ_KEY = 0xA    // TUPLE_INT, 4 BYTES (1-4)
-}; 
-// TOTAL MESSAGE DATA 4x6+2+5+3+9+25 = 68 BYTES
-// TOTAL KEY HEADER DATA (STRINGS) 4x10+2 = 42 BYTES
-// TOTAL MESSAGE 110 BYTES
+	CGM_DATA_KEY = 0x0,		// TUPLE_BYTE_ARRAY, 2 BYTES (STATUS ONLY) OR 23-32 BYTES (READING)
+	CGM_VALS_KEY = 0x1,		// TUPLE_BYTE_ARRAY, 15 BYTES (SETTINGS), ONLY SENT WHEN CONFIG CHANGES
+	CGM_CFGV_KEY = 0x2,		// TUPLE_UINT, 2 BYTES (CONFIG VERSION), WATCH TO PHONE ONLY
+	CGM_LAST_KEY = 0x3,		// TUPLE_UINT, 4 BYTES (CGM TIME OF NEWEST READING WE HAVE), WATCH TO PHONE ONLY
+	CGM_HIST_KEY = 0x4		// TUPLE_BYTE_ARRAY, 7-52 BYTES (MISSED READINGS, OLDEST FIRST, SEE CgmHistOffset)
+};
+
+// byte offsets in the data array
+enum CgmDataOffset {
+	CGM_DATA_VERSION = 0,		// UINT8, CGM_PROTOCOL_VERSION
+	CGM_DATA_STATUS = 1,		// UINT8, CgmStatus; status only messages stop here
+	CGM_DATA_FLAGS = 2,		// UINT8, CGM_FLAG_*
+	CGM_DATA_ARROW = 3,		// UINT8, ARROW CODE (0-10)
+	CGM_DATA_BG = 4,		// INT16, BG (253 OR 222)
+	CGM_DATA_DLTA = 6,		// INT16, BG DELTA (-10 OR -100), CGM_DELTA_ERR IF BAD
+	CGM_DATA_TCGM = 8,		// UINT32, CGM TIME
+	CGM_DATA_TAPP = 12,		// UINT32, APP / PHONE TIME
+	CGM_DATA_UBAT = 16,		// UINT8, UPLOADER BATTERY (0-100), CGM_UBAT_NONE OR CGM_UBAT_ERR
+	CGM_DATA_NOIZ = 17,		// UINT8, NOISE (0-6)
+	CGM_DATA_CLRW = 18,		// INT16, CALCULATED RAW (253 OR 222) OR CGM_RAW_* CODE
+	CGM_DATA_RWUF = 20,		// INT16, RAW UNFILTERED (253 OR 222) OR CGM_RAW_* CODE
+	CGM_DATA_NAME_LEN = 22,		// UINT8, NAME LENGTH (0-9)
+	CGM_DATA_NAME = 23		// NAME, NOT NULL TERMINATED (Christine)
+};
+
+// byte offsets in the settings array
+enum CgmValsOffset {
+	CGM_VALS_VERSION = 0,		// UINT8, CGM_PROTOCOL_VERSION
+	CGM_VALS_UNITS = 1,		// UINT8, 0 = MG/DL, 1 = MMOL
+	CGM_VALS_LOWBG = 2,		// UINT16, LOW BG
+	CGM_VALS_HIGHBG = 4,		// UINT16, HIGH BG
+	CGM_VALS_LOWSNZ = 6,		// UINT8, LOW SNOOZE MINUTES
+	CGM_VALS_HIGHSNZ = 7,		// UINT8, HIGH SNOOZE MINUTES
+	CGM_VALS_LOWVIBE = 8,		// UINT8, LOW VIBRATION
+	CGM_VALS_HIGHVIBE = 9,		// UINT8, HIGH VIBRATION
+	CGM_VALS_VIBEPATTERN = 10,	// UINT8, VIBRATION PATTERN
+	CGM_VALS_TIMEFORMAT = 11,	// UINT8, 0 = 12 HOUR, 1 = 24 HOUR
+	CGM_VALS_RAWVIBRATE = 12,	// UINT8, 1 = VIBRATE ON CALCULATED RAW
+	CGM_VALS_CFGVERSION = 13	// UINT16, CONFIG VERSION; WATCH SENDS IT BACK WITH EVERY REQUEST
+};
+
+// status codes; LOAD is only used on the watch for the initial values
+enum CgmStatus {
+	CGM_STATUS_READING = 0,
+	CGM_STATUS_LOAD = 1,
+	CGM_STATUS_NOEP = 2,
+	CGM_STATUS_OFF = 3,
+	CGM_STATUS_SAME = 4		// NO NEW READING; ONLY CGM_DATA_SAME_* FIELDS ARE SENT
+};
+
+// byte offsets in a data array with CGM_STATUS_SAME
+enum CgmDataSameOffset {
+	CGM_DATA_SAME_TCGM = 2,		// UINT32, CGM TIME OF THE READING WE ALREADY HAVE
+	CGM_DATA_SAME_TAPP = 6		// UINT32, APP / PHONE TIME
+};
+
+// byte offsets in a history array; the newest reading is not in here, it comes in the data array
+// every entry is CGM_HIST_ENTRY_SIZE bytes
+enum CgmHistOffset {
+	CGM_HIST_VERSION = 0,		// UINT8, CGM_PROTOCOL_VERSION
+	CGM_HIST_FLAGS = 1,		// UINT8, CGM_FLAG_MMOL
+	CGM_HIST_COUNT = 2,		// UINT8, NUMBER OF ENTRIES (1-9)
+	CGM_HIST_BASE_TIME = 3,		// UINT32, CGM TIME OF THE FIRST ENTRY
+	CGM_HIST_ENTRIES = 7,		// ENTRIES START HERE
+	CGM_HIST_ENTRY_DELTA = 0,	// UINT16, SECONDS SINCE THE ENTRY BEFORE (0 FOR THE FIRST)
+	CGM_HIST_ENTRY_BG = 2,		// INT16, BG (253 OR 222)
+	CGM_HIST_ENTRY_ARROW = 4	// UINT8, ARROW CODE IN LOW 4 BITS, NOISE IN HIGH 4 BITS
+};
+
+static const uint8_t CGM_DATA_STATUS_SIZE = 2;
+static const uint8_t CGM_DATA_MAX_SIZE = 32;
+static const uint8_t CGM_VALS_SIZE = 15;
+static const uint8_t CGM_DATA_SAME_SIZE = 10;
+static const uint8_t CGM_HIST_ENTRY_SIZE = 5;
+static const uint8_t CGM_HIST_MAX_SIZE = 52;
+static const uint8_t APPMSG_OUTBOX_SIZE = 32;
+
+static const uint8_t CGM_FLAG_MMOL = 0x01;
+static const uint8_t CGM_FLAG_PRSS = 0x02;
+
+static const int16_t CGM_DELTA_ERR = -32768;
+static const uint8_t CGM_UBAT_NONE = 255;
+static const uint8_t CGM_UBAT_ERR = 254;
+
+// calculated raw and raw unfiltered codes when there is no number to show
+enum CgmRawCode {
+	CGM_RAW_NONE = -1,
+	CGM_RAW_LO = -2,
+	CGM_RAW_HI = -3,
+	CGM_RAW_ERR = -4,
+	CGM_RAW_CAL = -5
+};
+
+// TOTAL MESSAGE DATA 32+15+52 = 99 BYTES
+// TOTAL KEY HEADER DATA 1+3x7 = 22 BYTES
+// TOTAL INBOX 121 BYTES; A READING WITHOUT SETTINGS IS 40 BYTES, NO NEW READING IS 18 BYTES
+// WAS 110 BYTES AS STRINGS WITH A 212 BYTE SYNC BUFFER
+
+// decoded settings, same order as the settings array
+typedef struct {
+  uint8_t units;
+  uint16_t low_bg;
+  uint16_t high_bg;
+  uint8_t low_snooze;
+  uint8_t high_snooze;
+  uint8_t low_vibe;
+  uint8_t high_vibe;
+  uint8_t vibe_pattern;
+  uint8_t time_format;
+  uint8_t raw_vibrate;
+  uint16_t cfg_version;
+} CgmSettings;
+
+// staging for one incoming message; the whole dictionary is decoded here in one pass
+// and then committed once, so every layer and alert is updated at most once per message
+// received_keys has bit (1 << CgmKey) set for every key that was in the message and decoded ok
+typedef struct {
+  uint8_t received_keys;
+  uint8_t status;
+  uint8_t flags;
+  uint8_t arrow;
+  int16_t bg;
+  int16_t bg_delta;
+  uint32_t tcgm;
+  uint32_t tapp;
+  uint8_t battlevel;
+  uint8_t noise;
+  int16_t calc_raw;
+  int16_t raw_unfilt;
+  char t1dname[10];
+  CgmSettings settings;
+  const uint8_t *hist_data;
+  uint16_t hist_length;
+} CgmMessage;
+
+static CgmMessage staged_msg_cgm;
+
+// last committed reading; a CGM_STATUS_SAME message commits this again with the new app time
+static CgmMessage last_reading_cgm;
+
+// status of the last committed data; the fetch scheduler only waits for the next reading while this is a reading
+static uint8_t fetch_last_status_cgm = CGM_STATUS_LOAD;
+
+// Persistent storage, so a restart can draw the last reading and thresholds right away
+// Saved as the same byte arrays the phone sends and read back with the same decoders, so a wire format
+// change is caught by CGM_PROTOCOL_VERSION; only bump PERSIST_LAYOUT_VERSION if what is saved under the keys changes
+static const uint8_t PERSIST_LAYOUT_VERSION = 3;
+
+enum PersistKey {
+	PERSIST_LAYOUT_KEY = 0x0,	// INT, PERSIST_LAYOUT_VERSION THE DATA WAS WRITTEN WITH
+	PERSIST_READING_KEY = 0x1,	// DATA, LAST READING AS A CGM_DATA_KEY ARRAY
+	PERSIST_SETTINGS_KEY = 0x2	// DATA, LAST SETTINGS AS A CGM_VALS_KEY ARRAY
+};
+
+// cgm time of the reading in storage; only write again when we get a new reading
+static uint32_t persisted_cgm_time = 0;
+
+// set while drawing restored values; no vibrations for old data, and no alert or snooze state changes either
+static uint8_t RestoringState = 100;
 
 // ARRAY OF SPECIAL VALUE ICONS
 static const uint8_t SPECIAL_VALUE_ICONS[] = {
-	RESOURCE_ID_IMAGE_SPECVALUE_NONE,   //0
-	RESOURCE_ID_IMAGE_BROKEN_ANTENNA,   //1
-	RESOURCE_ID_IMAGE_BLOOD_DROP,       //2
-	RESOURCE_ID_IMAGE_STOP_LIGHT,       //3
-	RESOURCE_ID_IMAGE_HOURGLASS,        //4
-	RESOURCE_ID_IMAGE_QUESTION_MARKS,   //5
-	RESOURCE_ID_IMAGE_LOGO              //6
+	ICON_SPECVALUE_NONE,   //0
+	ICON_BROKEN_ANTENNA,   //1
+	ICON_BLOOD_DROP,       //2
+	ICON_STOP_LIGHT,       //3
+	ICON_HOURGLASS,        //4
+	ICON_QUESTION_MARKS,   //5
+	ICON_LOGO              //6
 };
 	
 // INDEX FOR ARRAY OF SPECIAL VALUE ICONS
@@ -310,9 +677,9 @@ static const uint8_t LOGO_SPECVALUE_ICON_INDX = 6;
 
 // ARRAY OF TIMEAGO ICONS
 static const uint8_t TIMEAGO_ICONS[] = {
-	RESOURCE_ID_IMAGE_RCVRNONE,   //0
-	RESOURCE_ID_IMAGE_RCVRON,     //1
-	RESOURCE_ID_IMAGE_RCVROFF     //2
+	ICON_RCVRNONE,   //0
+	ICON_RCVRON,     //1
+	ICON_RCVROFF     //2
 };
 
 // INDEX FOR ARRAY OF TIMEAGO ICONS
@@ -320,6 +687,42 @@ static const uint8_t RCVRNONE_ICON_INDX = 0;
 static const uint8_t RCVRON_ICON_INDX = 1;
 static const uint8_t RCVROFF_ICON_INDX = 2;
 
+// ARROW CODES, AS SENT BY THE PHONE
+enum ArrowCode {
+	NO_ARROW = 0,
+	DOUBLEUP_ARROW = 1,
+	SINGLEUP_ARROW = 2,
+	UP45_ARROW = 3,
+	FLAT_ARROW = 4,
+	DOWN45_ARROW = 5,
+	SINGLEDOWN_ARROW = 6,
+	DOUBLEDOWN_ARROW = 7,
+	NOTCOMPUTE_ICON = 8,
+	OUTOFRANGE_ICON = 9,
+	ARROW_CODE_COUNT = 10
+};
+
+// ARROW ICON AND ALERT FOR EACH ARROW CODE; alert_vibe is NULL if the arrow doesn't vibrate
+// any code past the table is unexpected and shows the logo
+typedef struct {
+  uint8_t icon;
+  uint8_t *alert_vibe;
+} ArrowIcon;
+
+static const ArrowIcon ARROW_ICONS[ARROW_CODE_COUNT] = {
+	{ ICON_SPECVALUE_NONE, NULL },          //NO_ARROW
+	{ ICON_UPUP, NULL },                    //DOUBLEUP_ARROW
+	{ ICON_UP, NULL },                      //SINGLEUP_ARROW
+	{ ICON_UP45, NULL },                    //UP45_ARROW
+	{ ICON_FLAT, NULL },                    //FLAT_ARROW
+	{ ICON_DOWN45, NULL },                  //DOWN45_ARROW
+	{ ICON_DOWN, NULL },                    //SINGLEDOWN_ARROW
+	{ ICON_DOWNDOWN, &DOUBLEDOWN_VIBE },    //DOUBLEDOWN_ARROW
+	{ ICON_SPECVALUE_NONE, NULL },          //NOTCOMPUTE_ICON
+	{ ICON_SPECVALUE_NONE, NULL }           //OUTOFRANGE_ICON
+};
+static const ArrowIcon UNKNOWN_ARROW_ICON = { ICON_LOGO, NULL };
+
 static char *translate_app_error(AppMessageResult result) {
   switch (result) {
 	case APP_MSG_OK: return "APP_MSG_OK";
@@ -340,1989 +743,3226 @@ static char *translate_app_error(AppMessageResult result) {
   }
 }
 
-static char *translate_dict_error(DictionaryResult result) {
-  switch (result) {
-    case DICT_OK: return "DICT_OK";
-    case DICT_NOT_ENOUGH_STORAGE: return "DICT_NOT_ENOUGH_STORAGE";
-    case DICT_INVALID_ARGS: return "DICT_INVALID_ARGS";
-    case DICT_INTERNAL_INCONSISTENCY: return "DICT_INTERNAL_INCONSISTENCY";
-    case DICT_MALLOC_FAILED: return "DICT_MALLOC_FAILED";
-    default: return "DICT UNKNOWN ERROR";
-  }
-}
-
-char *strtok(s, delim)
-	register char *s;
-	register const char *delim;
-{
-	register char *spanp;
-	register int c, sc;
-	char *tok;
-	static char *last;
-
-
-	if (s == NULL && (s = last) == NULL)
-		return (NULL);
-
-	/*
-	 * Skip (span) leading delimiters (s += strspn(s, delim), sort of).
-	 */
-cont:
-	c = *s++;
-	for (spanp = (char *)delim; (sc = *spanp++) != 0;) {
-		if (c == sc)
-			goto cont;
-	}
-
-	if (c == 0) {		/* no non-delimiter characters */
-		last = NULL;
-		return (NULL);
-	}
-	tok = s - 1;
-
-	/*
-	 * Scan token (scan for delimiters: s += strcspn(s, delim), sort of).
-	 * Note that delim must have one NUL; we stop if we see that, too.
-	 */
-	for (;;) {
-		c = *s++;
-		spanp = (char *)delim;
-		do {
-			if ((sc = *spanp++) == c) {
-				if (c == 0)
-					s = NULL;
-				else
-					s[-1] = 0;
-				last = s;
-				return (tok);
-			}
-		} while (sc != 0);
-	}
-	/* NOTREACHED */
-}
+// app message retry policy per error; delay starts at base_ms and doubles every retry up to max_ms
+// a base_ms of 0 means no retry, something else asks again
+typedef struct {
+  AppMessageResult result;
+  uint16_t base_ms;
+  uint16_t max_ms;
+} AppMsgRetryPolicy;
+
+static const AppMsgRetryPolicy APPMSG_RETRY_POLICIES[] = {
+  { APP_MSG_BUSY, 250, 2000 },               // outbox or inbox still in use, clears fast
+  { APP_MSG_BUFFER_OVERFLOW, 500, 4000 },    // phone sent too much at once
+  { APP_MSG_SEND_REJECTED, 1000, 15000 },    // phone said no
+  { APP_MSG_SEND_TIMEOUT, 2000, 30000 },     // link is slow or congested; back off hard
+  { APP_MSG_APP_NOT_RUNNING, 2000, 30000 },  // phone app still starting
+  { APP_MSG_NOT_CONNECTED, 0, 0 }            // bluetooth handler asks again on reconnect
+};
 
-int myBGAtoi(char *str) {
+static const AppMsgRetryPolicy APPMSG_RETRY_DEFAULT = { APP_MSG_INTERNAL_ERROR, 1000, 15000 };
 
-	// VARIABLES
-    int res = 0; // Initialize result
-	
-	// CODE START
- 
-    // initialize currentBG_isMMOL flag
-	currentBG_isMMOL = 100;
-	
-	//APP_LOG(APP_LOG_LEVEL_DEBUG, "myBGAtoi, START currentBG is MMOL: %i", currentBG_isMMOL );
-	
-    // Iterate through all characters of input string and update result
-    for (int i = 0; str[i] != '\0'; ++i) {
-      
-	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "myBGAtoi, STRING IN: %s", &str[i] );
-	  
-        if (str[i] == ('.')) {
-        currentBG_isMMOL = 111;
-      }
-      else if ( (str[i] >= ('0')) && (str[i] <= ('9')) ) {
-        res = res*10 + str[i] - '0';
-      }
-      
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "myBGAtoi, FOR RESULT OUT: %i", res );
-	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "myBGAtoi, currentBG is MMOL: %i", currentBG_isMMOL );	  
-    }
- //APP_LOG(APP_LOG_LEVEL_DEBUG, "myBGAtoi, FINAL RESULT OUT: %i", res );
-    return res;
-} // end myBGAtoi
-
-static void load_values(){
-  //APP_LOG(APP_LOG_LEVEL_DEBUG,"Loaded Values: %s", current_values);
-
-  int num_a_items = 0;
-  char *o;
-  int mgormm = 0;
-  int vibes = 0;
-  int rawvibrate = 0;
-  if (current_values == NULL) {
-    return;
-  } else {
-    o = strtok(current_values,",");
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "mg or mm: %s", o);      
-    mgormm = atoi(o);
-
-    while(o != NULL) {
-      num_a_items++;
-      switch (num_a_items) {
-        case 2:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "lowbg: %s", o);
-          if (mgormm == 0){
-            LOW_BG_MGDL = atoi(o);
-            if (LOW_BG_MGDL < 60) {
-            	MIDLOW_BG_MGDL = 55;
-            	BIGLOW_BG_MGDL = 50;
-            	HYPOLOW_BG_MGDL = 45;
-            } else if (LOW_BG_MGDL < 70) {
-            	MIDLOW_BG_MGDL = 60;
-            	BIGLOW_BG_MGDL = 55;
-            	HYPOLOW_BG_MGDL = 50;
-            }
-          } else {
-            LOW_BG_MMOL = atoi(o);
-            if (LOW_BG_MMOL < 33) {
-            	MIDLOW_BG_MMOL = 31;
-            	BIGLOW_BG_MMOL = 28;
-            	HYPOLOW_BG_MMOL = 25;
-            } else if (LOW_BG_MMOL < 39) {
-            	MIDLOW_BG_MMOL = 33;
-            	BIGLOW_BG_MMOL = 31;
-            	HYPOLOW_BG_MMOL = 28;
-            }
-          }
-          break;
-        case 3:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "highbg: %s", o);
-          if (mgormm == 0){
-            HIGH_BG_MGDL = atoi(o);
-            if (HIGH_BG_MGDL > 239) {
-              MIDHIGH_BG_MGDL = 300;
-              BIGHIGH_BG_MGDL = 350;
-            }
-          } else {
-            HIGH_BG_MMOL = atoi(o);
-              if (HIGH_BG_MMOL > 132) {
-               MIDHIGH_BG_MMOL = 166;
-               BIGHIGH_BG_MMOL =  200;
-              }
-          }
-          break;
-        case 4:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "lowsnooze: %s", o);
-          LOW_SNZ_MIN = atoi(o);
-          break;
-        case 5:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "highsnooze: %s", o);      
-          HIGH_SNZ_MIN = atoi(o);
-          break;
-        case 6:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "lowvibe: %s", o);
-          LOWBG_VIBE = atoi(o);
-          break;
-        case 7:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "highvibe: %s", o);
-          HIGHBG_VIBE = atoi(o);
-          break;
-        case 8:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "vibepattern: %s", o);
-          vibes = atoi(o);        
-          if (vibes == 0){
-            TurnOffAllVibrations = 111;
-            TurnOffStrongVibrations = 111;
-          } else if (vibes == 1){
-            TurnOffAllVibrations = 100;
-            TurnOffStrongVibrations = 111; 
-          } else if (vibes == 2){
-            TurnOffAllVibrations = 100;
-            TurnOffStrongVibrations = 100;
-          }
-          break;
-        case 9:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "timeformat: %s", o);
-          timeformat = atoi(o);
-          break;
-        case 10:
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "rawvibrate: %s", o);
-          rawvibrate = atoi(o);
-          if (rawvibrate == 0) { TurnOffVibrationsCalcRaw = 111; }
-          else { TurnOffVibrationsCalcRaw = 100; }
-          break;
-      }
-      o = strtok(NULL,",");
+static const AppMsgRetryPolicy* get_retry_policy_cgm(const AppMessageResult result) {
+  
+  for (uint8_t policy_index = 0; policy_index < ARRAY_LENGTH(APPMSG_RETRY_POLICIES); policy_index++) {
+    if (APPMSG_RETRY_POLICIES[policy_index].result == result) {
+      return &APPMSG_RETRY_POLICIES[policy_index];
     }
   }
-   
+  return &APPMSG_RETRY_DEFAULT;
   
-} //End load_values
+} // end get_retry_policy_cgm
 
-static void destroy_null_GBitmap(GBitmap **GBmp_image) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: ENTER CODE");
+static uint8_t appmsg_result_index(const AppMessageResult result) {
   
-  if (*GBmp_image != NULL) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: POINTER EXISTS, DESTROY BITMAP IMAGE");
-      gbitmap_destroy(*GBmp_image);
-      if (*GBmp_image != NULL) {
-        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: POINTER EXISTS, SET POINTER TO NULL");
-        *GBmp_image = NULL;
-      }
-	}
+  // VARIABLES
+  uint8_t result_index = 0;
   
-   //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: EXIT CODE");
-} // end destroy_null_GBitmap
+  // CODE START
+  
+  // lowest bit set; APP_MSG_OK and unknown codes go in 0
+  while ((result_index < APPMSG_RESULT_BITS) && (!((uint32_t)result & (1u << result_index)))) {
+    result_index++;
+  }
+  return (result_index < APPMSG_RESULT_BITS) ? result_index : 0;
+  
+} // end appmsg_result_index
 
-static void destroy_null_BitmapLayer(BitmapLayer **bmp_layer) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: ENTER CODE");
-	
-	if (*bmp_layer != NULL) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: POINTER EXISTS, DESTROY BITMAP LAYER");
-      bitmap_layer_destroy(*bmp_layer);
-      if (*bmp_layer != NULL) {
-        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: POINTER EXISTS, SET POINTER TO NULL");
-        *bmp_layer = NULL;
-      }
-	}
+static const HistoryEntry* get_history_cgm(const uint8_t age_index) {
+  
+  // age_index 0 is the newest reading
+  if (age_index >= history_count_cgm) {
+    return NULL;
+  }
+  return &history_cgm[(history_head_cgm + HISTORY_SIZE - 1 - age_index) % HISTORY_SIZE];
+  
+} // end get_history_cgm
 
-  //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: EXIT CODE");
-} // end destroy_null_BitmapLayer
+static uint8_t history_slot_shift(const uint8_t delta_min) {
+  
+  // readings are 5 minutes apart; more than that leaves a gap for the missed ones
+  if (delta_min < 5) {
+    return 1;
+  }
+  return (delta_min + 2) / 5;
+  
+} // end history_slot_shift
 
-static void destroy_null_TextLayer(TextLayer **txt_layer) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: ENTER CODE");
-	
-	if (*txt_layer != NULL) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: POINTER EXISTS, DESTROY TEXT LAYER");
-      text_layer_destroy(*txt_layer);
-      if (*txt_layer != NULL) {
-        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: POINTER EXISTS, SET POINTER TO NULL");
-        *txt_layer = NULL;
-      }
-	}
-//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: EXIT CODE");
-} // end destroy_null_TextLayer
+static void mark_face_dirty_cgm(const uint8_t face_id);
+static void ensure_face_layer_cgm(const uint8_t face_id);
+static void release_face_layer_cgm(const uint8_t face_id);
 
-static void destroy_null_InverterLayer(InverterLayer **inv_layer) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: ENTER CODE");
-	
-	if (*inv_layer != NULL) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: POINTER EXISTS, DESTROY INVERTER LAYER");
-      inverter_layer_destroy(*inv_layer);
-      if (*inv_layer != NULL) {
-        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: POINTER EXISTS, SET POINTER TO NULL");
-        *inv_layer = NULL;
-      }
-	}
-//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: EXIT CODE");
-} // end destroy_null_InverterLayer
+static uint8_t sparkline_bg_to_y(const int bg_value) {
+  
+  // VARIABLES
+  int bg_bottom = SHOWLOW_BG_MGDL;
+  int bg_top = SHOWHIGH_BG_MGDL;
+  int bg_clamped = bg_value;
+  int graph_height = 0;
+  
+  // CODE START
+  
+  graph_height = FACE_LAYOUT[FACE_SPARKLINE].frame.size.h - 1;
+  
+  if (history_units_cgm == BG_UNITS_MMOL) {
+    bg_bottom = SHOWLOW_BG_MMOL;
+    bg_top = SHOWHIGH_BG_MMOL;
+  }
+  
+  // special values and no reading are not plotted
+  if (bg_value < bg_bottom) {
+    return SPARKLINE_EMPTY;
+  }
+  if (bg_clamped > bg_top) {
+    bg_clamped = bg_top;
+  }
+  
+  // fixed scale, so old points never have to move when a new reading comes in
+  return graph_height - (((bg_clamped - bg_bottom) * graph_height) / (bg_top - bg_bottom));
+  
+} // end sparkline_bg_to_y
 
-static void create_update_bitmap(GBitmap **bmp_image, BitmapLayer *bmp_layer, const int resource_id) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: ENTER CODE");
+static void rebuild_sparkline_cgm() {
   
-	// if bitmap pointer exists, destroy and set to NULL
-	destroy_null_GBitmap(bmp_image);
-	
-	// create bitmap and pointer
-  //APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: CREATE BITMAP");
-	*bmp_image = gbitmap_create_with_resource(resource_id);
+  // VARIABLES
+  const HistoryEntry *history_entry = NULL;
+  uint16_t slot = 0;
   
-	if (*bmp_image == NULL) {
-      // couldn't create bitmap, return so don't crash
-    //APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: COULDNT CREATE BITMAP, RETURN");
-      return;
-	}
-	else {
-      // set bitmap
-    //APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: SET BITMAP");
-      bitmap_layer_set_bitmap(bmp_layer, *bmp_image);
-	}
-	//APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: EXIT CODE");
-} // end create_update_bitmap
+  // CODE START
+  
+  // full recompute; only for load, backfill or new thresholds, a new reading uses shift_sparkline_cgm
+  memset(sparkline_y_cgm, SPARKLINE_EMPTY, sizeof(sparkline_y_cgm));
+  
+  for (uint8_t age_index = 0; age_index < history_count_cgm; age_index++) {
+    history_entry = get_history_cgm(age_index);
+    if (slot >= HISTORY_SIZE) {
+      break;
+    }
+    sparkline_y_cgm[slot] = sparkline_bg_to_y(history_entry->bg);
+    slot += history_slot_shift(history_entry->delta_min);
+  }
+  
+  if (history_units_cgm == BG_UNITS_MMOL) {
+    sparkline_low_y_cgm = sparkline_bg_to_y(LOW_BG_MMOL);
+    sparkline_high_y_cgm = sparkline_bg_to_y(HIGH_BG_MMOL);
+  }
+  else {
+    sparkline_low_y_cgm = sparkline_bg_to_y(LOW_BG_MGDL);
+    sparkline_high_y_cgm = sparkline_bg_to_y(HIGH_BG_MGDL);
+  }
+  
+  mark_face_dirty_cgm(FACE_SPARKLINE);
+  
+} // end rebuild_sparkline_cgm
 
-static void alert_handler_cgm(uint8_t alertValue) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER");
-	//APP_LOG(APP_LOG_LEVEL_DEBUG, "ALERT CODE: %d", alertValue);
-	
-	// CONSTANTS
-	// constants for vibrations patterns; has to be uint32_t, measured in ms, maximum duration 10000ms
-	// Vibe pattern: ON, OFF, ON, OFF; ON for 500ms, OFF for 100ms, ON for 100ms; 
-	
-	// CURRENT PATTERNS
-	const uint32_t highalert_fast[] = { 300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300 };
-	const uint32_t medalert_long[] = { 500,100,100,100,500,100,100,100,500,100,100,100,500,100,100,100,500 };
-	const uint32_t lowalert_beebuzz[] = { 75,50,50,50,75,50,50,50,75,50,50,50,75,50,50,50,75,50,50,50,75,50,50,50,75 };
-	
-	// PATTERN DURATION
-	const uint8_t HIGHALERT_FAST_STRONG = 33;
-	const uint8_t HIGHALERT_FAST_SHORT = (33/2);
-	const uint8_t MEDALERT_LONG_STRONG = 17;
-	const uint8_t MEDALERT_LONG_SHORT = (17/2);
-	const uint8_t LOWALERT_BEEBUZZ_STRONG = 25;
-	const uint8_t LOWALERT_BEEBUZZ_SHORT = (25/2);
+static void shift_sparkline_cgm(const HistoryEntry *new_entry) {
   
-	// CODE START
-	
-	if ( (TurnOffAllVibrations == 111) || (HardCodeNoVibrations == 111) ) {
-      //turn off all vibrations is set, return out here
-      return;
-	}
-	
-	switch (alertValue) {
+  // VARIABLES
+  uint8_t slot_shift = history_slot_shift(new_entry->delta_min);
+  
+  // CODE START
+  
+  // move the old points over by the time since the last reading, then only compute the new one
+  if (slot_shift >= HISTORY_SIZE) {
+    memset(sparkline_y_cgm, SPARKLINE_EMPTY, sizeof(sparkline_y_cgm));
+  }
+  else {
+    memmove(&sparkline_y_cgm[slot_shift], &sparkline_y_cgm[0], HISTORY_SIZE - slot_shift);
+    memset(sparkline_y_cgm, SPARKLINE_EMPTY, slot_shift);
+  }
+  sparkline_y_cgm[0] = sparkline_bg_to_y(new_entry->bg);
+  
+  mark_face_dirty_cgm(FACE_SPARKLINE);
+  
+} // end shift_sparkline_cgm
 
-	case 0:
-      //No alert
-      //Normal (new data, in range, trend okay)
-      break;
-    
-	case 1:;
-      //Low
-      //APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER: LOW ALERT");
-      VibePattern low_alert_pat = {
-			.durations = lowalert_beebuzz,
-			.num_segments = LOWALERT_BEEBUZZ_STRONG,
-      };
-	  if (TurnOffStrongVibrations == 111) { low_alert_pat.num_segments = LOWALERT_BEEBUZZ_SHORT; };
-      vibes_enqueue_custom_pattern(low_alert_pat);
-      break;
+static uint16_t read_uint16_cgm(const uint8_t *data) {
+  
+  return (uint16_t)(data[0] | (data[1] << 8));
+  
+} // end read_uint16_cgm
 
-	case 2:;
-      // Medium Alert
-      //APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER: MEDIUM ALERT");
-      VibePattern med_alert_pat = {
-			.durations = medalert_long,
-			.num_segments = MEDALERT_LONG_STRONG,
-      };
-	  if (TurnOffStrongVibrations == 111) { med_alert_pat.num_segments = MEDALERT_LONG_SHORT; };
-      vibes_enqueue_custom_pattern(med_alert_pat);
-      break;
+static uint32_t read_uint32_cgm(const uint8_t *data) {
+  
+  return ((uint32_t)data[0]) | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+  
+} // end read_uint32_cgm
 
-	case 3:;
-      // High Alert
-      //APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER: HIGH ALERT");
-      VibePattern high_alert_pat = {
-			.durations = highalert_fast,
-			.num_segments = HIGHALERT_FAST_STRONG,
-      };
-	  if (TurnOffStrongVibrations == 111) { high_alert_pat.num_segments = HIGHALERT_FAST_SHORT; };
-      vibes_enqueue_custom_pattern(high_alert_pat);
-      break;
+static void write_uint16_cgm(uint8_t *data, const uint16_t value) {
   
-	} // switch alertValue
-	
-} // end alert_handler_cgm
+  data[0] = (uint8_t)(value & 0xFF);
+  data[1] = (uint8_t)(value >> 8);
+  
+} // end write_uint16_cgm
 
-void BT_timer_callback(void *data);
+static void write_uint32_cgm(uint8_t *data, const uint32_t value) {
+  
+  write_uint16_cgm(&data[0], (uint16_t)(value & 0xFFFF));
+  write_uint16_cgm(&data[2], (uint16_t)(value >> 16));
+  
+} // end write_uint32_cgm
 
-void handle_bluetooth_cgm(bool bt_connected) {
-  //APP_LOG(APP_LOG_LEVEL_INFO, "HANDLE BT: ENTER CODE");
+static Glucose convert_glucose_cgm(const Glucose bg, const uint8_t to_units) {
   
-  if (bt_connected == false)
-  // bluetooth is out  
-  {
-	
-	// Check BluetoothAlert for extended Bluetooth outage; if so, do nothing
-	if (BluetoothAlert == 111) {
-      //Already vibrated and set message; out
-	  return;
-	}
-	
-	// Check to see if the BT_timer needs to be set; if BT_timer is not null we're still waiting
-	if (BT_timer == NULL) {
-	  // check to see if timer has popped
-	  if (BT_timer_pop == 100) {
-	    //set timer
-	    BT_timer = app_timer_register((BT_ALERT_WAIT_SECS*MS_IN_A_SECOND), BT_timer_callback, NULL);
-		// have set timer; next time we come through we will see that the timer has popped
-		return;
-	  }
-	}
-	else {
-	  // BT_timer is not null and we're still waiting
-	  return;
-    }
-	
-	// timer has popped
-	// Vibrate; BluetoothAlert takes over until Bluetooth connection comes back on
-	//APP_LOG(APP_LOG_LEVEL_INFO, "BT HANDLER: TIMER POP, NO BLUETOOTH, VIBRATE");
-    alert_handler_cgm(BTOUT_VIBE);
-    BluetoothAlert = 111;
-	
-	// Reset timer pop
-	BT_timer_pop = 100;
-	
-	//APP_LOG(APP_LOG_LEVEL_INFO, "NO BLUETOOTH");
-    if (TurnOff_NOBLUETOOTH_Msg == 100) {
-	  text_layer_set_text(message_layer, "NO BLUETOOTH");
-	}
-    
-    // erase cgm and app ago times
-    text_layer_set_text(cgmtime_layer, "");
-    init_loading_cgm_timeago = 111;
-    
-	// erase cgm icon
-    create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
-	
-  }
-    
-  else {
-	// Bluetooth is on, reset BluetoothAlert
-    //APP_LOG(APP_LOG_LEVEL_INFO, "HANDLE BT: BLUETOOTH ON");
-    //if (BluetoothAlert == 111) { 
-      //ClearedOutage = 111; 
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "BT HANDLER, SET CLEARED OUTAGE: %i ", ClearedOutage);
-    //} 
-    BluetoothAlert = 100;
-    ClearedBTOutage = 111;
-    if (BT_timer == NULL) {
-      // no timer is set, so need to reset timer pop
-      BT_timer_pop = 100;
-    }
-  }
+  // VARIABLES
+  Glucose converted_bg = bg;
+  int32_t bg_mgdl_x1000 = 0;
+  uint16_t to_factor = GLUCOSE_UNITS[to_units].mgdl_per_unit_x1000;
   
-  //APP_LOG(APP_LOG_LEVEL_INFO, "BluetoothAlert: %i", BluetoothAlert);
-} // end handle_bluetooth_cgm
-
-void BT_timer_callback(void *data) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "BT TIMER CALLBACK: ENTER CODE");
-	
-	// reset timer pop and timer
-	BT_timer_pop = 111;
-	if (BT_timer != NULL) {
-	  BT_timer = NULL;
-	}
-	
-	// check bluetooth and call handler
-	bluetooth_connected_cgm = bluetooth_connection_service_peek();
-	handle_bluetooth_cgm(bluetooth_connected_cgm);
-	
-} // end BT_timer_callback
-
-void handle_watch_battery_cgm(BatteryChargeState watch_charge_state) {
+  // CODE START
   
-  static char watch_battery_text[] = "Wch 100%";
-
-  if (watch_charge_state.is_charging) {
-    snprintf(watch_battery_text, BATTLEVEL_FORMAT_SIZE, "CHARGING");
-  } else {
-    snprintf(watch_battery_text, BATTLEVEL_FORMAT_SIZE, "Wch %d%%", watch_charge_state.charge_percent);
+  // codes and no reading are the same in any units
+  if ((bg.units == to_units) || (bg.value <= 0)) {
+    converted_bg.units = to_units;
+    return converted_bg;
   }
-  text_layer_set_text(watch_battlevel_layer, watch_battery_text);
   
-} // end handle_watch_battery_cgm
+  bg_mgdl_x1000 = (int32_t)bg.value * GLUCOSE_UNITS[bg.units].mgdl_per_unit_x1000;
+  converted_bg.value = (bg_mgdl_x1000 + (to_factor / 2)) / to_factor;
+  converted_bg.units = to_units;
+  return converted_bg;
+  
+} // end convert_glucose_cgm
 
-static void draw_date_from_app() {
- 
+static void format_glucose_cgm(char *bg_text, const uint8_t bg_text_size, const Glucose bg, const uint8_t show_plus) {
+  
   // VARIABLES
-  time_t d_app = time(NULL);
-  struct tm *current_d_app = localtime(&d_app);
-  size_t draw_return = 0;
-
-  // CODE START
+  const char *bg_sign = "";
+  int abs_bg_value = bg.value;
   
-  // format current date from app
-  if (strcmp(time_watch_text, "00:00") == 0) {
-      //APP_LOG(APP_LOG_LEVEL_INFO, "TimeFormat: %d", timeformat);
-      if (timeformat == 0){
-        draw_return = strftime(time_watch_text, TIME_TEXTBUFF_SIZE, "%l:%M", current_d_app);
-      } else {
-        draw_return = strftime(time_watch_text, TIME_TEXTBUFF_SIZE, "%H:%M", current_d_app);
-      }
+  // CODE START
   
-	if (draw_return != 0) {
-      text_layer_set_text(time_watch_layer, time_watch_text);
-	}
+  if (bg.value < 0) {
+    bg_sign = "-";
+    abs_bg_value = -bg.value;
+  }
+  else if ((bg.value > 0) && (show_plus == 111)) {
+    bg_sign = "+";
   }
   
-  draw_return = strftime(date_app_text, DATE_TEXTBUFF_SIZE, "%a %d", current_d_app);
-  if (draw_return != 0) {
-    text_layer_set_text(date_app_layer, date_app_text);
+  // for MMOL last digit is the decimal
+  if (bg.units == BG_UNITS_MMOL) {
+    snprintf(bg_text, bg_text_size, "%s%i.%i", bg_sign, abs_bg_value / 10, abs_bg_value % 10);
   }
+  else {
+    snprintf(bg_text, bg_text_size, "%s%i", bg_sign, abs_bg_value);
+  }
+  
+} // end format_glucose_cgm
 
-} // end draw_date_from_app
-
-void sync_error_callback_cgm(DictionaryResult appsync_dict_error, AppMessageResult appsync_error, void *context) {
-
+static void convert_history_cgm(const uint8_t to_units) {
+  
   // VARIABLES
-  DictionaryIterator *iter = NULL;
-  AppMessageResult appsync_err_openerr = APP_MSG_OK;
-  AppMessageResult appsync_err_senderr = APP_MSG_OK;
-
-  bool bluetooth_connected_syncerror = false;
+  Glucose history_bg = { 0, history_units_cgm };
   
   // CODE START
   
-  bluetooth_connected_syncerror = bluetooth_connection_service_peek();
-  if (!bluetooth_connected_syncerror) {
-    // bluetooth is out, BT message already set; return out
-    return;
+  for (uint8_t history_index = 0; history_index < HISTORY_SIZE; history_index++) {
+    history_bg.value = history_cgm[history_index].bg;
+    history_cgm[history_index].bg = convert_glucose_cgm(history_bg, to_units).value;
+    history_bg.value = history_cgm[history_index].calc_raw;
+    history_cgm[history_index].calc_raw = convert_glucose_cgm(history_bg, to_units).value;
   }
+  history_units_cgm = to_units;
+  rebuild_sparkline_cgm();
   
-  // increment app sync retries counter
-  appsyncandmsg_retries_counter++;
+} // end convert_history_cgm
+
+static HistoryEntry* push_history_cgm(const uint8_t bg_units, const int16_t bg_value, const int16_t calc_raw_value, 
+                                      const uint8_t arrow_value, const uint8_t noise_value, const uint32_t reading_time) {
   
-  // if hit max counter, skip resend and flag user
-  if (appsyncandmsg_retries_counter < APPSYNCANDMSG_RETRIES_MAX) {
+  // VARIABLES
+  HistoryEntry *history_entry = NULL;
+  uint32_t minutes_since = 0;
   
-    // APPSYNC ERROR debug logs
-    //APP_LOG(APP_LOG_LEVEL_INFO, "APP SYNC ERROR");
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "APPSYNC ERR, MSG: %i RES: %s DICT: %i RES: %s RETRIES: %i", 
-            appsync_error, translate_app_error(appsync_error), appsync_dict_error, translate_dict_error(appsync_dict_error), appsyncandmsg_retries_counter);
-  
-    // try to resend the message; open app message outbox
-    appsync_err_openerr = app_message_outbox_begin(&iter); 
-    if (appsync_err_openerr == APP_MSG_OK) {
-      // could open app message outbox; send message
-      appsync_err_senderr = app_message_outbox_send();
-      if (appsync_err_senderr == APP_MSG_OK) {
-        // everything OK, reset AppSyncErrAlert so no vibrate
-        if (AppSyncErrAlert == 111) { 
-          ClearedOutage = 111; 
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "APPSYNC ERR, SET CLEARED OUTAGE: %i ", ClearedOutage);
-        } 
-        AppSyncErrAlert = 100;
-        // sent message OK; return
-	      return;
-      } // if appsync_err_senderr
-    } // if appsync_err_openerr
-  } // if appsyncandmsg_retries_counter
-    
-  // flag error
-  if (appsyncandmsg_retries_counter > APPSYNCANDMSG_RETRIES_MAX) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "APP SYNC TOO MANY MESSAGES ERROR");
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "APPSYNC ERR, MSG: %i RES: %s DICT: %i RES: %s RETRIES: %i", 
-            appsync_error, translate_app_error(appsync_error), appsync_dict_error, translate_dict_error(appsync_dict_error), appsyncandmsg_retries_counter);
+  // CODE START
+  
+  // only new readings; a message every minute usually has the same reading
+  if ((reading_time == 0) || (reading_time <= history_last_time_cgm)) {
+    return NULL;
   }
-  else {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "APP SYNC RESEND ERROR");
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "APPSYNC RESEND ERR, OPEN: %i RES: %s SEND: %i RES: %s RETRIES: %i", 
-            appsync_err_openerr, translate_app_error(appsync_err_openerr), appsync_err_senderr, translate_app_error(appsync_err_senderr), appsyncandmsg_retries_counter);
-    return;
-  } 
- 
-  // check bluetooth again
-  bluetooth_connected_syncerror = bluetooth_connection_service_peek();   
-if (bluetooth_connected_syncerror == false) {
-    // bluetooth is out, BT message already set; return out
-    return;
+  
+  // units changed, convert the old readings so the graph keeps going
+  if (history_units_cgm != bg_units) {
+    convert_history_cgm(bg_units);
   }
   
-  // set message to RESTART WATCH -> PHONE
-  text_layer_set_text(message_layer, "√APP/RESTRT");
+  if (history_last_time_cgm != 0) {
+    minutes_since = (reading_time - history_last_time_cgm) / MINUTEAGO;
+  }
   
-  // reset appsync retries counter
-  appsyncandmsg_retries_counter = 0;
+  history_entry = &history_cgm[history_head_cgm];
+  history_entry->bg = bg_value;
+  history_entry->calc_raw = calc_raw_value;
+  history_entry->delta_min = (minutes_since > 255) ? 255 : minutes_since;
+  history_entry->arrow = arrow_value;
+  history_entry->noise = noise_value;
   
-  // erase cgm and app ago times
-  text_layer_set_text(cgmtime_layer, "");
-  init_loading_cgm_timeago = 111;
-    
-  // erase cgm icon
-  create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
-
-  // check if need to vibrate
-  if (AppSyncErrAlert == 100) {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "APPSYNC ERROR: VIBRATE");
-    alert_handler_cgm(APPSYNC_ERR_VIBE);
-    AppSyncErrAlert = 111;
-  } 
+  history_head_cgm = (history_head_cgm + 1) % HISTORY_SIZE;
+  if (history_count_cgm < HISTORY_SIZE) {
+    history_count_cgm++;
+  }
+  history_last_time_cgm = reading_time;
   
-} // end sync_error_callback_cgm
-
-void inbox_dropped_handler_cgm(AppMessageResult appmsg_indrop_error, void *context) {
-	// incoming appmessage send back from Pebble app dropped; no data received
-  // have never seen handler get called, think because AppSync is always used
-  // just set log now to avoid crash, if see log then can go back to old handler
+  return history_entry;
   
-	// APPMSG IN DROP debug logs
-	//APP_LOG(APP_LOG_LEVEL_INFO, "APPMSG IN DROP ERROR");
-	APP_LOG(APP_LOG_LEVEL_DEBUG, "APPMSG IN DROP ERR, CODE: %i RES: %s", 
-          appmsg_indrop_error, translate_app_error(appmsg_indrop_error));
-    
-} // end inbox_dropped_handler_cgm
+} // end push_history_cgm
 
-void outbox_failed_handler_cgm(DictionaryIterator *failed, AppMessageResult appmsg_outfail_error, void *context) {
-	// outgoing appmessage send failed to deliver to Pebble
-  // have never seen handler get called, think because AppSync is always used
-  // just set log now to avoid crash, if see log then can go back to old handler
-	
-  // APPMSG OUT FAIL debug logs
-  //APP_LOG(APP_LOG_LEVEL_INFO, "APPMSG OUT FAIL ERROR");
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "APPMSG OUT FAIL ERR, CODE: %i RES: %s", 
-          appmsg_outfail_error, translate_app_error(appmsg_outfail_error));
- 
-} // end outbox_failed_handler_cgm
-
-static void load_icon() {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ICON ARROW FUNCTION START");
-	
-	// CONSTANTS
-	
-	// ICON ASSIGNMENTS OF ARROW DIRECTIONS
-	const char NO_ARROW[] = "0";
-	const char DOUBLEUP_ARROW[] = "1";
-	const char SINGLEUP_ARROW[] = "2";
-	const char UP45_ARROW[] = "3";
-	const char FLAT_ARROW[] = "4";
-	const char DOWN45_ARROW[] = "5";
-	const char SINGLEDOWN_ARROW[] = "6";
-	const char DOUBLEDOWN_ARROW[] = "7";
-	const char NOTCOMPUTE_ICON[] = "8";
-	const char OUTOFRANGE_ICON[] = "9";
-	
-	// ARRAY OF ARROW ICON IMAGES
-	const uint8_t ARROW_ICONS[] = {
-	  RESOURCE_ID_IMAGE_SPECVALUE_NONE,  //0
-	  RESOURCE_ID_IMAGE_UPUP,            //1
-	  RESOURCE_ID_IMAGE_UP,              //2
-	  RESOURCE_ID_IMAGE_UP45,            //3
-	  RESOURCE_ID_IMAGE_FLAT,            //4
-	  RESOURCE_ID_IMAGE_DOWN45,          //5
-	  RESOURCE_ID_IMAGE_DOWN,            //6
-	  RESOURCE_ID_IMAGE_DOWNDOWN,        //7
-	  RESOURCE_ID_IMAGE_LOGO             //8
-	};
-    
-	// INDEX FOR ARRAY OF ARROW ICON IMAGES
-	const uint8_t NONE_ARROW_ICON_INDX = 0;
-	const uint8_t UPUP_ICON_INDX = 1;
-	const uint8_t UP_ICON_INDX = 2;
-	const uint8_t UP45_ICON_INDX = 3;
-	const uint8_t FLAT_ICON_INDX = 4;
-	const uint8_t DOWN45_ICON_INDX = 5;
-	const uint8_t DOWN_ICON_INDX = 6;
-	const uint8_t DOWNDOWN_ICON_INDX = 7;
-	const uint8_t LOGO_ARROW_ICON_INDX = 8;
+static void add_history_cgm(const int16_t bg_value, const int16_t calc_raw_value, const uint8_t arrow_value, 
+                            const uint8_t noise_value, const uint32_t reading_time) {
   
   // VARIABLES
-  static uint8_t DoubleDownAlert = 100;
+  HistoryEntry *history_entry = NULL;
   
   // CODE START
-	
-  // Got an icon value, check data offline condition, clear vibrate flag if needed
-  if ( (strcmp(current_bg_delta, "OFF") < 0) || (strcmp(current_bg_delta, "OFF") > 0) ) {
-    DataOfflineAlert = 100;
-    dataoffline_retries_counter = 0;
+  
+  history_entry = push_history_cgm(current_bg.units, bg_value, calc_raw_value, arrow_value, noise_value, reading_time);
+  if (history_entry != NULL) {
+    shift_sparkline_cgm(history_entry);
   }
   
-  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ARROW ICON, BEFORE CHECK SPEC VALUE BITMAP");
-	// check if special value set
-	if (specvalue_alert == 100) {
-	
-	  // no special value, set arrow
-      // check for arrow direction, set proper arrow icon
-	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD ICON, CURRENT ICON: %s", current_icon);
-      if ( (strcmp(current_icon, NO_ARROW) == 0) || (strcmp(current_icon, NOTCOMPUTE_ICON) == 0) || (strcmp(current_icon, OUTOFRANGE_ICON) == 0) ) {
-	    create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[NONE_ARROW_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      } 
-      else if (strcmp(current_icon, DOUBLEUP_ARROW) == 0) {
-	    create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[UPUP_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      }
-      else if (strcmp(current_icon, SINGLEUP_ARROW) == 0) {
-	    create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[UP_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      }
-      else if (strcmp(current_icon, UP45_ARROW) == 0) {
-        create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[UP45_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      }
-      else if (strcmp(current_icon, FLAT_ARROW) == 0) {
-        create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[FLAT_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      }
-      else if (strcmp(current_icon, DOWN45_ARROW) == 0) {
-	    create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[DOWN45_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      }
-      else if (strcmp(current_icon, SINGLEDOWN_ARROW) == 0) {
-        create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[DOWN_ICON_INDX]);
-	    DoubleDownAlert = 100;
-      }
-      else if (strcmp(current_icon, DOUBLEDOWN_ARROW) == 0) {
-	    if (DoubleDownAlert == 100) {
-	      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ICON, ICON ARROW: DOUBLE DOWN");
-	      alert_handler_cgm(DOUBLEDOWN_VIBE);
-	      DoubleDownAlert = 111;
-	    }
-	    create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[DOWNDOWN_ICON_INDX]);
-      } 
-      else {
-	    // check for special cases and set icon accordingly
-		// check bluetooth
-	    bluetooth_connected_cgm = bluetooth_connection_service_peek();
-        
-	    // check to see if we are in the loading screen  
-	    if (!bluetooth_connected_cgm) {
-	      // Bluetooth is out; in the loading screen so set logo
-	      create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[LOGO_ARROW_ICON_INDX]);
-	    }
-	    else {
-		  // unexpected, set logo icon
-	      create_update_bitmap(&icon_bitmap,icon_layer,ARROW_ICONS[LOGO_ARROW_ICON_INDX]);
-	    }
-	    DoubleDownAlert = 100;
-	  }
-	} // if specvalue_alert == 100
-	else { // this is just for log when need it
-	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ICON, SPEC VALUE ALERT IS TRUE, DONE");
-	} // else specvalue_alert == 111
-	
-} // end load_icon
-
-// forward declarations for animation code
-static void load_bg_delta();
-static void load_cgmtime();
-static void load_apptime();
-static void load_rig_battlevel();
-
-// ANIMATION CODE
+} // end add_history_cgm
 
-void destroy_perfectbg_animation(PropertyAnimation **perfectbg_animation) {
-  if (*perfectbg_animation == NULL) {
+static void backfill_history_cgm(const uint8_t *hist_data, const uint16_t hist_length) {
+  
+  // VARIABLES
+  const uint8_t *entry_data = NULL;
+  uint8_t entry_count = 0;
+  uint8_t bg_units = BG_UNITS_MGDL;
+  uint32_t reading_time = 0;
+  uint8_t added_count = 0;
+  
+  // CODE START
+  
+  // no header, nothing to backfill
+  if ((hist_data == NULL) || (hist_length < CGM_HIST_ENTRIES)) {
     return;
   }
-
-  if (animation_is_scheduled((Animation*) *perfectbg_animation)) {
-    animation_unschedule((Animation*) *perfectbg_animation);
+  entry_count = hist_data[CGM_HIST_COUNT];
+  bg_units = (hist_data[CGM_HIST_FLAGS] & CGM_FLAG_MMOL) ? BG_UNITS_MMOL : BG_UNITS_MGDL;
+  reading_time = read_uint32_cgm(&hist_data[CGM_HIST_BASE_TIME]);
+  
+  // don't read past the message
+  if ((CGM_HIST_ENTRIES + (entry_count * CGM_HIST_ENTRY_SIZE)) > hist_length) {
+    entry_count = (hist_length - CGM_HIST_ENTRIES) / CGM_HIST_ENTRY_SIZE;
   }
-
-  if (perfectbg_animation != NULL) {
-    property_animation_destroy(*perfectbg_animation);
+  
+  // one pass over the chunk, then one sparkline rebuild for all of it
+  for (uint8_t entry_index = 0; entry_index < entry_count; entry_index++) {
+    entry_data = &hist_data[CGM_HIST_ENTRIES + (entry_index * CGM_HIST_ENTRY_SIZE)];
+    reading_time += read_uint16_cgm(&entry_data[CGM_HIST_ENTRY_DELTA]);
+    if (push_history_cgm(bg_units, (int16_t)read_uint16_cgm(&entry_data[CGM_HIST_ENTRY_BG]), CGM_RAW_NONE, 
+                         entry_data[CGM_HIST_ENTRY_ARROW] & 0x0F, entry_data[CGM_HIST_ENTRY_ARROW] >> 4, reading_time) != NULL) {
+      added_count++;
+    }
   }
-  *perfectbg_animation = NULL;
-} // end destroy_perfectbg_animation
-
-// PERFECTBG ANIMATION
-void perfectbg_animation_started(Animation *animation, void *data) {
-
-	//APP_LOG(APP_LOG_LEVEL_INFO, "PERFECT BG ANIMATE, ANIMATION STARTED ROUTINE");
   
-	// clear out BG and icon
-  text_layer_set_text(bg_layer, " ");
-  text_layer_set_text(message_layer, "HAPPY DANCE!\0");
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "BACKFILL HISTORY, ENTRIES: %i ADDED: %i", entry_count, added_count);
   
-} // end perfectbg_animation_started
-
-void perfectbg_animation_stopped(Animation *animation, bool finished, void *data) {
-
-	//APP_LOG(APP_LOG_LEVEL_INFO, "PERFECT BG ANIMATE, ANIMATION STOPPED ROUTINE");
-	
-	// reset bg and icon
-	//APP_LOG(APP_LOG_LEVEL_DEBUG, "PERFECT BG ANIMATE, ANIMATION STOPPED, SET TO BG: %s ", last_bg);
-	text_layer_set_text(bg_layer, last_bg);
-	load_icon();
-  load_bg_delta();
-  destroy_perfectbg_animation(&perfectbg_animation);
+  if (added_count > 0) {
+    rebuild_sparkline_cgm();
+  }
   
-} // end perfectbg_animation_stopped
-
-void animate_perfectbg() {
+} // end backfill_history_cgm
 
+static void draw_sparkline_cgm(GContext *ctx, const GRect sparkline_bounds) {
+  
   // CONSTANTS
+  const uint8_t SLOT_WIDTH = 4;
   
-  // ARRAY OF ICONS FOR PERFECT BG
-  const uint8_t PERFECTBG_ICONS[] = {
-	  RESOURCE_ID_IMAGE_CLUB100,         //0
-	  RESOURCE_ID_IMAGE_CLUB55           //1
-  };
+  // VARIABLES
+  const int16_t origin_x = sparkline_bounds.origin.x;
+  const int16_t origin_y = sparkline_bounds.origin.y;
+  int16_t point_x = 0;
   
-  // INDEX FOR ARRAY OF PERFECT BG ICONS
-  static const uint8_t CLUB100_ICON_INDX = 0;
-  static const uint8_t CLUB55_ICON_INDX = 1;
+  // CODE START
   
-	// VARIABLES 
-	
-  Layer *animate_perfectbg_layer = NULL;
+  // only draws the cached points; all the BG math was done when the reading came in
+  graphics_context_set_stroke_color(ctx, GColorWhite);
   
-	// for animation
-	GRect from_perfectbg_rect = GRect(0,0,0,0);
-	GRect to_perfectbg_rect = GRect(0,0,0,0);
-
-	// CODE START
-
- if (currentBG_isMMOL == 111) { 
-    create_update_bitmap(&perfectbg_bitmap,perfectbg_layer,PERFECTBG_ICONS[CLUB55_ICON_INDX]);
+  // dotted lines for low and high
+  for (int16_t dot_x = 0; dot_x < sparkline_bounds.size.w; dot_x += SLOT_WIDTH) {
+    if (sparkline_low_y_cgm != SPARKLINE_EMPTY) {
+      graphics_draw_pixel(ctx, GPoint(origin_x + dot_x, origin_y + sparkline_low_y_cgm));
+    }
+    if (sparkline_high_y_cgm != SPARKLINE_EMPTY) {
+      graphics_draw_pixel(ctx, GPoint(origin_x + dot_x, origin_y + sparkline_high_y_cgm));
+    }
   }
-  else {
-    create_update_bitmap(&perfectbg_bitmap,perfectbg_layer,PERFECTBG_ICONS[CLUB100_ICON_INDX]);
+  
+  // newest on the right
+  for (uint8_t slot = 0; slot < HISTORY_SIZE; slot++) {
+    if (sparkline_y_cgm[slot] == SPARKLINE_EMPTY) {
+      continue;
+    }
+    point_x = origin_x + sparkline_bounds.size.w - 1 - (slot * SLOT_WIDTH);
+    if (((slot + 1) < HISTORY_SIZE) && (sparkline_y_cgm[slot + 1] != SPARKLINE_EMPTY)) {
+      graphics_draw_line(ctx, GPoint(point_x, origin_y + sparkline_y_cgm[slot]), 
+                         GPoint(point_x - SLOT_WIDTH, origin_y + sparkline_y_cgm[slot + 1]));
+    }
+    else {
+      graphics_draw_pixel(ctx, GPoint(point_x, origin_y + sparkline_y_cgm[slot]));
+    }
   }
-	animate_perfectbg_layer = bitmap_layer_get_layer(perfectbg_layer);
-	from_perfectbg_rect = GRect(144, 3, 95, 47);
-	to_perfectbg_rect = GRect(-80, 3, 95, 47);    
-	destroy_perfectbg_animation(&perfectbg_animation);
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, CREATE FRAME");
-	perfectbg_animation = property_animation_create_layer_frame(animate_perfectbg_layer, &from_perfectbg_rect, &to_perfectbg_rect);
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, SET DURATION AND CURVE");
-	animation_set_duration((Animation*) perfectbg_animation, PERFECTBG_ANIMATE_SECS*MS_IN_A_SECOND);
-	animation_set_curve((Animation*) perfectbg_animation, AnimationCurveLinear);
   
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, SET HANDLERS");
-	animation_set_handlers((Animation*) perfectbg_animation, (AnimationHandlers) {
-	  .started = (AnimationStartedHandler) perfectbg_animation_started,
-	  .stopped = (AnimationStoppedHandler) perfectbg_animation_stopped,
-	}, NULL /* callback data */);
-      
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, SCHEDULE");
-	animation_schedule((Animation*) perfectbg_animation);   
+} // end draw_sparkline_cgm
 
-} //end animate_perfectbg
+void sparkline_update_proc_cgm(Layer *layer, GContext *ctx) {
+  
+  draw_sparkline_cgm(ctx, layer_get_bounds(layer));
+  
+} // end sparkline_update_proc_cgm
 
-void destroy_happymsg_animation(PropertyAnimation **happymsg_animation) {
-  if (*happymsg_animation == NULL) {
-    return;
+// BG ranges by units, and the alert bands built from them; compiled when thresholds change, not per reading
+enum BgRangeIndex {
+  SPECVALUE_BG_INDX = 0,
+  SHOWLOW_BG_INDX = 1,
+  HYPOLOW_BG_INDX = 2,
+  BIGLOW_BG_INDX = 3,
+  MIDLOW_BG_INDX = 4,
+  LOW_BG_INDX = 5,
+  HIGH_BG_INDX = 6,
+  MIDHIGH_BG_INDX = 7,
+  BIGHIGH_BG_INDX = 8,
+  SHOWHIGH_BG_INDX = 9,
+  BG_RANGE_COUNT = 10
+};
+
+// each alert band is (bottom, top] of two BG ranges; the bands are compiled into one ascending list of
+// segment tops, so a BG is classified with one binary search instead of checking every band
+// bands only overlap if load_values leaves thresholds out of order (low above high); a segment then
+// is in more than one band and all of them alert, same as when every band was checked
+#define BG_BAND_COUNT 8
+#define BG_BAND_SEGMENTS (BG_BAND_COUNT * 2)
+#define BG_BANDS_NONE 0
+static const uint16_t BG_BAND_TOP = 1000;
+
+static uint16_t bg_ranges_cgm[BG_UNITS_COUNT][BG_RANGE_COUNT];
+
+// segment k is (bg_segment_top_cgm[k - 1], bg_segment_top_cgm[k]] and is in the alert bands set in
+// bg_segment_bands_cgm[k], bit n for band n
+static uint16_t bg_segment_top_cgm[BG_UNITS_COUNT][BG_BAND_SEGMENTS];
+static uint8_t bg_segment_bands_cgm[BG_UNITS_COUNT][BG_BAND_SEGMENTS];
+static uint8_t bg_segment_count_cgm[BG_UNITS_COUNT];
+
+// bottom and top of each alert band, and its snooze, overwrite and vibration; nothing between LOW and HIGH
+typedef struct {
+  uint8_t bottom_indx;
+  uint8_t top_indx;
+  uint8_t *snooze_min;
+  uint8_t *overwrite;
+  uint8_t *vibe;
+} BgBandAlert;
+
+// BG_RANGE_COUNT as top means BG_BAND_TOP
+static const BgBandAlert BG_BAND_ALERTS[BG_BAND_COUNT] = {
+  { BG_RANGE_COUNT, SPECVALUE_BG_INDX, &SPECVALUE_SNZ_MIN, &specvalue_overwrite, &SPECVALUE_VIBE },
+  { SPECVALUE_BG_INDX, HYPOLOW_BG_INDX, &HYPOLOW_SNZ_MIN, &hypolow_overwrite, &HYPOLOWBG_VIBE },
+  { HYPOLOW_BG_INDX, BIGLOW_BG_INDX, &BIGLOW_SNZ_MIN, &biglow_overwrite, &BIGLOWBG_VIBE },
+  { BIGLOW_BG_INDX, MIDLOW_BG_INDX, &MIDLOW_SNZ_MIN, &midlow_overwrite, &LOWBG_VIBE },
+  { MIDLOW_BG_INDX, LOW_BG_INDX, &LOW_SNZ_MIN, &low_overwrite, &LOWBG_VIBE },
+  { HIGH_BG_INDX, MIDHIGH_BG_INDX, &HIGH_SNZ_MIN, &high_overwrite, &HIGHBG_VIBE },
+  { MIDHIGH_BG_INDX, BIGHIGH_BG_INDX, &MIDHIGH_SNZ_MIN, &midhigh_overwrite, &HIGHBG_VIBE },
+  { BIGHIGH_BG_INDX, BG_RANGE_COUNT, &BIGHIGH_SNZ_MIN, &bighigh_overwrite, &BIGHIGHBG_VIBE }
+};
+
+static uint16_t bg_band_edge_cgm(const uint16_t *ranges, const uint8_t range_indx, const uint16_t missing_value) {
+  return (range_indx < BG_RANGE_COUNT) ? ranges[range_indx] : missing_value;
+} // end bg_band_edge_cgm
+
+static void compile_bg_ranges_cgm(void) {
+  
+  // VARIABLES
+  const uint16_t *ranges = NULL;
+  uint16_t *segment_top = NULL;
+  uint8_t *segment_bands = NULL;
+  uint8_t segment_count = 0;
+  uint16_t edge_value = 0;
+  uint8_t insert_index = 0;
+  
+  // CODE START
+  
+  bg_ranges_cgm[BG_UNITS_MGDL][SPECVALUE_BG_INDX] = SPECVALUE_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][SHOWLOW_BG_INDX] = SHOWLOW_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][HYPOLOW_BG_INDX] = HYPOLOW_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][BIGLOW_BG_INDX] = BIGLOW_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][MIDLOW_BG_INDX] = MIDLOW_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][LOW_BG_INDX] = LOW_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][HIGH_BG_INDX] = HIGH_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][MIDHIGH_BG_INDX] = MIDHIGH_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][BIGHIGH_BG_INDX] = BIGHIGH_BG_MGDL;
+  bg_ranges_cgm[BG_UNITS_MGDL][SHOWHIGH_BG_INDX] = SHOWHIGH_BG_MGDL;
+  
+  bg_ranges_cgm[BG_UNITS_MMOL][SPECVALUE_BG_INDX] = SPECVALUE_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][SHOWLOW_BG_INDX] = SHOWLOW_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][HYPOLOW_BG_INDX] = HYPOLOW_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][BIGLOW_BG_INDX] = BIGLOW_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][MIDLOW_BG_INDX] = MIDLOW_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][LOW_BG_INDX] = LOW_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][HIGH_BG_INDX] = HIGH_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][MIDHIGH_BG_INDX] = MIDHIGH_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][BIGHIGH_BG_INDX] = BIGHIGH_BG_MMOL;
+  bg_ranges_cgm[BG_UNITS_MMOL][SHOWHIGH_BG_INDX] = SHOWHIGH_BG_MMOL;
+  
+  for (uint8_t units = 0; units < BG_UNITS_COUNT; units++) {
+    ranges = bg_ranges_cgm[units];
+    segment_top = bg_segment_top_cgm[units];
+    segment_bands = bg_segment_bands_cgm[units];
+    segment_count = 0;
+    
+    // every band edge, sorted, no duplicates; the ranges don't have to be in order
+    for (uint8_t band = 0; band < BG_BAND_COUNT; band++) {
+      for (uint8_t edge = 0; edge < 2; edge++) {
+        edge_value = (edge == 0) ? bg_band_edge_cgm(ranges, BG_BAND_ALERTS[band].bottom_indx, 0) 
+                                 : bg_band_edge_cgm(ranges, BG_BAND_ALERTS[band].top_indx, BG_BAND_TOP);
+        insert_index = segment_count;
+        while ((insert_index > 0) && (segment_top[insert_index - 1] > edge_value)) {
+          segment_top[insert_index] = segment_top[insert_index - 1];
+          insert_index--;
+        }
+        if ((insert_index > 0) && (segment_top[insert_index - 1] == edge_value)) {
+          // already have it; undo the shift
+          memmove(&segment_top[insert_index], &segment_top[insert_index + 1], (segment_count - insert_index) * sizeof(uint16_t));
+          continue;
+        }
+        segment_top[insert_index] = edge_value;
+        segment_count++;
+      }
+    }
+    
+    // bands of each segment; every band that has its top, a segment never straddles a band edge
+    for (uint8_t segment = 0; segment < segment_count; segment++) {
+      segment_bands[segment] = BG_BANDS_NONE;
+      for (uint8_t band = 0; band < BG_BAND_COUNT; band++) {
+        if ((segment_top[segment] > bg_band_edge_cgm(ranges, BG_BAND_ALERTS[band].bottom_indx, 0)) && 
+            (segment_top[segment] <= bg_band_edge_cgm(ranges, BG_BAND_ALERTS[band].top_indx, BG_BAND_TOP))) {
+          segment_bands[segment] |= (1 << band);
+        }
+      }
+    }
+    bg_segment_count_cgm[units] = segment_count;
   }
+  
+} // end compile_bg_ranges_cgm
 
-  if (animation_is_scheduled((Animation*) *happymsg_animation)) {
-    animation_unschedule((Animation*) *happymsg_animation);
+// alert bands the BG is in, bit n for band n; BG_BANDS_NONE in range or not a BG
+static uint8_t classify_bg_bands_cgm(const uint8_t bg_units, const int bg_value) {
+  
+  // VARIABLES
+  const uint16_t *segment_top = bg_segment_top_cgm[bg_units];
+  uint8_t low_index = 0;
+  uint8_t high_index = bg_segment_count_cgm[bg_units];
+  uint8_t mid_index = 0;
+  
+  // CODE START
+  
+  // first segment top at or above the BG
+  while (low_index < high_index) {
+    mid_index = (low_index + high_index) / 2;
+    if (segment_top[mid_index] < bg_value) {
+      low_index = mid_index + 1;
+    }
+    else {
+      high_index = mid_index;
+    }
+  }
+  
+  if (low_index >= bg_segment_count_cgm[bg_units]) {
+    return BG_BANDS_NONE;
+  }
+  return bg_segment_bands_cgm[bg_units][low_index];
+  
+} // end classify_bg_bands_cgm
+
+static void load_values(const CgmSettings *settings){
+  //APP_LOG(APP_LOG_LEVEL_DEBUG,"Loaded Values, UNITS: %i LOW: %i HIGH: %i", settings->units, settings->low_bg, settings->high_bg);
+
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "lowbg: %i", settings->low_bg);
+  if (settings->units == 0){
+    LOW_BG_MGDL = settings->low_bg;
+    if (LOW_BG_MGDL < 60) {
+    	MIDLOW_BG_MGDL = 55;
+    	BIGLOW_BG_MGDL = 50;
+    	HYPOLOW_BG_MGDL = 45;
+    } else if (LOW_BG_MGDL < 70) {
+    	MIDLOW_BG_MGDL = 60;
+    	BIGLOW_BG_MGDL = 55;
+    	HYPOLOW_BG_MGDL = 50;
+    }
+  } else {
+    LOW_BG_MMOL = settings->low_bg;
+    if (LOW_BG_MMOL < 33) {
+    	MIDLOW_BG_MMOL = 31;
+    	BIGLOW_BG_MMOL = 28;
+    	HYPOLOW_BG_MMOL = 25;
+    } else if (LOW_BG_MMOL < 39) {
+    	MIDLOW_BG_MMOL = 33;
+    	BIGLOW_BG_MMOL = 31;
+    	HYPOLOW_BG_MMOL = 28;
+    }
   }
 
-  if (happymsg_animation != NULL) {
-    property_animation_destroy(*happymsg_animation);
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "highbg: %i", settings->high_bg);
+  if (settings->units == 0){
+    HIGH_BG_MGDL = settings->high_bg;
+    if (HIGH_BG_MGDL > 239) {
+      MIDHIGH_BG_MGDL = 300;
+      BIGHIGH_BG_MGDL = 350;
+    }
+  } else {
+    HIGH_BG_MMOL = settings->high_bg;
+      if (HIGH_BG_MMOL > 132) {
+       MIDHIGH_BG_MMOL = 166;
+       BIGHIGH_BG_MMOL =  200;
+      }
   }
-  *happymsg_animation = NULL;
-} // end destroy_happymsg_animation
 
-// happymsg ANIMATION
-void happymsg_animation_started(Animation *animation, void *data) {
+  LOW_SNZ_MIN = settings->low_snooze;
+  HIGH_SNZ_MIN = settings->high_snooze;
+  LOWBG_VIBE = settings->low_vibe;
+  HIGHBG_VIBE = settings->high_vibe;
+
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "vibepattern: %i", settings->vibe_pattern);
+  if (settings->vibe_pattern == 0){
+    TurnOffAllVibrations = 111;
+    TurnOffStrongVibrations = 111;
+  } else if (settings->vibe_pattern == 1){
+    TurnOffAllVibrations = 100;
+    TurnOffStrongVibrations = 111; 
+  } else if (settings->vibe_pattern == 2){
+    TurnOffAllVibrations = 100;
+    TurnOffStrongVibrations = 100;
+  }
 
-	//APP_LOG(APP_LOG_LEVEL_INFO, "HAPPY MSG ANIMATE, ANIMATION STARTED ROUTINE, CLEAR OUT BG DELTA");
+  timeformat = settings->time_format;
+
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "rawvibrate: %i", settings->raw_vibrate);
+  if (settings->raw_vibrate == 0) { TurnOffVibrationsCalcRaw = 111; }
+  else { TurnOffVibrationsCalcRaw = 100; }
   
-	// clear out BG delta / message layer
-  text_layer_set_text(message_layer, "");
-  text_layer_set_text(cgmtime_layer, "");
-  text_layer_set_text(rig_battlevel_layer, "");
-  create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);   
+  // keep these thresholds until the phone sends a new config version
+  current_cfg_version = settings->cfg_version;
   
-} // end happymsg_animation_started
+  compile_bg_ranges_cgm();
+  
+  // low and high lines on the graph moved
+  rebuild_sparkline_cgm();
+  
+} //End load_values
 
-void happymsg_animation_stopped(Animation *animation, bool finished, void *data) {
+static void destroy_null_GBitmap(GBitmap **GBmp_image) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: ENTER CODE");
+  
+  if (*GBmp_image != NULL) {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: POINTER EXISTS, DESTROY BITMAP IMAGE");
+      gbitmap_destroy(*GBmp_image);
+      perf_stats_cgm.bitmap_destroys++;
+      if (*GBmp_image != NULL) {
+        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: POINTER EXISTS, SET POINTER TO NULL");
+        *GBmp_image = NULL;
+      }
+	}
+  
+   //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL GBITMAP: EXIT CODE");
+} // end destroy_null_GBitmap
 
-	//APP_LOG(APP_LOG_LEVEL_INFO, "HAPPY MSG ANIMATE, ANIMATION STOPPED ROUTINE");
+static void destroy_null_BitmapLayer(BitmapLayer **bmp_layer) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: ENTER CODE");
 	
-	// set BG delta / message layer
-	//APP_LOG(APP_LOG_LEVEL_DEBUG, "HAPPY MSG ANIMATE, ANIMATION STOPPED, SET TO BG DELTA);
-  load_bg_delta();
-  load_cgmtime();
-  load_apptime();
-  load_rig_battlevel();
-  destroy_happymsg_animation(&happymsg_animation);
-  
-} // end happymsg_animation_stopped
+	if (*bmp_layer != NULL) {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: POINTER EXISTS, DESTROY BITMAP LAYER");
+      bitmap_layer_destroy(*bmp_layer);
+      if (*bmp_layer != NULL) {
+        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: POINTER EXISTS, SET POINTER TO NULL");
+        *bmp_layer = NULL;
+      }
+	}
 
-void animate_happymsg(char *happymsg_to_display) {
+  //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL BITMAP: EXIT CODE");
+} // end destroy_null_BitmapLayer
 
-  // CONSTANTS
-  const uint8_t HAPPYMSG_BUFFER_SIZE = 30;
+static void destroy_null_TextLayer(TextLayer **txt_layer) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: ENTER CODE");
+	
+	if (*txt_layer != NULL) {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: POINTER EXISTS, DESTROY TEXT LAYER");
+      text_layer_destroy(*txt_layer);
+      if (*txt_layer != NULL) {
+        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: POINTER EXISTS, SET POINTER TO NULL");
+        *txt_layer = NULL;
+      }
+	}
+//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL TEXT LAYER: EXIT CODE");
+} // end destroy_null_TextLayer
+
+static void destroy_null_InverterLayer(InverterLayer **inv_layer) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: ENTER CODE");
+	
+	if (*inv_layer != NULL) {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: POINTER EXISTS, DESTROY INVERTER LAYER");
+      inverter_layer_destroy(*inv_layer);
+      if (*inv_layer != NULL) {
+        //APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: POINTER EXISTS, SET POINTER TO NULL");
+        *inv_layer = NULL;
+      }
+	}
+//APP_LOG(APP_LOG_LEVEL_INFO, "DESTROY NULL INVERTER LAYER: EXIT CODE");
+} // end destroy_null_InverterLayer
+
+static uint32_t get_time_ms_cgm() {
   
-	// VARIABLES 
-  Layer *animate_happymsg_layer = NULL;
+  // VARIABLES
+  time_t time_secs = 0;
+  uint16_t time_millis = 0;
   
-	// for animation
-	GRect from_happymsg_rect = GRect(0,0,0,0);
-	GRect to_happymsg_rect = GRect(0,0,0,0);
+  // CODE START
+  
+  time_ms(&time_secs, &time_millis);
+  return ((uint32_t)time_secs * MS_IN_A_SECOND) + time_millis;
+  
+} // end get_time_ms_cgm
 
-  static char animate_happymsg_buffer[30] = {0};
+void timer_callback_cgm(void *data);
+void BT_timer_callback(void *data);
+void retry_timer_callback_cgm(void *data);
+void wheel_timer_callback_cgm(void *data);
+
+// same order as enum WatchTimer
+static const AppTimerCallback WATCH_TIMER_CALLBACKS[WATCH_TIMER_COUNT] = {
+  timer_callback_cgm,
+  BT_timer_callback,
+  retry_timer_callback_cgm
+};
+
+static void arm_wheel_cgm(void) {
   
-	// CODE START
+  // VARIABLES
+  uint32_t now_ms = get_time_ms_cgm();
+  uint32_t next_deadline_ms = 0;
+  uint8_t have_deadline = 100;
+  int32_t delay_ms = 0;
+  
+  // CODE START
+  
+  // earliest deadline is the only wakeup; the ms clock wraps, so compare differences
+  for (uint8_t timer_index = 0; timer_index < WATCH_TIMER_COUNT; timer_index++) {
+    if ((watch_timers_cgm[timer_index].armed == 111) && 
+        ((have_deadline == 100) || ((int32_t)(watch_timers_cgm[timer_index].deadline_ms - next_deadline_ms) < 0))) {
+      next_deadline_ms = watch_timers_cgm[timer_index].deadline_ms;
+      have_deadline = 111;
+    }
+  }
+  
+  if (have_deadline == 100) {
+    if (wheel_timer_cgm != NULL) {
+      app_timer_cancel(wheel_timer_cgm);
+      wheel_timer_cgm = NULL;
+    }
+    return;
+  }
+  
+  if ((wheel_timer_cgm != NULL) && (wheel_deadline_ms == next_deadline_ms)) {
+    // already set for it
+    return;
+  }
+  
+  delay_ms = (int32_t)(next_deadline_ms - now_ms);
+  if (delay_ms < 1) {
+    delay_ms = 1;
+  }
+  wheel_deadline_ms = next_deadline_ms;
+  if ((wheel_timer_cgm == NULL) || (!app_timer_reschedule(wheel_timer_cgm, delay_ms))) {
+    wheel_timer_cgm = app_timer_register(delay_ms, wheel_timer_callback_cgm, NULL);
+  }
+  
+} // end arm_wheel_cgm
 
-  //APP_LOG(APP_LOG_LEVEL_DEBUG, "ANIMATE HAPPY MSG, STRING PASSED: %s", happymsg_to_display);
-  strncpy(animate_happymsg_buffer, happymsg_to_display, HAPPYMSG_BUFFER_SIZE);
-	text_layer_set_text(happymsg_layer, animate_happymsg_buffer);
-  //APP_LOG(APP_LOG_LEVEL_DEBUG, "ANIMATE HAPPY MSG, MSG IN BUFFER: %s", animate_happymsg_buffer);
-  animate_happymsg_layer = text_layer_get_layer(happymsg_layer);
-	from_happymsg_rect = GRect(144, 33, 144, 55);
-	to_happymsg_rect = GRect(-144, 33, 144, 55); 
-	destroy_happymsg_animation(&happymsg_animation);
-	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, CREATE FRAME");
-	happymsg_animation = property_animation_create_layer_frame(animate_happymsg_layer, &from_happymsg_rect, &to_happymsg_rect);
-	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, SET DURATION AND CURVE");
-	animation_set_duration((Animation*) happymsg_animation, HAPPYMSG_ANIMATE_SECS*MS_IN_A_SECOND);
-	animation_set_curve((Animation*) happymsg_animation, AnimationCurveLinear);
+static void schedule_timer_cgm(const uint8_t timer_id, const uint32_t delay_ms, const uint32_t slack_ms) {
   
-	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, SET HANDLERS");
-	animation_set_handlers((Animation*) happymsg_animation, (AnimationHandlers) {
-	  .started = (AnimationStartedHandler) happymsg_animation_started,
-	  .stopped = (AnimationStoppedHandler) happymsg_animation_stopped,
-	}, NULL /* callback data */);
-      
-	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, SCHEDULE");
-	animation_schedule((Animation*) happymsg_animation);   
+  // a timer is either armed once or not at all; scheduling again moves it
+  watch_timers_cgm[timer_id].deadline_ms = get_time_ms_cgm() + delay_ms;
+  watch_timers_cgm[timer_id].slack_ms = slack_ms;
+  watch_timers_cgm[timer_id].armed = 111;
+  arm_wheel_cgm();
+  
+} // end schedule_timer_cgm
 
-} //end animate_happymsg
+static void cancel_timer_cgm(const uint8_t timer_id) {
+  
+  if (watch_timers_cgm[timer_id].armed == 100) {
+    return;
+  }
+  watch_timers_cgm[timer_id].armed = 100;
+  arm_wheel_cgm();
+  
+} // end cancel_timer_cgm
 
-void bg_vibrator (uint16_t BG_BOTTOM_INDX, uint16_t BG_TOP_INDX, uint8_t BG_SNOOZE, uint8_t *bg_overwrite, uint8_t BG_VIBE) {
+static uint8_t timer_armed_cgm(const uint8_t timer_id) {
+  
+  return (watch_timers_cgm[timer_id].armed == 111) ? 111 : 100;
+  
+} // end timer_armed_cgm
 
-      // VARIABLES
+static void run_due_timers_cgm(void) {
+  
+  // VARIABLES
+  uint32_t now_ms = get_time_ms_cgm();
+  uint8_t due_timers = 0;
   
-      uint16_t conv_vibrator_bg = 180;
+  // CODE START
+  
+  // everything due, or due within its slack, goes on this wakeup
+  // disarm first; a callback can schedule its own timer again
+  for (uint8_t timer_index = 0; timer_index < WATCH_TIMER_COUNT; timer_index++) {
+    if ((watch_timers_cgm[timer_index].armed == 111) && 
+        ((int32_t)(watch_timers_cgm[timer_index].deadline_ms - watch_timers_cgm[timer_index].slack_ms - now_ms) <= 0)) {
+      watch_timers_cgm[timer_index].armed = 100;
+      due_timers |= (1 << timer_index);
+    }
+  }
+  
+  for (uint8_t timer_index = 0; timer_index < WATCH_TIMER_COUNT; timer_index++) {
+    if (due_timers & (1 << timer_index)) {
+      perf_stats_cgm.timer_fires++;
+      WATCH_TIMER_CALLBACKS[timer_index](NULL);
+    }
+  }
+  
+  arm_wheel_cgm();
+  
+} // end run_due_timers_cgm
 
-      conv_vibrator_bg = current_bg;
+void wheel_timer_callback_cgm(void *data) {
   
-      // adjust high bg for comparison, if needed
-      if ( ((currentBG_isMMOL == 111) && (current_bg >= HIGH_BG_MGDL))
-        || ((currentBG_isMMOL == 100) && (current_bg >= HIGH_BG_MMOL)) ) {
-        conv_vibrator_bg = current_bg + 1;
-      }
+  wheel_timer_cgm = NULL;
+  perf_stats_cgm.timer_wakeups++;
+  run_due_timers_cgm();
   
-      // check BG and vibrate if needed
-      //APP_LOG(APP_LOG_LEVEL_INFO, "BG VIBRATOR, CHECK TO SEE IF WE NEED TO VIBRATE");
-      if ( ( ((conv_vibrator_bg > BG_BOTTOM_INDX) && (conv_vibrator_bg <= BG_TOP_INDX))
-          && ((lastAlertTime == 0) || (lastAlertTime > BG_SNOOZE)) )
-		    || ( ((conv_vibrator_bg > BG_BOTTOM_INDX) && (conv_vibrator_bg <= BG_TOP_INDX)) && (*bg_overwrite == 100) ) ) {
-      
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "lastAlertTime SNOOZE VALUE IN: %i", lastAlertTime);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "bg_overwrite IN: %i", *bg_overwrite);
-     
-        // send alert and handle a bouncing connection
-        if ((lastAlertTime == 0) || (*bg_overwrite == 100)) { 
-        //APP_LOG(APP_LOG_LEVEL_INFO, "BG VIBRATOR: VIBRATE");
-          alert_handler_cgm(BG_VIBE);        
-          // don't know where we are coming from, so reset last alert time no matter what
-          // set to 1 to prevent bouncing connection
-          lastAlertTime = 1;
-         if (*bg_overwrite == 100) { *bg_overwrite = 111; }
-        }
-      
-        // if hit snooze, reset snooze counter; will alert next time around
-        if (lastAlertTime > BG_SNOOZE) { 
-          lastAlertTime = 0;
-          specvalue_overwrite = 100;
-          hypolow_overwrite = 100;
-          biglow_overwrite = 100;
-          midlow_overwrite = 100;
-          low_overwrite = 100;
-          midhigh_overwrite = 100;
-          bighigh_overwrite = 100;
-          //APP_LOG(APP_LOG_LEVEL_INFO, "BG VIBRATOR, OVERWRITE RESET");
-        }
-      
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "BG VIBRATOR, lastAlertTime SNOOZE VALUE OUT: %i", lastAlertTime);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "BG VIBRATOR, bg_overwrite OUT: %i", *bg_overwrite);
-      } 
+} // end wheel_timer_callback_cgm
 
-} // end bg_vibrator	  
-	  
-static void load_bg() {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, FUNCTION START");
-	
-	// CONSTANTS
-  const uint8_t BG_BUFFER_SIZE = 6;
+static uint16_t bt_alert_wait_secs_cgm() {
   
-	// ARRAY OF BG CONSTANTS; MGDL
-	uint16_t BG_MGDL[] = {
-	  SPECVALUE_BG_MGDL,	//0
-	  SHOWLOW_BG_MGDL,		//1
-	  HYPOLOW_BG_MGDL,		//2
-	  BIGLOW_BG_MGDL,		//3
-	  MIDLOW_BG_MGDL,		//4
-	  LOW_BG_MGDL,			//5
-	  HIGH_BG_MGDL,			//6
-	  MIDHIGH_BG_MGDL,		//7
-	  BIGHIGH_BG_MGDL,		//8
-	  SHOWHIGH_BG_MGDL		//9
-	};
-	
-	// ARRAY OF BG CONSTANTS; MMOL
-	uint16_t BG_MMOL[] = {
-	  SPECVALUE_BG_MMOL,	//0
-	  SHOWLOW_BG_MMOL,		//1
-	  HYPOLOW_BG_MMOL,		//2
-	  BIGLOW_BG_MMOL,		//3
-	  MIDLOW_BG_MMOL,		//4
-	  LOW_BG_MMOL,			//5
-	  HIGH_BG_MMOL,			//6
-	  MIDHIGH_BG_MMOL,		//7
-	  BIGHIGH_BG_MMOL,		//8
-	  SHOWHIGH_BG_MMOL		//9
-	};
-    
-	// INDEX FOR ARRAYS OF BG CONSTANTS
-	const uint8_t SPECVALUE_BG_INDX = 0;
-	const uint8_t SHOWLOW_BG_INDX = 1;
-	const uint8_t HYPOLOW_BG_INDX = 2;
-	const uint8_t BIGLOW_BG_INDX = 3;
-	const uint8_t MIDLOW_BG_INDX = 4;
-	const uint8_t LOW_BG_INDX = 5;
-	const uint8_t HIGH_BG_INDX = 6;
-	const uint8_t MIDHIGH_BG_INDX = 7;
-	const uint8_t BIGHIGH_BG_INDX = 8;
-	const uint8_t SHOWHIGH_BG_INDX = 9;
-	
-	// MG/DL SPECIAL VALUE CONSTANTS ACTUAL VALUES
-	// mg/dL = mmol / .0555 OR mg/dL = mmol * 18.0182
-	const uint8_t SENSOR_NOT_ACTIVE_VALUE_MGDL = 1;		// show stop light, ?SN
-	const uint8_t MINIMAL_DEVIATION_VALUE_MGDL = 2; 		// show stop light, ?MD
-	const uint8_t NO_ANTENNA_VALUE_MGDL = 3; 			// show broken antenna, ?NA 
-	const uint8_t SENSOR_NOT_CALIBRATED_VALUE_MGDL = 5;	// show blood drop, ?NC
-	const uint8_t STOP_LIGHT_VALUE_MGDL = 6;				// show stop light, ?CD
-	const uint8_t HOURGLASS_VALUE_MGDL = 9;				// show hourglass, hourglass
-	const uint8_t QUESTION_MARKS_VALUE_MGDL = 10;		// show ???, ???
-	const uint8_t BAD_RF_VALUE_MGDL = 12;				// show broken antenna, ?RF
+  // VARIABLES
+  uint8_t wait_steps = bt_stats_cgm.recent_flaps;
+  
+  // CODE START
+  
+  if (wait_steps > BT_FLAP_WAIT_STEPS_MAX) {
+    wait_steps = BT_FLAP_WAIT_STEPS_MAX;
+  }
+  return BT_ALERT_WAIT_SECS * (1 + wait_steps);
+  
+} // end bt_alert_wait_secs_cgm
 
-	// MMOL SPECIAL VALUE CONSTANTS ACTUAL VALUES
-	// mmol = mg/dL / 18.0182 OR mmol = mg/dL * .0555
-	const uint8_t SENSOR_NOT_ACTIVE_VALUE_MMOL = 1;		// show stop light, ?SN (.06 -> .1)
-	const uint8_t MINIMAL_DEVIATION_VALUE_MMOL = 1;		// show stop light, ?MD (.11 -> .1)
-	const uint8_t NO_ANTENNA_VALUE_MMOL = 2;				// show broken antenna, ?NA (.17 -> .2)
-	const uint8_t SENSOR_NOT_CALIBRATED_VALUE_MMOL = 3;	// show blood drop, ?NC (.28 -> .3)
-	const uint8_t STOP_LIGHT_VALUE_MMOL = 4;				// show stop light, ?CD (.33 -> .3, set to .4 here)
-	const uint8_t HOURGLASS_VALUE_MMOL = 5;				// show hourglass, hourglass (.50 -> .5)
-	const uint8_t QUESTION_MARKS_VALUE_MMOL = 6;			// show ???, ??? (.56 -> .6)
-	const uint8_t BAD_RF_VALUE_MMOL = 7;					// show broken antenna, ?RF (.67 -> .7)
-	
-	// ARRAY OF SPECIAL VALUES CONSTANTS; MGDL
-	uint8_t SPECVALUE_MGDL[] = {
-	  SENSOR_NOT_ACTIVE_VALUE_MGDL,		//0	
-	  MINIMAL_DEVIATION_VALUE_MGDL,		//1
-	  NO_ANTENNA_VALUE_MGDL,			//2
-	  SENSOR_NOT_CALIBRATED_VALUE_MGDL,	//3
-	  STOP_LIGHT_VALUE_MGDL,			//4
-	  HOURGLASS_VALUE_MGDL,				//5
-	  QUESTION_MARKS_VALUE_MGDL,		//6
-	  BAD_RF_VALUE_MGDL					//7
-	};
-	
-	// ARRAY OF SPECIAL VALUES CONSTANTS; MMOL
-	uint8_t SPECVALUE_MMOL[] = {
-	  SENSOR_NOT_ACTIVE_VALUE_MMOL,		//0	
-	  MINIMAL_DEVIATION_VALUE_MMOL,		//1
-	  NO_ANTENNA_VALUE_MMOL,			//2
-	  SENSOR_NOT_CALIBRATED_VALUE_MMOL,	//3
-	  STOP_LIGHT_VALUE_MMOL,			//4
-	  HOURGLASS_VALUE_MMOL,				//5
-	  QUESTION_MARKS_VALUE_MMOL,		//6
-	  BAD_RF_VALUE_MMOL					//7
-	};
-	
-	// INDEX FOR ARRAYS OF SPECIAL VALUES CONSTANTS
-	const uint8_t SENSOR_NOT_ACTIVE_VALUE_INDX = 0;
-	const uint8_t MINIMAL_DEVIATION_VALUE_INDX = 1;
-	const uint8_t NO_ANTENNA_VALUE_INDX = 2;
-	const uint8_t SENSOR_NOT_CALIBRATED_VALUE_INDX = 3;
-	const uint8_t STOP_LIGHT_VALUE_INDX = 4;
-	const uint8_t HOURGLASS_VALUE_INDX = 5;
-	const uint8_t QUESTION_MARKS_VALUE_INDX = 6;
-	const uint8_t BAD_RF_VALUE_INDX = 7;
- 
-	// VARIABLES 
+static void log_perf_stats_cgm() {
   
-	// pointers to be used to MGDL or MMOL values for parsing
-	uint16_t *bg_ptr = NULL;
-	uint8_t *specvalue_ptr = NULL;
+  // VARIABLES
+  unsigned long fixed_requests = 0;
+  unsigned long elapsed_secs = 0;
+  
+  // CODE START
+  
+  if (TurnOnPerfStats == 100) {
+    return;
+  }
+  
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, MSGS: %i CPU MS: %lu PER MSG: %lu", 
+          perf_stats_cgm.messages, perf_stats_cgm.cpu_ms, 
+          (perf_stats_cgm.messages == 0) ? 0 : (perf_stats_cgm.cpu_ms / perf_stats_cgm.messages));
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, BMP CREATE: %i BMP DESTROY: %i", 
+          perf_stats_cgm.bitmap_creates, perf_stats_cgm.bitmap_destroys);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, TEXT DRAWS: %i SKIPPED: %i BMP DRAWS: %i SKIPPED: %i", 
+          perf_stats_cgm.text_draws, perf_stats_cgm.text_draws_skipped, 
+          perf_stats_cgm.bitmap_draws, perf_stats_cgm.bitmap_draws_skipped);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, ICON CACHE HITS: %i MISSES: %i", 
+          perf_stats_cgm.icon_cache_hits, perf_stats_cgm.icon_cache_misses);
+  
+  // every request avoided is one wakeup, two radio messages and one HTTP call avoided
+  elapsed_secs = time(NULL) - fetch_start_time_cgm;
+  fixed_requests = elapsed_secs / WATCH_MSGSEND_SECS;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, FETCH REQS: %i FIXED RATE: %lu AVOIDED: %li NEW READINGS: %i LATENCY EST: %i", 
+          perf_stats_cgm.fetch_requests, fixed_requests, (long)fixed_requests - perf_stats_cgm.fetch_requests,
+          perf_stats_cgm.fetch_new_readings, fetch_latency_est_secs);
+  
+  // the minute tick is 60 more wakeups an hour; timers due near it fire on it
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, TIMER WAKEUPS: %i PER HOUR: %lu TIMERS FIRED: %i", 
+          perf_stats_cgm.timer_wakeups, 
+          (elapsed_secs == 0) ? 0 : ((unsigned long)perf_stats_cgm.timer_wakeups * HOURAGO) / elapsed_secs, 
+          perf_stats_cgm.timer_fires);
+  
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, BT DISCONNECTS: %i FLAPS: %i RECENT: %i LAST UP SECS: %lu LAST DOWN SECS: %lu ALERT WAIT: %i", 
+          bt_stats_cgm.disconnects, bt_stats_cgm.flaps, bt_stats_cgm.recent_flaps, 
+          bt_stats_cgm.last_up_secs, bt_stats_cgm.last_down_secs, bt_alert_wait_secs_cgm());
+  
+  // only the errors we have seen
+  for (uint8_t result_index = 1; result_index < APPMSG_RESULT_BITS; result_index++) {
+    if (perf_stats_cgm.appmsg_errors[result_index] != 0) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, APPMSG ERR: %s COUNT: %i", 
+              translate_app_error((AppMessageResult)(1u << result_index)), perf_stats_cgm.appmsg_errors[result_index]);
+    }
+  }
+  
+} // end log_perf_stats_cgm
 
-  // happy message; max message 24 characters
-  // DO NOT GO OVER 24 CHARACTERS, INCLUDING SPACES OR YOU WILL CRASH
-  // YOU HAVE BEEN WARNED
-	char happymsg_buffer65[26] = "TIME TO DIA BEAT*THIS!\0";
-	char happymsg_buffer83[26] = "PEDAL TO THE METAL! CK83\0";
-	char happymsg_buffer143[26] = "YOUR PEBBLE LOVES U TOO\0";
-  char happymsg_buffer107[26] = "TEAM NN RACING 4*THE*WIN\0";
-	char happymsg_buffer116[26] = "VICTORY LANE! RYAN REED\0";
-	char happymsg_buffer207[26] = "HILO HILO OFF 2TEST U GO\0";
-  char happymsg_buffer314[26] = "NO MORE PIE FOR*YOU\0";
+static uint32_t text_hash_cgm(const char *text) {
   
-	// CODE START
+  // VARIABLES
+  uint32_t text_hash = 2166136261u;
   
-	// if special value set, erase anything in the icon field
-	if (specvalue_alert == 111) {
-	  create_update_bitmap(&specialvalue_bitmap,icon_layer,SPECIAL_VALUE_ICONS[NONE_SPECVALUE_ICON_INDX]);
+  // CODE START
+  
+  // FNV-1a
+  while (*text != '\0') {
+    text_hash = (text_hash ^ (uint8_t)*text) * 16777619u;
+    text++;
+  }
+  return text_hash;
+  
+} // end text_hash_cgm
+
+static void mark_face_dirty_cgm(const uint8_t face_id) {
+  
+  // layer mode redraws just that layer; canvas mode has to redraw the canvas, but only once per handler
+  if (face_layers_cgm[face_id] != NULL) {
+    layer_mark_dirty(face_layers_cgm[face_id]);
+  }
+  else if (face_canvas_layer_cgm != NULL) {
+    layer_mark_dirty(face_canvas_layer_cgm);
+  }
+  
+} // end mark_face_dirty_cgm
+
+static void set_face_hidden_cgm(const uint8_t face_id, const bool hide_face) {
+  
+  // VARIABLES
+  uint8_t new_hidden = (hide_face ? 111 : 100);
+  
+  // CODE START
+  
+  if (face_view_cgm.hidden[face_id] == new_hidden) {
+    return;
+  }
+  face_view_cgm.hidden[face_id] = new_hidden;
+  
+  if (face_layers_cgm[face_id] != NULL) {
+    layer_set_hidden(face_layers_cgm[face_id], hide_face);
+  }
+  else {
+    mark_face_dirty_cgm(face_id);
+  }
+  
+} // end set_face_hidden_cgm
+
+static void update_text_layer(const uint8_t face_id, const char *new_text) {
+  
+  // VARIABLES
+  uint32_t new_text_hash = text_hash_cgm(new_text);
+  
+  // CODE START
+  
+  // same buffer with the same text; buffers are written in place, so the pointer alone isn't enough
+  if ((face_view_cgm.text[face_id] == new_text) && (face_view_cgm.text_hash[face_id] == new_text_hash)) {
+    perf_stats_cgm.text_draws_skipped++;
+    return;
+  }
+  
+  face_view_cgm.text[face_id] = new_text;
+  face_view_cgm.text_hash[face_id] = new_text_hash;
+  perf_stats_cgm.text_draws++;
+  
+  // " " (space) is how every field is blanked; an optional layer with nothing to show isn't kept around
+  if (FACE_LAYOUT[face_id].optional == 111) {
+    if ((new_text[0] == '\0') || ((new_text[0] == ' ') && (new_text[1] == '\0'))) {
+      release_face_layer_cgm(face_id);
+    }
+    else {
+      ensure_face_layer_cgm(face_id);
+    }
+  }
+  
+  if (face_text_layers_cgm[face_id] != NULL) {
+    text_layer_set_text(face_text_layers_cgm[face_id], new_text);
+  }
+  else {
+    mark_face_dirty_cgm(face_id);
+  }
+  
+} // end update_text_layer
+
+static void update_text_layer_buffer(const uint8_t face_id, char *layer_text, const char *new_text, const uint8_t layer_text_size) {
+  
+  // layer_text is the buffer the face shows; update_text_layer skips the draw if the text is the same
+  strncpy(layer_text, new_text, layer_text_size);
+  update_text_layer(face_id, layer_text);
+  
+} // end update_text_layer_buffer
+
+static GBitmap* get_cached_bitmap(const uint8_t icon_id) {
+  
+  // CODE START
+  
+  if (icon_id >= ICON_ATLAS_COUNT) {
+    // not an atlas icon, should never happen; don't crash
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "ICON CACHE, UNKNOWN ICON: %i", icon_id);
+    return NULL;
+  }
+  
+  if (icon_cache_cgm[icon_id] != NULL) {
+    perf_stats_cgm.icon_cache_hits++;
+    return icon_cache_cgm[icon_id];
+  }
+  
+  // not in the cache, make a view into the atlas; no resource load here
+  perf_stats_cgm.icon_cache_misses++;
+  if (icon_atlas_bitmap == NULL) {
+    // couldn't load atlas at window load, return so don't crash
+    return NULL;
+  }
+  
+  icon_cache_cgm[icon_id] = gbitmap_create_as_sub_bitmap(icon_atlas_bitmap, ICON_ATLAS_RECTS[icon_id]);
+  if (icon_cache_cgm[icon_id] != NULL) {
+    perf_stats_cgm.bitmap_creates++;
+  }
+  
+  return icon_cache_cgm[icon_id];
+  
+} // end get_cached_bitmap
+
+static void destroy_icon_cache() {
+  
+  // destroy the sub bitmaps before the atlas they point into
+  for (uint8_t icon_id = 0; icon_id < ICON_ATLAS_COUNT; icon_id++) {
+    destroy_null_GBitmap(&icon_cache_cgm[icon_id]);
+  }
+  destroy_null_GBitmap(&icon_atlas_bitmap);
+  
+} // end destroy_icon_cache
+
+static void create_update_bitmap(const uint8_t face_id, const uint8_t icon_id) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: ENTER CODE");
+  
+  // VARIABLES
+  GBitmap *cached_bitmap = NULL;
+  
+  // CODE START
+  
+  // bitmaps are owned by the icon cache; the face view model only tracks what each element is showing
+  cached_bitmap = get_cached_bitmap(icon_id);
+  
+	if (cached_bitmap == NULL) {
+      // couldn't create bitmap, return so don't crash
+    //APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: COULDNT CREATE BITMAP, RETURN");
+      return;
+	}
+  
+  // optional layers are made on first use; a new one starts with what the view model has
+  if (FACE_LAYOUT[face_id].optional == 111) {
+    ensure_face_layer_cgm(face_id);
+  }
+  
+	if (face_view_cgm.bitmap[face_id] == cached_bitmap) {
+      // same icon already showing, nothing to do
+      perf_stats_cgm.bitmap_draws_skipped++;
+      return;
 	}
+  
+  // set bitmap
+  //APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: SET BITMAP");
+  face_view_cgm.bitmap[face_id] = cached_bitmap;
+  perf_stats_cgm.bitmap_draws++;
+  if (face_bitmap_layers_cgm[face_id] != NULL) {
+    bitmap_layer_set_bitmap(face_bitmap_layers_cgm[face_id], cached_bitmap);
+  }
+  else {
+    mark_face_dirty_cgm(face_id);
+  }
+  
+	//APP_LOG(APP_LOG_LEVEL_INFO, " CREATE UPDATE BITMAP: EXIT CODE");
+} // end create_update_bitmap
+
+static void alert_handler_cgm(uint8_t alertValue) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER");
+	//APP_LOG(APP_LOG_LEVEL_DEBUG, "ALERT CODE: %d", alertValue);
 	
-	// set special value alert to zero no matter what
-	specvalue_alert = 100;
+	// CONSTANTS
+	// constants for vibrations patterns; has to be uint32_t, measured in ms, maximum duration 10000ms
+	// Vibe pattern: ON, OFF, ON, OFF; ON for 500ms, OFF for 100ms, ON for 100ms; 
+	
+	// CURRENT PATTERNS
+	static const uint32_t highalert_fast[] = { 300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300,100,50,100,300 };
+	static const uint32_t medalert_long[] = { 500,100,100,100,500,100,100,100,500,100,100,100,500,100,100,100,500 };
+	static const uint32_t lowalert_beebuzz[] = { 75,50,50,50,75,50,50,50,75,50,50,50,75,50,50,50,75,50,50,50,75,50,50,50,75 };
+	
+	// PATTERN DURATION
+	const uint8_t HIGHALERT_FAST_STRONG = 33;
+	const uint8_t HIGHALERT_FAST_SHORT = (33/2);
+	const uint8_t MEDALERT_LONG_STRONG = 17;
+	const uint8_t MEDALERT_LONG_SHORT = (17/2);
+	const uint8_t LOWALERT_BEEBUZZ_STRONG = 25;
+	const uint8_t LOWALERT_BEEBUZZ_SHORT = (25/2);
   
-    // see if we're doing MGDL or MMOL; get currentBG_isMMOL value in myBGAtoi
-	  // convert BG value from string to int
-	  
-	  // FOR TESTING ONLY
-    //strncpy(last_bg, "10", BG_BUFFER_SIZE);
+	// CODE START
 	
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, BGATOI IN, CURRENT_BG: %d LAST_BG: %s ", current_bg, last_bg);
-    current_bg = myBGAtoi(last_bg);
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, BG ATOI OUT, CURRENT_BG: %d LAST_BG: %s ", current_bg, last_bg);
-    
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LAST BG: %s", last_bg);
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "CURRENT BG: %i", current_bg);
-    
-  if (currentBG_isMMOL == 100) {
-	  bg_ptr = BG_MGDL;
-	  specvalue_ptr = SPECVALUE_MGDL;
+	if ( (TurnOffAllVibrations == 111) || (HardCodeNoVibrations == 111) || (RestoringState == 111) ) {
+      //turn off all vibrations is set, or drawing restored values, return out here
+      return;
 	}
-	else {
-	  bg_ptr = BG_MMOL;
-	  specvalue_ptr = SPECVALUE_MMOL;
-    }
 	
-    // BG parse, check snooze, and set text 
-      
-    // check for init code or error code
-    if ((current_bg <= 0) || (last_bg[0] == '-')) {
-      lastAlertTime = 0;
-      
-      // check bluetooth
-      bluetooth_connected_cgm = bluetooth_connection_service_peek();
-      
-      if (!bluetooth_connected_cgm) {
-	    // Bluetooth is out; set BT message
-		//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, BG INIT: NO BT, SET NO BT MESSAGE");
-		if (TurnOff_NOBLUETOOTH_Msg == 100) {
-		  text_layer_set_text(message_layer, "NO BLUETOOTH");
-		} // if turnoff nobluetooth msg
-      }// if !bluetooth connected
-      else {
-	    // if init code, we will set it right in message layer
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, UNEXPECTED BG: SET ERR ICON");
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, UNEXP BG, CURRENT_BG: %d LAST_BG: %s ", current_bg, last_bg);
-        text_layer_set_text(bg_layer, "ERR");
-        create_update_bitmap(&icon_bitmap,icon_layer,SPECIAL_VALUE_ICONS[NONE_SPECVALUE_ICON_INDX]);
-        specvalue_alert = 111;
-      }
-      
-	} // if current_bg <= 0
-	  
-    else {
-      // valid BG
-      
-	  // check for special value, if special value, then replace icon and blank BG; else send current BG  
-	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, BEFORE CREATE SPEC VALUE BITMAP");
-	  if ((current_bg == specvalue_ptr[NO_ANTENNA_VALUE_INDX]) || (current_bg == specvalue_ptr[BAD_RF_VALUE_INDX])) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET BROKEN ANTENNA");
-	    text_layer_set_text(bg_layer, "");
-	    create_update_bitmap(&specialvalue_bitmap,icon_layer, SPECIAL_VALUE_ICONS[BROKEN_ANTENNA_ICON_INDX]);
-	    specvalue_alert = 111;
-	  }
-	  else if (current_bg == specvalue_ptr[SENSOR_NOT_CALIBRATED_VALUE_INDX]) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET BLOOD DROP");
-	    text_layer_set_text(bg_layer, "");
-	    create_update_bitmap(&specialvalue_bitmap,icon_layer,SPECIAL_VALUE_ICONS[BLOOD_DROP_ICON_INDX]);
-	    specvalue_alert = 111;        
-	  }
-	  else if ((current_bg == specvalue_ptr[SENSOR_NOT_ACTIVE_VALUE_INDX]) || (current_bg == specvalue_ptr[MINIMAL_DEVIATION_VALUE_INDX]) 
-	        || (current_bg == specvalue_ptr[STOP_LIGHT_VALUE_INDX])) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET STOP LIGHT");
-	    text_layer_set_text(bg_layer, "");
-	    create_update_bitmap(&specialvalue_bitmap,icon_layer,SPECIAL_VALUE_ICONS[STOP_LIGHT_ICON_INDX]);
-	    specvalue_alert = 111;
-	  }
-	  else if (current_bg == specvalue_ptr[HOURGLASS_VALUE_INDX]) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET HOUR GLASS");
-	    text_layer_set_text(bg_layer, "");
-	    create_update_bitmap(&specialvalue_bitmap,icon_layer,SPECIAL_VALUE_ICONS[HOURGLASS_ICON_INDX]);
-	    specvalue_alert = 111;
-	  }
-	  else if (current_bg == specvalue_ptr[QUESTION_MARKS_VALUE_INDX]) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET QUESTION MARKS, CLEAR TEXT");
-	    text_layer_set_text(bg_layer, "");
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET QUESTION MARKS, SET BITMAP");
-	    create_update_bitmap(&specialvalue_bitmap,icon_layer,SPECIAL_VALUE_ICONS[QUESTION_MARKS_ICON_INDX]); 
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET QUESTION MARKS, DONE");
-	    specvalue_alert = 111;
-	  }
-	  else if (current_bg < bg_ptr[SPECVALUE_BG_INDX]) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, UNEXPECTED SPECIAL VALUE: SET LOGO ICON");
-	    text_layer_set_text(bg_layer, "");
-	    create_update_bitmap(&specialvalue_bitmap,icon_layer,SPECIAL_VALUE_ICONS[LOGO_SPECVALUE_ICON_INDX]);
-	    specvalue_alert = 111;
-	  } // end special value checks
-		
-      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, AFTER CREATE SPEC VALUE BITMAP");
-      
-	  if (specvalue_alert == 100) {
-	    // we didn't find a special value, so set BG instead
-	    // arrow icon already set separately
-	    if (current_bg < bg_ptr[SHOWLOW_BG_INDX]) {
-		    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG: SET TO LO");
-		    text_layer_set_text(bg_layer, "LO");
-		}
-		else if (current_bg > bg_ptr[SHOWHIGH_BG_INDX]) {
-		  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG: SET TO HI");
-		  text_layer_set_text(bg_layer, "HI");
-		}
-		else {
-		  // else update with current BG
-		  //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, SET TO BG: %s ", last_bg);
-		  text_layer_set_text(bg_layer, last_bg);
- 
-      if (HardCodeNoAnimations == 100) {
-        if ( ((currentBG_isMMOL == 100) && (current_bg == 100)) || ((currentBG_isMMOL == 111) && (current_bg == 55)) ) {
-		      // PERFECT BG CLUB, ANIMATE BG      
-		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE PERFECT BG");
-		      animate_perfectbg();
-        } // perfect bg club, animate BG
+	switch (alertValue) {
 
-        // EVERY TIME YOU DO A NEW MESSAGE, YOU HAVE TO ALLOCATE A NEW HAPPY MSG BUFFER AT THE TOP OF LOAD BG FUNCTION
-        
-        if ( ((currentBG_isMMOL == 100) && (current_bg == 107)) || ((currentBG_isMMOL == 111) && (current_bg == 107)) ) {
-		      // ANIMATE HAPPY MSG LAYER     
-		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		      animate_happymsg(happymsg_buffer107);
-        } // animate happy msg layer @ 107
-      
-        if ((currentBG_isMMOL == 100) && (current_bg == 116)) {
-		      // ANIMATE HAPPY MSG LAYER     
-		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		      animate_happymsg(happymsg_buffer116);
-        } // animate happy msg layer @ 116
-      
-        if ( ((currentBG_isMMOL == 100) && (current_bg == 207)) || ((currentBG_isMMOL == 111) && (current_bg == 117)) ) {
-		      // ANIMATE HAPPY MSG LAYER     
-		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		      animate_happymsg(happymsg_buffer207);
-        } // animate happy msg layer @ 207
-		
-        if ( ((currentBG_isMMOL == 100) && (current_bg == 83)) || ((currentBG_isMMOL == 111) && (current_bg == 83)) ) {
-		      // ANIMATE HAPPY MSG LAYER     
-		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		      animate_happymsg(happymsg_buffer83);
-        } // animate happy msg layer @ 83
-        
-        if (HardCodeAllAnimations == 111) {
-          // extra animations for those that want them
-		      if ((currentBG_isMMOL == 100) && (current_bg == 314)) {
-		        // ANIMATE HAPPY MSG LAYER     
-		        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		        animate_happymsg(happymsg_buffer314);
-		      } // animate happy msg layer @ 314
-        
-		      if ((currentBG_isMMOL == 100) && (current_bg == 143)) {
-		        // ANIMATE HAPPY MSG LAYER     
-		        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		        animate_happymsg(happymsg_buffer143);
-          }  // animate happy msg layer @ 143 
-          
-		      if ( ((currentBG_isMMOL == 100) && (current_bg == 65)) || ((currentBG_isMMOL == 111) && (current_bg == 35)) ) {
-		        // ANIMATE HAPPY MSG LAYER     
-		        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
-		        animate_happymsg(happymsg_buffer65);            
-		      } // animate happy msg layer @ 65 
-        } // HardCodeAllAnimations
-        
-      } // HardCodeNoAnimations; end all animation code
-	  
-      }	  } // end bg checks (if special_value_bitmap)
-       
-      // see if we're going to use the current bg or the calculated raw bg for vibrations
-      if ( ((current_bg > 0) && (current_bg < bg_ptr[SPECVALUE_BG_INDX])) && (HaveCalcRaw == 111) ) {
-        
-        current_calc_raw = myBGAtoi(last_calc_raw);
-        
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, TurnOffVibrationsCalcRaw: %d", TurnOffVibrationsCalcRaw);
-         
-        if (TurnOffVibrationsCalcRaw == 100) {
-          // set current_bg to calculated raw so we can vibrate on that instead
-          current_bg = current_calc_raw;
-          if (currentBG_isMMOL == 100) {
-            bg_ptr = BG_MGDL;
-            specvalue_ptr = SPECVALUE_MGDL;
-          }
-          else {
-            bg_ptr = BG_MMOL;
-            specvalue_ptr = SPECVALUE_MMOL;
-          }
-        } // TurnOffVibrationsCalcRaw
-        
-        // use calculated raw values in BG field; if different cascade down so we have last three values
-        if (current_calc_raw != current_calc_raw1) {
-            strncpy(last_calc_raw3, last_calc_raw2, BG_BUFFER_SIZE);
-            strncpy(last_calc_raw2, last_calc_raw1, BG_BUFFER_SIZE);
-            strncpy(last_calc_raw1, last_calc_raw, BG_BUFFER_SIZE);
-            current_calc_raw1 = current_calc_raw;
-        }
-      }
-      
-      else {
-        // if not in special values or don't have calculated raw, blank out the fields
-        strncpy(last_calc_raw1, " ", BG_BUFFER_SIZE);
-        strncpy(last_calc_raw2, " ", BG_BUFFER_SIZE);
-        strncpy(last_calc_raw3, " ", BG_BUFFER_SIZE);
-      }
-      
-      // set bg field accordingly for calculated raw layer
-      text_layer_set_text(calcraw_last1_layer, last_calc_raw1);
-      text_layer_set_text(calcraw_last2_layer, last_calc_raw2);
-      text_layer_set_text(calcraw_last3_layer, last_calc_raw3);
-      
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CURRENT_BG: %d LAST_BG: %s ", current_bg, last_bg);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CURRENT_CALC_RAW: %d LAST_CALC_RAW: %s ", current_calc_raw, last_calc_raw);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CALC_RAW 2: %d FORMAT CALC RAW 2: %s ", current_calc_raw2, formatted_calc_raw2);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CALC_RAW 3: %d FORMAT CALC RAW 2: %s ", current_calc_raw3, formatted_calc_raw3);
-      
-      bg_vibrator (0, bg_ptr[SPECVALUE_BG_INDX], SPECVALUE_SNZ_MIN, &specvalue_overwrite, SPECVALUE_VIBE);
-      bg_vibrator (bg_ptr[SPECVALUE_BG_INDX], bg_ptr[HYPOLOW_BG_INDX], HYPOLOW_SNZ_MIN, &hypolow_overwrite, HYPOLOWBG_VIBE);
-      bg_vibrator (bg_ptr[HYPOLOW_BG_INDX], bg_ptr[BIGLOW_BG_INDX], BIGLOW_SNZ_MIN, &biglow_overwrite, BIGLOWBG_VIBE);
-      bg_vibrator (bg_ptr[BIGLOW_BG_INDX], bg_ptr[MIDLOW_BG_INDX], MIDLOW_SNZ_MIN, &midlow_overwrite, LOWBG_VIBE);
-      bg_vibrator (bg_ptr[MIDLOW_BG_INDX], bg_ptr[LOW_BG_INDX], LOW_SNZ_MIN, &low_overwrite, LOWBG_VIBE);
-      bg_vibrator (bg_ptr[HIGH_BG_INDX], bg_ptr[MIDHIGH_BG_INDX], HIGH_SNZ_MIN, &high_overwrite, HIGHBG_VIBE);
-      bg_vibrator (bg_ptr[MIDHIGH_BG_INDX], bg_ptr[BIGHIGH_BG_INDX], MIDHIGH_SNZ_MIN, &midhigh_overwrite, HIGHBG_VIBE);
-      bg_vibrator (bg_ptr[BIGHIGH_BG_INDX], 1000, BIGHIGH_SNZ_MIN, &bighigh_overwrite, BIGHIGHBG_VIBE);
+	case 0:
+      //No alert
+      //Normal (new data, in range, trend okay)
+      break;
+    
+	case 1:;
+      //Low
+      //APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER: LOW ALERT");
+      VibePattern low_alert_pat = {
+			.durations = lowalert_beebuzz,
+			.num_segments = LOWALERT_BEEBUZZ_STRONG,
+      };
+	  if (TurnOffStrongVibrations == 111) { low_alert_pat.num_segments = LOWALERT_BEEBUZZ_SHORT; };
+      vibes_enqueue_custom_pattern(low_alert_pat);
+      break;
 
-      // else "normal" range or init code
-      if ( ((current_bg > bg_ptr[LOW_BG_INDX]) && (current_bg < bg_ptr[HIGH_BG_INDX])) 
-              || (current_bg <= 0) ) {
-      
-        // do nothing; just reset snooze counter
-        lastAlertTime = 0;
-      } // else if "NORMAL RANGE" BG
-	  
-    } // else if current bg <= 0
-      
-    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, FUNCTION OUT");
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, FUNCTION OUT, SNOOZE VALUE: %d", lastAlertTime);
-	
-} // end load_bg
+	case 2:;
+      // Medium Alert
+      //APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER: MEDIUM ALERT");
+      VibePattern med_alert_pat = {
+			.durations = medalert_long,
+			.num_segments = MEDALERT_LONG_STRONG,
+      };
+	  if (TurnOffStrongVibrations == 111) { med_alert_pat.num_segments = MEDALERT_LONG_SHORT; };
+      vibes_enqueue_custom_pattern(med_alert_pat);
+      break;
 
-static void load_cgmtime() {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD CGMTIME FUNCTION START");
+	case 3:;
+      // High Alert
+      //APP_LOG(APP_LOG_LEVEL_INFO, "ALERT HANDLER: HIGH ALERT");
+      VibePattern high_alert_pat = {
+			.durations = highalert_fast,
+			.num_segments = HIGHALERT_FAST_STRONG,
+      };
+	  if (TurnOffStrongVibrations == 111) { high_alert_pat.num_segments = HIGHALERT_FAST_SHORT; };
+      vibes_enqueue_custom_pattern(high_alert_pat);
+      break;
+  
+	} // switch alertValue
 	
-    // VARIABLES
-    
-    static uint32_t cgm_time_offset = 0;
-    static char formatted_cgm_timeago[10] = {0};
+} // end alert_handler_cgm
+
+static void schedule_fetch_cgm(const uint32_t delay_ms);
+
+static void note_bt_change_cgm(const bool bt_connected) {
   
-    char cgm_label_buffer[6] = {0};
+  // VARIABLES
+  time_t time_now = time(NULL);
+  uint32_t state_secs = 0;
+  
+  // CODE START
+  
+  if ((bt_stats_cgm.changed_time != 0) && (time_now > bt_stats_cgm.changed_time)) {
+    state_secs = time_now - bt_stats_cgm.changed_time;
+  }
+  
+  if (bt_connected == false) {
+    bt_stats_cgm.disconnects++;
+    bt_stats_cgm.last_up_secs = state_secs;
+    if (state_secs >= BT_STABLE_SECS) {
+      bt_stats_cgm.recent_flaps = 0;
+    }
+  }
+  else {
+    bt_stats_cgm.last_down_secs = state_secs;
+    // back before the alert went off
+    if (BluetoothAlert == 100) {
+      bt_stats_cgm.flaps++;
+      if (bt_stats_cgm.recent_flaps < 255) {
+        bt_stats_cgm.recent_flaps++;
+      }
+    }
+  }
+  
+  bt_stats_cgm.changed_time = time_now;
+  bluetooth_connected_cgm = bt_connected;
+  
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "BT CHANGE, CONNECTED: %i SECS: %lu RECENT FLAPS: %i", bt_connected, state_secs, bt_stats_cgm.recent_flaps);
+  
+} // end note_bt_change_cgm
 
-    time_t current_temp_time = time(NULL);
-    struct tm *current_local_time = localtime(&current_temp_time);
-    size_t draw_cgm_time = 0;
-    static char cgm_time_text[] = "00:00";
+void handle_bluetooth_cgm(bool bt_connected) {
+  //APP_LOG(APP_LOG_LEVEL_INFO, "HANDLE BT: ENTER CODE");
+  
+  // the connection service only calls on a change; the BT timer calls with the cached state
+  if (bt_connected != bluetooth_connected_cgm) {
+    note_bt_change_cgm(bt_connected);
+  }
+  
+  if (bt_connected == false)
+  // bluetooth is out  
+  {
+	
+	// Check BluetoothAlert for extended Bluetooth outage; if so, do nothing
+	if (BluetoothAlert == 111) {
+      //Already vibrated and set message; out
+	  return;
+	}
+	
+	// Check to see if the BT timer needs to be set; if it is armed we're still waiting
+	if (timer_armed_cgm(WATCH_TIMER_BT) == 100) {
+	  // check to see if timer has popped
+	  if (BT_timer_pop == 100) {
+	    //set timer
+	    schedule_timer_cgm(WATCH_TIMER_BT, bt_alert_wait_secs_cgm()*MS_IN_A_SECOND, BT_TIMER_SLACK_MS);
+		// have set timer; next time we come through we will see that the timer has popped
+		return;
+	  }
+	}
+	else {
+	  // BT timer is armed and we're still waiting
+	  return;
+    }
+	
+	// timer has popped
+	// Vibrate; BluetoothAlert takes over until Bluetooth connection comes back on
+	//APP_LOG(APP_LOG_LEVEL_INFO, "BT HANDLER: TIMER POP, NO BLUETOOTH, VIBRATE");
+    alert_handler_cgm(BTOUT_VIBE);
+    BluetoothAlert = 111;
+	
+	// Reset timer pop
+	BT_timer_pop = 100;
+	
+	//APP_LOG(APP_LOG_LEVEL_INFO, "NO BLUETOOTH");
+    if (TurnOff_NOBLUETOOTH_Msg == 100) {
+	  update_text_layer(FACE_MESSAGE, "NO BLUETOOTH");
+	}
     
-    // CODE START
+    // erase cgm and app ago times
+    update_text_layer(FACE_CGMTIME, "");
+    init_loading_cgm_timeago = 111;
+    
+	// erase cgm icon
+    create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
 	
-    // initialize label buffer
-    strncpy(cgm_label_buffer, "", LABEL_BUFFER_SIZE);
-       
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, NEW CGM TIME: %lu", current_cgm_time);
+  }
     
-    if (current_cgm_time == 0) {     
-      // Init code or error code; set text layer & icon to empty value 
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIME AGO INIT OR ERROR CODE: %s", cgm_label_buffer);
-      text_layer_set_text(cgmtime_layer, "");
-      create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
-      init_loading_cgm_timeago = 111;
+  else {
+	// Bluetooth is on, reset BluetoothAlert
+    //APP_LOG(APP_LOG_LEVEL_INFO, "HANDLE BT: BLUETOOTH ON");
+    //if (BluetoothAlert == 111) { 
+      //ClearedOutage = 111; 
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "BT HANDLER, SET CLEARED OUTAGE: %i ", ClearedOutage);
+    //} 
+    BluetoothAlert = 100;
+    ClearedBTOutage = 111;
+    if (timer_armed_cgm(WATCH_TIMER_BT) == 100) {
+      // no timer is set, so need to reset timer pop
+      BT_timer_pop = 100;
     }
-    else {    
-   
-      cgm_time_now = time(NULL);
-      
-      if ((init_loading_cgm_timeago == 111) && (PhoneOffAlert == 100)) {
-        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD CGMTIME, INIT CGM TIMEAGO SHOW LAST TIME");
-        current_temp_time = current_cgm_time;
-        current_local_time = localtime(&current_temp_time);
-        draw_cgm_time = strftime(cgm_time_text, TIME_TEXTBUFF_SIZE, "%l:%M", current_local_time);
-        if (draw_cgm_time != 0) {
-          text_layer_set_text(cgmtime_layer, cgm_time_text);
-        }
-        //strncpy (formatted_cgm_timeago, "12:00", TIMEAGO_BUFFER_SIZE);
-        //text_layer_set_text(cgmtime_layer, formatted_cgm_timeago);
-      }
-      
-      // display cgm_timeago as now to 5m always, no matter what the difference is by using an offset
-      if (stored_cgm_time == current_cgm_time) {
-          // stored time is same as incoming time, so display timeago
-          current_cgm_timeago = (abs((abs(cgm_time_now - current_cgm_time)) - cgm_time_offset));
-      }
-      else {
-        // got new cgm time, set loading flags and get offset
-        if ((stored_cgm_time != 0) && (BluetoothAlert == 100) && (PhoneOffAlert == 100) && 
-          (AppSyncErrAlert == 100)) {
-          init_loading_cgm_timeago = 100;
-        }
-        
-        // get offset
-        stored_cgm_time = current_cgm_time;
-        current_cgm_timeago = 0;
-        cgm_time_offset = abs(cgm_time_now - current_cgm_time); 
-        
-      }
+    // ask for what we missed now, don't wait for the next reading window
+    schedule_fetch_cgm(LOADING_MSGSEND_MS);
+  }
+  
+  //APP_LOG(APP_LOG_LEVEL_INFO, "BluetoothAlert: %i", BluetoothAlert);
+} // end handle_bluetooth_cgm
 
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIME: %lu", current_cgm_time);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, STORED CGM TIME: %lu", stored_cgm_time);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, TIME NOW IN CGM: %lu", cgm_time_now);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIME OFFSET: %lu", cgm_time_offset);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIMEAGO: %lu", current_cgm_timeago);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, INIT LOADING BOOL: %d", init_loading_cgm_timeago);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, GM TIME AGO LABEL IN: %s", cgm_label_buffer);
-      
-      
-	    // if not in initial cgm timeago, set rcvr on icon and time label
-      if ((init_loading_cgm_timeago == 100) && (BluetoothAlert == 100) && (PhoneOffAlert == 100)) {
-        create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRON_ICON_INDX]);
-      
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIME: %lu", current_cgm_time);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, STORED CGM TIME: %lu", stored_cgm_time);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, TIME NOW IN CGM: %lu", cgm_time_now);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIME OFFSET: %lu", cgm_time_offset);
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIMEAGO: %lu", current_cgm_timeago);
-      
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, GM TIME AGO LABEL IN: %s", cgm_label_buffer);
-      
-        if (current_cgm_timeago < MINUTEAGO) {
-          cgm_timeago_diff = 0;
-          strncpy (formatted_cgm_timeago, "now", TIMEAGO_BUFFER_SIZE);
-          // We've cleared Check Rig, so make sure reset flag is set.
-          CGMOffAlert = 100;
-        }
-        else if (current_cgm_timeago < HOURAGO) {
-          cgm_timeago_diff = (current_cgm_timeago / MINUTEAGO);
-          snprintf(formatted_cgm_timeago, TIMEAGO_BUFFER_SIZE, "%i", cgm_timeago_diff);
-          strncpy(cgm_label_buffer, "m", LABEL_BUFFER_SIZE);
-          strcat(formatted_cgm_timeago, cgm_label_buffer);
-        }
-        else if (current_cgm_timeago < DAYAGO) {
-          cgm_timeago_diff = (current_cgm_timeago / HOURAGO);
-          snprintf(formatted_cgm_timeago, TIMEAGO_BUFFER_SIZE, "%i", cgm_timeago_diff);
-          strncpy(cgm_label_buffer, "h", LABEL_BUFFER_SIZE);
-          strcat(formatted_cgm_timeago, cgm_label_buffer);
-        }
-        else if (current_cgm_timeago < WEEKAGO) {
-          cgm_timeago_diff = (current_cgm_timeago / DAYAGO);
-          snprintf(formatted_cgm_timeago, TIMEAGO_BUFFER_SIZE, "%i", cgm_timeago_diff);
-          strncpy(cgm_label_buffer, "d", LABEL_BUFFER_SIZE);
-          strcat(formatted_cgm_timeago, cgm_label_buffer);
-        }
-        else {
-          strncpy (formatted_cgm_timeago, "ERR", TIMEAGO_BUFFER_SIZE);
-          create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
-          init_loading_cgm_timeago = 111;
-        }
-      
-        text_layer_set_text(cgmtime_layer, formatted_cgm_timeago);
-          
+void BT_timer_callback(void *data) {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "BT TIMER CALLBACK: ENTER CODE");
+	
+	// reset timer pop; the timer is already disarmed
+	BT_timer_pop = 111;
+	
+	// call handler with the current state
+	handle_bluetooth_cgm(bluetooth_connected_cgm);
+	
+} // end BT_timer_callback
+
+void handle_watch_battery_cgm(BatteryChargeState watch_charge_state) {
+  
+  static char watch_battery_text[] = "Wch 100%";
+
+  if (watch_charge_state.is_charging) {
+    snprintf(watch_battery_text, BATTLEVEL_FORMAT_SIZE, "CHARGING");
+  } else {
+    snprintf(watch_battery_text, BATTLEVEL_FORMAT_SIZE, "Wch %d%%", watch_charge_state.charge_percent);
+  }
+  update_text_layer(FACE_WATCH_BATTLEVEL, watch_battery_text);
+  
+} // end handle_watch_battery_cgm
+
+static void draw_date_from_app() {
+ 
+  // VARIABLES
+  time_t d_app = time(NULL);
+  struct tm *current_d_app = localtime(&d_app);
+  size_t draw_return = 0;
+  char new_date_app_text[8] = {0};
+
+  // CODE START
+  
+  // format current date from app
+  if (strcmp(time_watch_text, "00:00") == 0) {
+      //APP_LOG(APP_LOG_LEVEL_INFO, "TimeFormat: %d", timeformat);
+      if (timeformat == 0){
+        draw_return = strftime(time_watch_text, TIME_TEXTBUFF_SIZE, "%l:%M", current_d_app);
+      } else {
+        draw_return = strftime(time_watch_text, TIME_TEXTBUFF_SIZE, "%H:%M", current_d_app);
       }
-      
-      // check to see if we need to show receiver off icon
-      if ( ((cgm_timeago_diff >= CGMOUT_WAIT_MIN) || ((strcmp(cgm_label_buffer, "") != 0) && (strcmp(cgm_label_buffer, "m") != 0))) 
-      || ( ( ((current_cgm_timeago < TWOYEARSAGO) && ((current_cgm_timeago / MINUTEAGO) >= CGMOUT_INIT_WAIT_MIN)) 
-          || ((strcmp(cgm_label_buffer, "") != 0) && (strcmp(cgm_label_buffer, "m") != 0)) )
-           && (init_loading_cgm_timeago == 111) && (ClearedOutage == 100) && (ClearedBTOutage == 100) ) ) {
-	      // set receiver off icon
-	      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, SET RCVR OFF ICON, CGM TIMEAGO DIFF: %d", cgm_timeago_diff);
-	      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, SET RCVR OFF ICON, LABEL: %s", cgm_label_buffer);
-        if (init_loading_cgm_timeago == 100) {
-	        create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVROFF_ICON_INDX]);
-        }       
-	      // Vibrate if we need to
-	      if ((BluetoothAlert == 100) && (PhoneOffAlert == 100) && (CGMOffAlert == 100) && 
-            (ClearedOutage == 100) && (ClearedBTOutage == 100)) {
-	        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD CGMTIME, CGM TIMEAGO: VIBRATE");
-	        alert_handler_cgm(CGMOUT_VIBE);
-	        CGMOffAlert = 111;
-          text_layer_set_text(message_layer, "CHECK RIG");
-	      } // if CGMOffAlert       
-      } // if CGM_OUT_MIN     
-	    else {
-        if ((CGMOffAlert == 111) && (cgm_timeago_diff != 0)) { 
-          ClearedOutage = 111;
-          //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, SET CLEARED OUTAGE: %i ", ClearedOutage);
-        } 
-        // CGM is not out, reset CGMOffAlert
-        CGMOffAlert = 100;
-      } // else CGM_OUT_MIN
-      
-    } // else init code
+  
+	if (draw_return != 0) {
+      update_text_layer(FACE_TIME_WATCH, time_watch_text);
+	}
+  }
+  
+  // called every minute; only redraw when the day changes
+  draw_return = strftime(new_date_app_text, DATE_TEXTBUFF_SIZE, "%a %d", current_d_app);
+  if (draw_return != 0) {
+    update_text_layer_buffer(FACE_DATE_APP, date_app_text, new_date_app_text, DATE_TEXTBUFF_SIZE);
+  }
+
+} // end draw_date_from_app
+
+static void send_cmd_cgm(void);
+
+void retry_timer_callback_cgm(void *data) {
+  
+  // bluetooth is out; bluetooth handler asks again when it's back
+  if (!bluetooth_connected_cgm) {
+    return;
+  }
+  
+  //APP_LOG(APP_LOG_LEVEL_INFO, "RETRY TIMER POP, ABOUT TO CALL SEND CMD");
+  send_cmd_cgm();
+  
+} // end retry_timer_callback_cgm
+
+static void appmsg_error_handler_cgm(AppMessageResult appmsg_error) {
+
+  // VARIABLES
+  const AppMsgRetryPolicy *retry_policy = NULL;
+  uint32_t retry_delay_ms = 0;
+  uint8_t retry_shift = 0;
+  
+  // CODE START
+  
+  perf_stats_cgm.appmsg_errors[appmsg_result_index(appmsg_error)]++;
+  
+  if (!bluetooth_connected_cgm) {
+    // bluetooth is out, BT message already set; return out
+    return;
+  }
+  
+  // increment app message retries counter
+  appsyncandmsg_retries_counter++;
+  
+  // if hit max counter, skip resend and flag user
+  if (appsyncandmsg_retries_counter < APPSYNCANDMSG_RETRIES_MAX) {
+  
+    retry_policy = get_retry_policy_cgm(appmsg_error);
+    if (retry_policy->base_ms == 0) {
+      // no retry for this one
+      return;
+    }
     
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIMEAGO LABEL OUT: %s", cgm_label_buffer);
-} // end load_cgmtime
+    // exponential backoff, capped; jitter in the upper half so retries don't line up with other traffic
+    retry_shift = (appsyncandmsg_retries_counter - 1 < 8) ? (appsyncandmsg_retries_counter - 1) : 8;
+    retry_delay_ms = (uint32_t)retry_policy->base_ms << retry_shift;
+    if (retry_delay_ms > retry_policy->max_ms) {
+      retry_delay_ms = retry_policy->max_ms;
+    }
+    retry_delay_ms = (retry_delay_ms / 2) + (rand() % ((retry_delay_ms / 2) + 1));
+    
+    // APPMSG ERROR debug logs
+    //APP_LOG(APP_LOG_LEVEL_INFO, "APP MSG ERROR");
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "APPMSG ERR, MSG: %i RES: %s RETRIES: %i RETRY MS: %lu", 
+    //        appmsg_error, translate_app_error(appmsg_error), appsyncandmsg_retries_counter, retry_delay_ms);
+  
+    // only one retry pending; a newer error moves it
+    schedule_timer_cgm(WATCH_TIMER_RETRY, retry_delay_ms, retry_delay_ms / 4);
+    return;
+  } // if appsyncandmsg_retries_counter
+    
+  // flag error
+  //APP_LOG(APP_LOG_LEVEL_INFO, "APP MSG TOO MANY MESSAGES ERROR");
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "APPMSG ERR, MSG: %i RES: %s RETRIES: %i", 
+          appmsg_error, translate_app_error(appmsg_error), appsyncandmsg_retries_counter);
+ 
+  // check bluetooth again
+  if (bluetooth_connected_cgm == false) {
+    // bluetooth is out, BT message already set; return out
+    return;
+  }
+  
+  // set message to RESTART WATCH -> PHONE
+  update_text_layer(FACE_MESSAGE, "√APP/RESTRT");
+  
+  // reset appsync retries counter
+  appsyncandmsg_retries_counter = 0;
+  
+  // erase cgm and app ago times
+  update_text_layer(FACE_CGMTIME, "");
+  init_loading_cgm_timeago = 111;
+    
+  // erase cgm icon
+  create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
 
-static void load_apptime(){
-    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, READ APP TIME FUNCTION START");
+  // check if need to vibrate
+  if (AppSyncErrAlert == 100) {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "APPMSG ERROR: VIBRATE");
+    alert_handler_cgm(APPSYNC_ERR_VIBE);
+    AppSyncErrAlert = 111;
+  } 
+  
+} // end appmsg_error_handler_cgm
+
+void inbox_dropped_handler_cgm(AppMessageResult appmsg_indrop_error, void *context) {
+	// incoming appmessage send back from Pebble app dropped; no data received
+  
+	// APPMSG IN DROP debug logs
+	//APP_LOG(APP_LOG_LEVEL_INFO, "APPMSG IN DROP ERROR");
+	APP_LOG(APP_LOG_LEVEL_DEBUG, "APPMSG IN DROP ERR, CODE: %i RES: %s", 
+          appmsg_indrop_error, translate_app_error(appmsg_indrop_error));
+  
+  appmsg_error_handler_cgm(appmsg_indrop_error);
+    
+} // end inbox_dropped_handler_cgm
+
+void outbox_failed_handler_cgm(DictionaryIterator *failed, AppMessageResult appmsg_outfail_error, void *context) {
+	// outgoing appmessage send failed to deliver to Pebble
 	
-	// VARIABLES
-	uint32_t current_app_timeago = 0;
-	int app_timeago_diff = 0;
-	  
-	// CODE START
+  // APPMSG OUT FAIL debug logs
+  //APP_LOG(APP_LOG_LEVEL_INFO, "APPMSG OUT FAIL ERROR");
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "APPMSG OUT FAIL ERR, CODE: %i RES: %s", 
+          appmsg_outfail_error, translate_app_error(appmsg_outfail_error));
+  
+  appmsg_error_handler_cgm(appmsg_outfail_error);
+ 
+} // end outbox_failed_handler_cgm
+
+static void load_icon() {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ICON ARROW FUNCTION START");
 	
-	draw_date_from_app();  
-       
-      app_time_now = time(NULL);
-      
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, TIME NOW: %lu", app_time_now);
-      
-      current_app_timeago = abs(app_time_now - current_app_time);
-      
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, CURRENT APP TIMEAGO: %lu", current_app_timeago);
-      
-	  app_timeago_diff = (current_app_timeago / MINUTEAGO);
-	  if ( (current_app_timeago < TWOYEARSAGO) && (app_timeago_diff >= PHONEOUT_WAIT_MIN) ) {
-              
-        // erase cgm ago times and cgm icon
-        text_layer_set_text(cgmtime_layer, "");
-        create_update_bitmap(&cgmicon_bitmap,cgmicon_layer,TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
-        init_loading_cgm_timeago = 111;
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, SET init_loading_cgm_timeago: %i", init_loading_cgm_timeago);
-		
-		  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, CHECK IF HAVE TO VIBRATE");
-		  // Vibrate if we need to
-		  if ((BluetoothAlert == 100) && (PhoneOffAlert == 100) && 
-          (ClearedOutage == 100) && (ClearedBTOutage == 100)) {
-		    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, READ APP TIMEAGO: VIBRATE");
-		    alert_handler_cgm(PHONEOUT_VIBE);
-		    PhoneOffAlert = 111;
-        text_layer_set_text(message_layer, "CHECK PHONE");
-		  }
+  // VARIABLES
+  static uint8_t ArrowAlert = 100;
+  
+  const ArrowIcon *arrow_icon = &UNKNOWN_ARROW_ICON;
+  
+  // CODE START
+	
+  // Got an icon value, check data offline condition, clear vibrate flag if needed
+  if (current_delta_status != DELTA_STATUS_OFF) {
+    DataOfflineAlert = 100;
+    dataoffline_retries_counter = 0;
+  }
+  
+  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ARROW ICON, BEFORE CHECK SPEC VALUE BITMAP");
+	// check if special value set
+	if (specvalue_alert == 100) {
+	
+	  // no special value, set arrow; one lookup for the icon and its alert
+	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD ICON, CURRENT ICON: %i", current_icon);
+	  if (current_icon < ARROW_CODE_COUNT) {
+	    arrow_icon = &ARROW_ICONS[current_icon];
 	  }
-	  else {
-	    // reset PhoneOffAlert    
-      if (PhoneOffAlert == 111) {
-        ClearedOutage = 111;
-        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, SET CLEARED OUTAGE: %i ", ClearedOutage);
-      } 
-      PhoneOffAlert = 100;
-    }		
-    //} // else init code 
+	  
+	  // vibrate once when the arrow turns to an alert arrow, not again until it turns back
+	  if (arrow_icon->alert_vibe == NULL) {
+	    ArrowAlert = 100;
+	  }
+	  else if ((ArrowAlert == 100) && (RestoringState == 100)) {
+	    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD ICON, ALERT ARROW: %i", current_icon);
+	    alert_handler_cgm(*arrow_icon->alert_vibe);
+	    ArrowAlert = 111;
+	  }
+	  
+	  create_update_bitmap(FACE_ICON, arrow_icon->icon);
+	} // if specvalue_alert == 100
+	else { // this is just for log when need it
+	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD ICON, SPEC VALUE ALERT IS TRUE, DONE");
+	} // else specvalue_alert == 111
 	
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, FUNCTION OUT");
-} // end load_apptime
+} // end load_icon
+
+// forward declarations for animation code
+static void load_bg_delta();
+static void format_history_calc_raw(const uint8_t age_index, char *raw_text, const uint8_t raw_text_size);
+static void load_cgmtime();
+static void load_apptime();
+static void load_rig_battlevel();
+
+// ANIMATION CODE
+
+void destroy_perfectbg_animation(PropertyAnimation **perfectbg_animation) {
+  if (*perfectbg_animation == NULL) {
+    return;
+  }
+
+  if (animation_is_scheduled((Animation*) *perfectbg_animation)) {
+    animation_unschedule((Animation*) *perfectbg_animation);
+  }
+
+  if (perfectbg_animation != NULL) {
+    property_animation_destroy(*perfectbg_animation);
+  }
+  *perfectbg_animation = NULL;
+} // end destroy_perfectbg_animation
+
+// PERFECTBG ANIMATION
+void perfectbg_animation_started(Animation *animation, void *data) {
+
+	//APP_LOG(APP_LOG_LEVEL_INFO, "PERFECT BG ANIMATE, ANIMATION STARTED ROUTINE");
+  
+	// clear out BG and icon
+  update_text_layer(FACE_BG, " ");
+  update_text_layer(FACE_MESSAGE, "HAPPY DANCE!\0");
+  
+} // end perfectbg_animation_started
+
+void perfectbg_animation_stopped(Animation *animation, bool finished, void *data) {
+
+	//APP_LOG(APP_LOG_LEVEL_INFO, "PERFECT BG ANIMATE, ANIMATION STOPPED ROUTINE");
+	
+	// reset bg and icon
+	//APP_LOG(APP_LOG_LEVEL_DEBUG, "PERFECT BG ANIMATE, ANIMATION STOPPED, SET TO BG: %s ", last_bg);
+	update_text_layer(FACE_BG, last_bg);
+	load_icon();
+  load_bg_delta();
+  destroy_perfectbg_animation(&perfectbg_animation);
+  release_face_layer_cgm(FACE_PERFECTBG);
+  
+} // end perfectbg_animation_stopped
+
+void animate_perfectbg() {
+
+  // CONSTANTS
+  
+  // ARRAY OF ICONS FOR PERFECT BG
+  static const uint8_t PERFECTBG_ICONS[] = {
+	  ICON_CLUB100,         //0
+	  ICON_CLUB55           //1
+  };
+  
+  // INDEX FOR ARRAY OF PERFECT BG ICONS
+  static const uint8_t CLUB100_ICON_INDX = 0;
+  static const uint8_t CLUB55_ICON_INDX = 1;
+  
+	// VARIABLES 
+	
+  Layer *animate_perfectbg_layer = NULL;
+  
+	// for animation
+	GRect from_perfectbg_rect = GRect(0,0,0,0);
+	GRect to_perfectbg_rect = GRect(0,0,0,0);
+
+	// CODE START
+
+  // canvas mode has no layer to move
+  if (TurnOnCanvasMode == 111) {
+    return;
+  }
+
+ if (current_bg.units == BG_UNITS_MMOL) { 
+    create_update_bitmap(FACE_PERFECTBG, PERFECTBG_ICONS[CLUB55_ICON_INDX]);
+  }
+  else {
+    create_update_bitmap(FACE_PERFECTBG, PERFECTBG_ICONS[CLUB100_ICON_INDX]);
+  }
+	from_perfectbg_rect = GRect(144, 3, 95, 47);
+	to_perfectbg_rect = GRect(-80, 3, 95, 47);    
+	destroy_perfectbg_animation(&perfectbg_animation);
+	// stopping the old animation releases the layer, so get it after; released again when this one stops
+	ensure_face_layer_cgm(FACE_PERFECTBG);
+	animate_perfectbg_layer = face_layers_cgm[FACE_PERFECTBG];
+	if (animate_perfectbg_layer == NULL) {
+	  return;
+	}
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, CREATE FRAME");
+	perfectbg_animation = property_animation_create_layer_frame(animate_perfectbg_layer, &from_perfectbg_rect, &to_perfectbg_rect);
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, SET DURATION AND CURVE");
+	animation_set_duration((Animation*) perfectbg_animation, PERFECTBG_ANIMATE_SECS*MS_IN_A_SECOND);
+	animation_set_curve((Animation*) perfectbg_animation, AnimationCurveLinear);
+  
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, SET HANDLERS");
+	animation_set_handlers((Animation*) perfectbg_animation, (AnimationHandlers) {
+	  .started = (AnimationStartedHandler) perfectbg_animation_started,
+	  .stopped = (AnimationStoppedHandler) perfectbg_animation_stopped,
+	}, NULL /* callback data */);
+      
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE BG, SCHEDULE");
+	animation_schedule((Animation*) perfectbg_animation);   
+
+} //end animate_perfectbg
+
+void destroy_happymsg_animation(PropertyAnimation **happymsg_animation) {
+  if (*happymsg_animation == NULL) {
+    return;
+  }
+
+  if (animation_is_scheduled((Animation*) *happymsg_animation)) {
+    animation_unschedule((Animation*) *happymsg_animation);
+  }
+
+  if (happymsg_animation != NULL) {
+    property_animation_destroy(*happymsg_animation);
+  }
+  *happymsg_animation = NULL;
+} // end destroy_happymsg_animation
+
+// happymsg ANIMATION
+void happymsg_animation_started(Animation *animation, void *data) {
+
+	//APP_LOG(APP_LOG_LEVEL_INFO, "HAPPY MSG ANIMATE, ANIMATION STARTED ROUTINE, CLEAR OUT BG DELTA");
+  
+	// clear out BG delta / message layer
+  update_text_layer(FACE_MESSAGE, "");
+  update_text_layer(FACE_CGMTIME, "");
+  update_text_layer(FACE_RIG_BATTLEVEL, "");
+  create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);   
+  
+} // end happymsg_animation_started
+
+void happymsg_animation_stopped(Animation *animation, bool finished, void *data) {
+
+	//APP_LOG(APP_LOG_LEVEL_INFO, "HAPPY MSG ANIMATE, ANIMATION STOPPED ROUTINE");
+	
+	// set BG delta / message layer
+	//APP_LOG(APP_LOG_LEVEL_DEBUG, "HAPPY MSG ANIMATE, ANIMATION STOPPED, SET TO BG DELTA);
+  load_bg_delta();
+  load_cgmtime();
+  load_apptime();
+  load_rig_battlevel();
+  destroy_happymsg_animation(&happymsg_animation);
+  release_face_layer_cgm(FACE_HAPPYMSG);
+  
+} // end happymsg_animation_stopped
+
+void animate_happymsg(const char *happymsg_to_display) {
+
+  // CONSTANTS
+  const uint8_t HAPPYMSG_BUFFER_SIZE = 30;
+  
+	// VARIABLES 
+  Layer *animate_happymsg_layer = NULL;
+  
+	// for animation
+	GRect from_happymsg_rect = GRect(0,0,0,0);
+	GRect to_happymsg_rect = GRect(0,0,0,0);
+
+  static char animate_happymsg_buffer[30] = {0};
+  
+	// CODE START
+
+  // canvas mode has no layer to move
+  if (TurnOnCanvasMode == 111) {
+    return;
+  }
+
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "ANIMATE HAPPY MSG, STRING PASSED: %s", happymsg_to_display);
+  strncpy(animate_happymsg_buffer, happymsg_to_display, HAPPYMSG_BUFFER_SIZE);
+	update_text_layer(FACE_HAPPYMSG, animate_happymsg_buffer);
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "ANIMATE HAPPY MSG, MSG IN BUFFER: %s", animate_happymsg_buffer);
+	from_happymsg_rect = GRect(144, 33, 144, 55);
+	to_happymsg_rect = GRect(-144, 33, 144, 55); 
+	destroy_happymsg_animation(&happymsg_animation);
+	// stopping the old animation releases the layer, so get it after; released again when this one stops
+	ensure_face_layer_cgm(FACE_HAPPYMSG);
+  animate_happymsg_layer = face_layers_cgm[FACE_HAPPYMSG];
+	if (animate_happymsg_layer == NULL) {
+	  return;
+	}
+	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, CREATE FRAME");
+	happymsg_animation = property_animation_create_layer_frame(animate_happymsg_layer, &from_happymsg_rect, &to_happymsg_rect);
+	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, SET DURATION AND CURVE");
+	animation_set_duration((Animation*) happymsg_animation, HAPPYMSG_ANIMATE_SECS*MS_IN_A_SECOND);
+	animation_set_curve((Animation*) happymsg_animation, AnimationCurveLinear);
+  
+	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, SET HANDLERS");
+	animation_set_handlers((Animation*) happymsg_animation, (AnimationHandlers) {
+	  .started = (AnimationStartedHandler) happymsg_animation_started,
+	  .stopped = (AnimationStoppedHandler) happymsg_animation_stopped,
+	}, NULL /* callback data */);
+      
+	//APP_LOG(APP_LOG_LEVEL_INFO, "ANIMATE HAPPY MSG, SCHEDULE");
+	animation_schedule((Animation*) happymsg_animation);   
+
+} //end animate_happymsg
+
+void bg_vibrator (const uint8_t bg_band) {
+
+      // VARIABLES
+      const BgBandAlert *band_alert = NULL;
+  
+      // in range, or not a BG
+      if (bg_band >= BG_BAND_COUNT) {
+        return;
+      }
+  
+      // restoring a saved reading; no vibrate, so don't touch snooze either or the next live alert is lost
+      if (RestoringState == 111) {
+        return;
+      }
+      band_alert = &BG_BAND_ALERTS[bg_band];
+  
+      // check snooze and vibrate if needed
+      //APP_LOG(APP_LOG_LEVEL_INFO, "BG VIBRATOR, CHECK TO SEE IF WE NEED TO VIBRATE");
+      if ( (lastAlertTime == 0) || (lastAlertTime > *band_alert->snooze_min) || (*band_alert->overwrite == 100) ) {
+      
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "lastAlertTime SNOOZE VALUE IN: %i", lastAlertTime);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "bg_overwrite IN: %i", *band_alert->overwrite);
+     
+        // send alert and handle a bouncing connection
+        if ((lastAlertTime == 0) || (*band_alert->overwrite == 100)) { 
+        //APP_LOG(APP_LOG_LEVEL_INFO, "BG VIBRATOR: VIBRATE");
+          alert_handler_cgm(*band_alert->vibe);        
+          // don't know where we are coming from, so reset last alert time no matter what
+          // set to 1 to prevent bouncing connection
+          lastAlertTime = 1;
+         if (*band_alert->overwrite == 100) { *band_alert->overwrite = 111; }
+        }
+      
+        // if hit snooze, reset snooze counter; will alert next time around
+        if (lastAlertTime > *band_alert->snooze_min) { 
+          lastAlertTime = 0;
+          specvalue_overwrite = 100;
+          hypolow_overwrite = 100;
+          biglow_overwrite = 100;
+          midlow_overwrite = 100;
+          low_overwrite = 100;
+          midhigh_overwrite = 100;
+          bighigh_overwrite = 100;
+          //APP_LOG(APP_LOG_LEVEL_INFO, "BG VIBRATOR, OVERWRITE RESET");
+        }
+      
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "BG VIBRATOR, lastAlertTime SNOOZE VALUE OUT: %i", lastAlertTime);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "BG VIBRATOR, bg_overwrite OUT: %i", *band_alert->overwrite);
+      } 
+
+} // end bg_vibrator	  
+	  
+static void load_bg() {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, FUNCTION START");
+	
+	// CONSTANTS
+  const uint8_t BG_BUFFER_SIZE = 6;
+  
+	// MG/DL SPECIAL VALUE CONSTANTS ACTUAL VALUES; enums so the tables below can be static
+	// mg/dL = mmol / .0555 OR mg/dL = mmol * 18.0182
+	enum {
+	  SENSOR_NOT_ACTIVE_VALUE_MGDL = 1,		// show stop light, ?SN
+	  MINIMAL_DEVIATION_VALUE_MGDL = 2, 		// show stop light, ?MD
+	  NO_ANTENNA_VALUE_MGDL = 3, 			// show broken antenna, ?NA 
+	  SENSOR_NOT_CALIBRATED_VALUE_MGDL = 5,	// show blood drop, ?NC
+	  STOP_LIGHT_VALUE_MGDL = 6,				// show stop light, ?CD
+	  HOURGLASS_VALUE_MGDL = 9,				// show hourglass, hourglass
+	  QUESTION_MARKS_VALUE_MGDL = 10,		// show ???, ???
+	  BAD_RF_VALUE_MGDL = 12				// show broken antenna, ?RF
+	};
+
+	// MMOL SPECIAL VALUE CONSTANTS ACTUAL VALUES
+	// mmol = mg/dL / 18.0182 OR mmol = mg/dL * .0555
+	enum {
+	  SENSOR_NOT_ACTIVE_VALUE_MMOL = 1,		// show stop light, ?SN (.06 -> .1)
+	  MINIMAL_DEVIATION_VALUE_MMOL = 1,		// show stop light, ?MD (.11 -> .1)
+	  NO_ANTENNA_VALUE_MMOL = 2,				// show broken antenna, ?NA (.17 -> .2)
+	  SENSOR_NOT_CALIBRATED_VALUE_MMOL = 3,	// show blood drop, ?NC (.28 -> .3)
+	  STOP_LIGHT_VALUE_MMOL = 4,				// show stop light, ?CD (.33 -> .3, set to .4 here)
+	  HOURGLASS_VALUE_MMOL = 5,				// show hourglass, hourglass (.50 -> .5)
+	  QUESTION_MARKS_VALUE_MMOL = 6,			// show ???, ??? (.56 -> .6)
+	  BAD_RF_VALUE_MMOL = 7					// show broken antenna, ?RF (.67 -> .7)
+	};
+	
+	// ARRAY OF SPECIAL VALUES CONSTANTS; MGDL
+	static const uint8_t SPECVALUE_MGDL[] = {
+	  SENSOR_NOT_ACTIVE_VALUE_MGDL,		//0	
+	  MINIMAL_DEVIATION_VALUE_MGDL,		//1
+	  NO_ANTENNA_VALUE_MGDL,			//2
+	  SENSOR_NOT_CALIBRATED_VALUE_MGDL,	//3
+	  STOP_LIGHT_VALUE_MGDL,			//4
+	  HOURGLASS_VALUE_MGDL,				//5
+	  QUESTION_MARKS_VALUE_MGDL,		//6
+	  BAD_RF_VALUE_MGDL					//7
+	};
+	
+	// ARRAY OF SPECIAL VALUES CONSTANTS; MMOL
+	static const uint8_t SPECVALUE_MMOL[] = {
+	  SENSOR_NOT_ACTIVE_VALUE_MMOL,		//0	
+	  MINIMAL_DEVIATION_VALUE_MMOL,		//1
+	  NO_ANTENNA_VALUE_MMOL,			//2
+	  SENSOR_NOT_CALIBRATED_VALUE_MMOL,	//3
+	  STOP_LIGHT_VALUE_MMOL,			//4
+	  HOURGLASS_VALUE_MMOL,				//5
+	  QUESTION_MARKS_VALUE_MMOL,		//6
+	  BAD_RF_VALUE_MMOL					//7
+	};
+	
+	// INDEX FOR ARRAYS OF SPECIAL VALUES CONSTANTS
+	const uint8_t SENSOR_NOT_ACTIVE_VALUE_INDX = 0;
+	const uint8_t MINIMAL_DEVIATION_VALUE_INDX = 1;
+	const uint8_t NO_ANTENNA_VALUE_INDX = 2;
+	const uint8_t SENSOR_NOT_CALIBRATED_VALUE_INDX = 3;
+	const uint8_t STOP_LIGHT_VALUE_INDX = 4;
+	const uint8_t HOURGLASS_VALUE_INDX = 5;
+	const uint8_t QUESTION_MARKS_VALUE_INDX = 6;
+	const uint8_t BAD_RF_VALUE_INDX = 7;
+ 
+	// VARIABLES 
+  
+	// pointers to be used to MGDL or MMOL values for parsing
+	const uint16_t *bg_ptr = NULL;
+	const uint8_t *specvalue_ptr = NULL;
+	uint8_t bg_units = BG_UNITS_MGDL;
+	uint16_t conv_vibrator_bg = 180;
+	uint8_t bg_bands = BG_BANDS_NONE;
+
+  // happy message; max message 24 characters
+  // DO NOT GO OVER 24 CHARACTERS, INCLUDING SPACES OR YOU WILL CRASH
+  // YOU HAVE BEEN WARNED
+  // static const, so they stay in flash instead of being copied onto the stack on every call
+	static const char happymsg_buffer65[26] = "TIME TO DIA BEAT*THIS!\0";
+	static const char happymsg_buffer83[26] = "PEDAL TO THE METAL! CK83\0";
+	static const char happymsg_buffer143[26] = "YOUR PEBBLE LOVES U TOO\0";
+  static const char happymsg_buffer107[26] = "TEAM NN RACING 4*THE*WIN\0";
+	static const char happymsg_buffer116[26] = "VICTORY LANE! RYAN REED\0";
+	static const char happymsg_buffer207[26] = "HILO HILO OFF 2TEST U GO\0";
+  static const char happymsg_buffer314[26] = "NO MORE PIE FOR*YOU\0";
+  
+	// CODE START
+  
+	// if special value set, erase anything in the icon field
+	if (specvalue_alert == 111) {
+	  create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[NONE_SPECVALUE_ICON_INDX]);
+	}
+	
+	// set special value alert to zero no matter what
+	specvalue_alert = 100;
+  
+    // see if we're doing MGDL or MMOL; current_bg.value and its units are set when the message is committed
+	  
+	  // FOR TESTING ONLY
+    //current_bg.value = 10;
+	
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LAST BG: %s", last_bg);
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "CURRENT BG: %i", current_bg.value);
+    
+  if (current_bg.units == BG_UNITS_MGDL) {
+	  bg_units = BG_UNITS_MGDL;
+	  specvalue_ptr = SPECVALUE_MGDL;
+	}
+	else {
+	  bg_units = BG_UNITS_MMOL;
+	  specvalue_ptr = SPECVALUE_MMOL;
+    }
+	bg_ptr = bg_ranges_cgm[bg_units];
+	
+    // BG parse, check snooze, and set text 
+      
+    // check for init code or error code
+    if (current_bg.value <= 0) {
+      lastAlertTime = 0;
+      
+      
+      if (!bluetooth_connected_cgm) {
+	    // Bluetooth is out; set BT message
+		//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, BG INIT: NO BT, SET NO BT MESSAGE");
+		if (TurnOff_NOBLUETOOTH_Msg == 100) {
+		  update_text_layer(FACE_MESSAGE, "NO BLUETOOTH");
+		} // if turnoff nobluetooth msg
+      }// if !bluetooth connected
+      else {
+	    // if init code, we will set it right in message layer
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, UNEXPECTED BG: SET ERR ICON");
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, UNEXP BG, CURRENT_BG: %d LAST_BG: %s ", current_bg.value, last_bg);
+        update_text_layer(FACE_BG, "ERR");
+        create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[NONE_SPECVALUE_ICON_INDX]);
+        specvalue_alert = 111;
+      }
+      
+	} // if current_bg.value <= 0
+	  
+    else {
+      // valid BG
+      
+	  // check for special value, if special value, then replace icon and blank BG; else send current BG  
+	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, BEFORE CREATE SPEC VALUE BITMAP");
+	  if ((current_bg.value == specvalue_ptr[NO_ANTENNA_VALUE_INDX]) || (current_bg.value == specvalue_ptr[BAD_RF_VALUE_INDX])) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET BROKEN ANTENNA");
+	    update_text_layer(FACE_BG, "");
+	    create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[BROKEN_ANTENNA_ICON_INDX]);
+	    specvalue_alert = 111;
+	  }
+	  else if (current_bg.value == specvalue_ptr[SENSOR_NOT_CALIBRATED_VALUE_INDX]) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET BLOOD DROP");
+	    update_text_layer(FACE_BG, "");
+	    create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[BLOOD_DROP_ICON_INDX]);
+	    specvalue_alert = 111;        
+	  }
+	  else if ((current_bg.value == specvalue_ptr[SENSOR_NOT_ACTIVE_VALUE_INDX]) || (current_bg.value == specvalue_ptr[MINIMAL_DEVIATION_VALUE_INDX]) 
+	        || (current_bg.value == specvalue_ptr[STOP_LIGHT_VALUE_INDX])) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET STOP LIGHT");
+	    update_text_layer(FACE_BG, "");
+	    create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[STOP_LIGHT_ICON_INDX]);
+	    specvalue_alert = 111;
+	  }
+	  else if (current_bg.value == specvalue_ptr[HOURGLASS_VALUE_INDX]) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET HOUR GLASS");
+	    update_text_layer(FACE_BG, "");
+	    create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[HOURGLASS_ICON_INDX]);
+	    specvalue_alert = 111;
+	  }
+	  else if (current_bg.value == specvalue_ptr[QUESTION_MARKS_VALUE_INDX]) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET QUESTION MARKS, CLEAR TEXT");
+	    update_text_layer(FACE_BG, "");
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET QUESTION MARKS, SET BITMAP");
+	    create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[QUESTION_MARKS_ICON_INDX]); 
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, SPECIAL VALUE: SET QUESTION MARKS, DONE");
+	    specvalue_alert = 111;
+	  }
+	  else if (current_bg.value < bg_ptr[SPECVALUE_BG_INDX]) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, UNEXPECTED SPECIAL VALUE: SET LOGO ICON");
+	    update_text_layer(FACE_BG, "");
+	    create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[LOGO_SPECVALUE_ICON_INDX]);
+	    specvalue_alert = 111;
+	  } // end special value checks
+		
+      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, AFTER CREATE SPEC VALUE BITMAP");
+      
+	  if (specvalue_alert == 100) {
+	    // we didn't find a special value, so set BG instead
+	    // arrow icon already set separately
+	    if (current_bg.value < bg_ptr[SHOWLOW_BG_INDX]) {
+		    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG: SET TO LO");
+		    update_text_layer(FACE_BG, "LO");
+		}
+		else if (current_bg.value > bg_ptr[SHOWHIGH_BG_INDX]) {
+		  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG: SET TO HI");
+		  update_text_layer(FACE_BG, "HI");
+		}
+		else {
+		  // else update with current BG
+		  //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, SET TO BG: %s ", last_bg);
+		  update_text_layer(FACE_BG, last_bg);
+ 
+      if (HardCodeNoAnimations == 100) {
+        if ( ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 100)) || ((current_bg.units == BG_UNITS_MMOL) && (current_bg.value == 55)) ) {
+		      // PERFECT BG CLUB, ANIMATE BG      
+		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE PERFECT BG");
+		      animate_perfectbg();
+        } // perfect bg club, animate BG
+
+        // EVERY TIME YOU DO A NEW MESSAGE, YOU HAVE TO ALLOCATE A NEW HAPPY MSG BUFFER AT THE TOP OF LOAD BG FUNCTION
+        
+        if ( ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 107)) || ((current_bg.units == BG_UNITS_MMOL) && (current_bg.value == 107)) ) {
+		      // ANIMATE HAPPY MSG LAYER     
+		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		      animate_happymsg(happymsg_buffer107);
+        } // animate happy msg layer @ 107
+      
+        if ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 116)) {
+		      // ANIMATE HAPPY MSG LAYER     
+		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		      animate_happymsg(happymsg_buffer116);
+        } // animate happy msg layer @ 116
+      
+        if ( ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 207)) || ((current_bg.units == BG_UNITS_MMOL) && (current_bg.value == 117)) ) {
+		      // ANIMATE HAPPY MSG LAYER     
+		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		      animate_happymsg(happymsg_buffer207);
+        } // animate happy msg layer @ 207
+		
+        if ( ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 83)) || ((current_bg.units == BG_UNITS_MMOL) && (current_bg.value == 83)) ) {
+		      // ANIMATE HAPPY MSG LAYER     
+		      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		      animate_happymsg(happymsg_buffer83);
+        } // animate happy msg layer @ 83
+        
+        if (HardCodeAllAnimations == 111) {
+          // extra animations for those that want them
+		      if ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 314)) {
+		        // ANIMATE HAPPY MSG LAYER     
+		        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		        animate_happymsg(happymsg_buffer314);
+		      } // animate happy msg layer @ 314
+        
+		      if ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 143)) {
+		        // ANIMATE HAPPY MSG LAYER     
+		        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		        animate_happymsg(happymsg_buffer143);
+          }  // animate happy msg layer @ 143 
+          
+		      if ( ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value == 65)) || ((current_bg.units == BG_UNITS_MMOL) && (current_bg.value == 35)) ) {
+		        // ANIMATE HAPPY MSG LAYER     
+		        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, ANIMATE HAPPY MSG LAYER");
+		        animate_happymsg(happymsg_buffer65);            
+		      } // animate happy msg layer @ 65 
+        } // HardCodeAllAnimations
+        
+      } // HardCodeNoAnimations; end all animation code
+	  
+      }	  } // end bg checks (if special_value_bitmap)
+       
+      // see if we're going to use the current bg or the calculated raw bg for vibrations
+      if ( ((current_bg.value > 0) && (current_bg.value < bg_ptr[SPECVALUE_BG_INDX])) && (HaveCalcRaw == 111) ) {
+        
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, TurnOffVibrationsCalcRaw: %d", TurnOffVibrationsCalcRaw);
+         
+        // only if we have a calculated raw number; LO, HI, ERR and CAL still vibrate on the special value
+        if ((TurnOffVibrationsCalcRaw == 100) && (current_calc_raw.value > 0)) {
+          // set current_bg.value to calculated raw so we can vibrate on that instead
+          current_bg = current_calc_raw;
+        } // TurnOffVibrationsCalcRaw
+        
+        // use calculated raw values in BG field; last three readings from history, newest first
+        format_history_calc_raw(0, last_calc_raw1, BG_BUFFER_SIZE);
+        format_history_calc_raw(1, last_calc_raw2, BG_BUFFER_SIZE);
+        format_history_calc_raw(2, last_calc_raw3, BG_BUFFER_SIZE);
+      }
+      
+      else {
+        // if not in special values or don't have calculated raw, blank out the fields
+        strncpy(last_calc_raw1, " ", BG_BUFFER_SIZE);
+        strncpy(last_calc_raw2, " ", BG_BUFFER_SIZE);
+        strncpy(last_calc_raw3, " ", BG_BUFFER_SIZE);
+      }
+      
+      // set bg field accordingly for calculated raw layer
+      update_text_layer(FACE_CALCRAW_LAST1, last_calc_raw1);
+      update_text_layer(FACE_CALCRAW_LAST2, last_calc_raw2);
+      update_text_layer(FACE_CALCRAW_LAST3, last_calc_raw3);
+      
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CURRENT_BG: %d LAST_BG: %s ", current_bg.value, last_bg);
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CURRENT_CALC_RAW: %d LAST_CALC_RAW: %s ", current_calc_raw.value, last_calc_raw);
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CALC_RAW 2: %d FORMAT CALC RAW 2: %s ", current_calc_raw2, formatted_calc_raw2);
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, START VIBRATE, CALC_RAW 3: %d FORMAT CALC RAW 2: %s ", current_calc_raw3, formatted_calc_raw3);
+      
+      conv_vibrator_bg = current_bg.value;
+  
+      // adjust high bg for comparison, if needed
+      if ( ((current_bg.units == BG_UNITS_MMOL) && (current_bg.value >= HIGH_BG_MGDL))
+        || ((current_bg.units == BG_UNITS_MGDL) && (current_bg.value >= HIGH_BG_MMOL)) ) {
+        conv_vibrator_bg = current_bg.value + 1;
+      }
+      
+      // one lookup for the bands, then vibrate and snooze for each, lowest band first
+      bg_bands = classify_bg_bands_cgm(bg_units, conv_vibrator_bg);
+      for (uint8_t bg_band = 0; (bg_band < BG_BAND_COUNT) && (bg_bands != BG_BANDS_NONE); bg_band++) {
+        if ((bg_bands & (1 << bg_band)) != 0) {
+          bg_vibrator (bg_band);
+        }
+      }
+
+      // else "normal" range or init code
+      if ( ((current_bg.value > bg_ptr[LOW_BG_INDX]) && (current_bg.value < bg_ptr[HIGH_BG_INDX])) 
+              || (current_bg.value <= 0) ) {
+      
+        // do nothing; just reset snooze counter
+        lastAlertTime = 0;
+      } // else if "NORMAL RANGE" BG
+	  
+    } // else if current bg <= 0
+      
+    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG, FUNCTION OUT");
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG, FUNCTION OUT, SNOOZE VALUE: %d", lastAlertTime);
+	
+} // end load_bg
+
+static void load_cgmtime() {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD CGMTIME FUNCTION START");
+	
+    // VARIABLES
+    
+    static uint32_t cgm_time_offset = 0;
+    static char formatted_cgm_timeago[10] = {0};
+  
+    char cgm_label_buffer[6] = {0};
+
+    time_t current_temp_time = time(NULL);
+    struct tm *current_local_time = localtime(&current_temp_time);
+    size_t draw_cgm_time = 0;
+    static char cgm_time_text[] = "00:00";
+    
+    // new text is built here; the layer is only redrawn if it changed, this runs every minute
+    char new_cgm_time_text[6] = {0};
+    char new_cgm_timeago[10] = {0};
+    
+    // CODE START
+	
+    // initialize label buffer
+    strncpy(cgm_label_buffer, "", LABEL_BUFFER_SIZE);
+       
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, NEW CGM TIME: %lu", current_cgm_time);
+    
+    if (current_cgm_time == 0) {     
+      // Init code or error code; set text layer & icon to empty value 
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIME AGO INIT OR ERROR CODE: %s", cgm_label_buffer);
+      update_text_layer(FACE_CGMTIME, "");
+      create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
+      init_loading_cgm_timeago = 111;
+    }
+    else {    
+   
+      cgm_time_now = time(NULL);
+      
+      if ((init_loading_cgm_timeago == 111) && (PhoneOffAlert == 100)) {
+        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD CGMTIME, INIT CGM TIMEAGO SHOW LAST TIME");
+        current_temp_time = current_cgm_time;
+        current_local_time = localtime(&current_temp_time);
+        draw_cgm_time = strftime(new_cgm_time_text, TIME_TEXTBUFF_SIZE, "%l:%M", current_local_time);
+        if (draw_cgm_time != 0) {
+          update_text_layer_buffer(FACE_CGMTIME, cgm_time_text, new_cgm_time_text, TIME_TEXTBUFF_SIZE);
+        }
+        //strncpy (formatted_cgm_timeago, "12:00", TIMEAGO_BUFFER_SIZE);
+        //update_text_layer(FACE_CGMTIME, formatted_cgm_timeago);
+      }
+      
+      // display cgm_timeago as now to 5m always, no matter what the difference is by using an offset
+      if (stored_cgm_time == current_cgm_time) {
+          // stored time is same as incoming time, so display timeago
+          current_cgm_timeago = (abs((abs(cgm_time_now - current_cgm_time)) - cgm_time_offset));
+      }
+      else {
+        // got new cgm time, set loading flags and get offset
+        if ((stored_cgm_time != 0) && (BluetoothAlert == 100) && (PhoneOffAlert == 100) && 
+          (AppSyncErrAlert == 100)) {
+          init_loading_cgm_timeago = 100;
+        }
+        
+        // get offset
+        stored_cgm_time = current_cgm_time;
+        current_cgm_timeago = 0;
+        cgm_time_offset = abs(cgm_time_now - current_cgm_time); 
+        
+      }
+
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIME: %lu", current_cgm_time);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, STORED CGM TIME: %lu", stored_cgm_time);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, TIME NOW IN CGM: %lu", cgm_time_now);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIME OFFSET: %lu", cgm_time_offset);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIMEAGO: %lu", current_cgm_timeago);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, INIT LOADING BOOL: %d", init_loading_cgm_timeago);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, GM TIME AGO LABEL IN: %s", cgm_label_buffer);
+      
+      
+	    // if not in initial cgm timeago, set rcvr on icon and time label
+      if ((init_loading_cgm_timeago == 100) && (BluetoothAlert == 100) && (PhoneOffAlert == 100)) {
+        create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRON_ICON_INDX]);
+      
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIME: %lu", current_cgm_time);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, STORED CGM TIME: %lu", stored_cgm_time);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, TIME NOW IN CGM: %lu", cgm_time_now);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIME OFFSET: %lu", cgm_time_offset);
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CURRENT CGM TIMEAGO: %lu", current_cgm_timeago);
+      
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, GM TIME AGO LABEL IN: %s", cgm_label_buffer);
+      
+        if (current_cgm_timeago < MINUTEAGO) {
+          cgm_timeago_diff = 0;
+          strncpy (new_cgm_timeago, "now", TIMEAGO_BUFFER_SIZE);
+          // We've cleared Check Rig, so make sure reset flag is set.
+          CGMOffAlert = 100;
+        }
+        else if (current_cgm_timeago < HOURAGO) {
+          cgm_timeago_diff = (current_cgm_timeago / MINUTEAGO);
+          snprintf(new_cgm_timeago, TIMEAGO_BUFFER_SIZE, "%i", cgm_timeago_diff);
+          strncpy(cgm_label_buffer, "m", LABEL_BUFFER_SIZE);
+          strcat(new_cgm_timeago, cgm_label_buffer);
+        }
+        else if (current_cgm_timeago < DAYAGO) {
+          cgm_timeago_diff = (current_cgm_timeago / HOURAGO);
+          snprintf(new_cgm_timeago, TIMEAGO_BUFFER_SIZE, "%i", cgm_timeago_diff);
+          strncpy(cgm_label_buffer, "h", LABEL_BUFFER_SIZE);
+          strcat(new_cgm_timeago, cgm_label_buffer);
+        }
+        else if (current_cgm_timeago < WEEKAGO) {
+          cgm_timeago_diff = (current_cgm_timeago / DAYAGO);
+          snprintf(new_cgm_timeago, TIMEAGO_BUFFER_SIZE, "%i", cgm_timeago_diff);
+          strncpy(cgm_label_buffer, "d", LABEL_BUFFER_SIZE);
+          strcat(new_cgm_timeago, cgm_label_buffer);
+        }
+        else {
+          strncpy (new_cgm_timeago, "ERR", TIMEAGO_BUFFER_SIZE);
+          create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
+          init_loading_cgm_timeago = 111;
+        }
+      
+        update_text_layer_buffer(FACE_CGMTIME, formatted_cgm_timeago, new_cgm_timeago, TIMEAGO_BUFFER_SIZE);
+          
+      }
+      
+      // check to see if we need to show receiver off icon
+      if ( ((cgm_timeago_diff >= CGMOUT_WAIT_MIN) || ((strcmp(cgm_label_buffer, "") != 0) && (strcmp(cgm_label_buffer, "m") != 0))) 
+      || ( ( ((current_cgm_timeago < TWOYEARSAGO) && ((current_cgm_timeago / MINUTEAGO) >= CGMOUT_INIT_WAIT_MIN)) 
+          || ((strcmp(cgm_label_buffer, "") != 0) && (strcmp(cgm_label_buffer, "m") != 0)) )
+           && (init_loading_cgm_timeago == 111) && (ClearedOutage == 100) && (ClearedBTOutage == 100) ) ) {
+	      // set receiver off icon
+	      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, SET RCVR OFF ICON, CGM TIMEAGO DIFF: %d", cgm_timeago_diff);
+	      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, SET RCVR OFF ICON, LABEL: %s", cgm_label_buffer);
+        if (init_loading_cgm_timeago == 100) {
+	        create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVROFF_ICON_INDX]);
+        }       
+	      // Vibrate if we need to
+	      if ((BluetoothAlert == 100) && (PhoneOffAlert == 100) && (CGMOffAlert == 100) && 
+            (ClearedOutage == 100) && (ClearedBTOutage == 100) && (RestoringState == 100)) {
+	        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD CGMTIME, CGM TIMEAGO: VIBRATE");
+	        alert_handler_cgm(CGMOUT_VIBE);
+	        CGMOffAlert = 111;
+          update_text_layer(FACE_MESSAGE, "CHECK RIG");
+	      } // if CGMOffAlert       
+      } // if CGM_OUT_MIN     
+	    else {
+        if ((CGMOffAlert == 111) && (cgm_timeago_diff != 0)) { 
+          ClearedOutage = 111;
+          //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, SET CLEARED OUTAGE: %i ", ClearedOutage);
+        } 
+        // CGM is not out, reset CGMOffAlert
+        CGMOffAlert = 100;
+      } // else CGM_OUT_MIN
+      
+    } // else init code
+    
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD CGMTIME, CGM TIMEAGO LABEL OUT: %s", cgm_label_buffer);
+} // end load_cgmtime
+
+static void load_apptime(){
+    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, READ APP TIME FUNCTION START");
+	
+	// VARIABLES
+	uint32_t current_app_timeago = 0;
+	int app_timeago_diff = 0;
+	  
+	// CODE START
+	
+	draw_date_from_app();  
+       
+      app_time_now = time(NULL);
+      
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, TIME NOW: %lu", app_time_now);
+      
+      current_app_timeago = abs(app_time_now - current_app_time);
+      
+      //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, CURRENT APP TIMEAGO: %lu", current_app_timeago);
+      
+	  app_timeago_diff = (current_app_timeago / MINUTEAGO);
+	  // app time is only updated when we ask; phone is out only if it didn't answer the last request
+	  if ( (current_app_timeago < TWOYEARSAGO) && (app_timeago_diff >= PHONEOUT_WAIT_MIN) && (fetch_pending_cgm == 111) ) {
+              
+        // erase cgm ago times and cgm icon
+        update_text_layer(FACE_CGMTIME, "");
+        create_update_bitmap(FACE_CGMICON, TIMEAGO_ICONS[RCVRNONE_ICON_INDX]);
+        init_loading_cgm_timeago = 111;
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, SET init_loading_cgm_timeago: %i", init_loading_cgm_timeago);
+		
+		  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, CHECK IF HAVE TO VIBRATE");
+		  // Vibrate if we need to
+		  if ((BluetoothAlert == 100) && (PhoneOffAlert == 100) && 
+          (ClearedOutage == 100) && (ClearedBTOutage == 100) && (RestoringState == 100)) {
+		    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, READ APP TIMEAGO: VIBRATE");
+		    alert_handler_cgm(PHONEOUT_VIBE);
+		    PhoneOffAlert = 111;
+        update_text_layer(FACE_MESSAGE, "CHECK PHONE");
+		  }
+	  }
+	  else {
+	    // reset PhoneOffAlert    
+      if (PhoneOffAlert == 111) {
+        ClearedOutage = 111;
+        //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD APPTIME, SET CLEARED OUTAGE: %i ", ClearedOutage);
+      } 
+      PhoneOffAlert = 100;
+    }		
+    //} // else init code 
+	
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD APPTIME, FUNCTION OUT");
+} // end load_apptime
+
+static void load_bg_delta() {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "BG DELTA FUNCTION START");
+	
+	// CONSTANTS
+	const uint8_t MSGLAYER_BUFFER_SIZE = 14;
+	const uint8_t BGDELTA_LABEL_SIZE = 14;
+	const uint8_t BGDELTA_FORMATTED_SIZE = 14;
+  
+  // VARIABLES
+  static char formatted_bg_delta[14] = {0};
+  
+  char delta_label_buffer[14] = {0};
+
+	
+	// CODE START
+	
+    
+	if ((!bluetooth_connected_cgm) || (BluetoothAlert == 111)) {
+	  // Bluetooth is out; BT message already set, so return
+	  return;
+	}
+    
+	// check for CHECK PHONE condition, if true set message
+	if ((PhoneOffAlert == 111) && (ClearedOutage == 100) && (ClearedBTOutage == 100) && 
+      (TurnOff_CHECKPHONE_Msg == 100)) {
+	  update_text_layer(FACE_MESSAGE, "CHECK PHONE");
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG DELTA MSG, init_loading_cgm_timeago: %i", init_loading_cgm_timeago);
+    return;	
+	}
+
+	// check for CHECK CGM condition, if true set message
+    
+	if ((CGMOffAlert == 111) && (ClearedOutage == 100) && (ClearedBTOutage == 100) && 
+      (current_cgm_timeago != 0) && (stored_cgm_time == current_cgm_time) &&
+      (TurnOff_CHECKCGM_Msg == 100)) {
+	  update_text_layer(FACE_MESSAGE, "CHECK RIG");
+    return;	
+	}
+  
+  // Clear out any remaining CHECK RIG condition
+  if ((CGMOffAlert == 111) && (current_cgm_timeago == 0) &&
+      (TurnOff_CHECKCGM_Msg == 100)) {
+	  init_loading_cgm_timeago = 100;
+    return;
+  }
+	
+	// current_delta_status and current_bg_delta are set when the message is committed
+	switch (current_delta_status) {
+	
+	case DELTA_STATUS_NONE:;
+	  // no message yet, set no message
+      strncpy(formatted_bg_delta, "", MSGLAYER_BUFFER_SIZE); 
+      update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+      return;	
+	
+  	// check for NO ENDPOINT condition, if true set message
+	// put " " (space) in bg field so logo continues to show
+	case DELTA_STATUS_NOEP:;
+      strncpy(formatted_bg_delta, "NO ENDPOINT", MSGLAYER_BUFFER_SIZE);
+      update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+      update_text_layer(FACE_BG, " ");
+      create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[LOGO_SPECVALUE_ICON_INDX]);
+      specvalue_alert = 100;
+      return;	
+
+  // check for COMPRESSION (compression low) condition, if true set message
+	case DELTA_STATUS_PRSS:;
+      strncpy(formatted_bg_delta, "COMPRESSION?", MSGLAYER_BUFFER_SIZE);
+      update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+      return;	
+  
+  	// check for DATA OFFLINE condition, if true set message to fix condition	
+	case DELTA_STATUS_OFF:;
+    if (dataoffline_retries_counter >= DATAOFFLINE_RETRIES_MAX) {
+      strncpy(formatted_bg_delta, "ATTN: NO DATA", MSGLAYER_BUFFER_SIZE);
+      update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+      update_text_layer(FACE_BG, " ");
+      if (DataOfflineAlert == 100) {
+        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG DELTA, DATA OFFLINE, VIBRATE");
+        alert_handler_cgm(DATAOFFLINE_VIBE);
+        DataOfflineAlert = 111;
+      } // DataOfflineAlert
+      // NOTE: DataOfflineAlert is cleared in load_icon because that means we got a good message again
+      // NOTE: dataoffline_retries_counter is cleared in load_icon because that means we got a good message again
+    }  
+    else {
+      dataoffline_retries_counter++; 
+	  }  
+	  return;	
+  
+  	// check if LOADING.., if true set message
+  	// put " " (space) in bg field so logo continues to show
+	case DELTA_STATUS_LOAD:;
+      strncpy(formatted_bg_delta, "LOADING 7.3", MSGLAYER_BUFFER_SIZE);
+      update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+      update_text_layer(FACE_BG, " ");
+      create_update_bitmap(FACE_ICON, SPECIAL_VALUE_ICONS[LOGO_SPECVALUE_ICON_INDX]);
+      specvalue_alert = 100;
+      return;
+  
+	// phone couldn't compute a delta; set error message
+	case DELTA_STATUS_ERR:;
+      strncpy(formatted_bg_delta, "BG DELTA ERR", BGDELTA_FORMATTED_SIZE);
+      update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+      return;
+	
+	default:;
+	  break;
+	}
+ 
+	// Bluetooth is good, Phone is good, CGM connection is good, no special message 
+	// set delta BG message
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG DELTA, DELTA: %i UNITS: %i", current_bg_delta.value, current_bg_delta.units);
+	if ((current_bg_delta.value >= GLUCOSE_UNITS[current_bg_delta.units].delta_max) || 
+	    (current_bg_delta.value <= -GLUCOSE_UNITS[current_bg_delta.units].delta_max)) {
+	  // bg delta too big, set zero instead
+	  strncpy(formatted_bg_delta, GLUCOSE_UNITS[current_bg_delta.units].delta_zero_text, BGDELTA_FORMATTED_SIZE);
+	}
+	else {
+	  format_glucose_cgm(formatted_bg_delta, BGDELTA_FORMATTED_SIZE, current_bg_delta, 111);
+	}
+	strncpy(delta_label_buffer, GLUCOSE_UNITS[current_bg_delta.units].delta_label, BGDELTA_LABEL_SIZE);
+	strcat(formatted_bg_delta, delta_label_buffer);
+	
+	update_text_layer(FACE_MESSAGE, formatted_bg_delta);
+	
+} // end load_bg_delta
+
+static void load_rig_battlevel() {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, FUNCTION START");
+
+	// CONSTANTS
+  const uint8_t BATTLEVEL_LABEL_SIZE = 5;
+	const uint8_t BATTLEVEL_PERCENT_SIZE = 6;
+	
+	// VARIABLES
+  // BATTLEVEL_FORMAT_SIZE; a static const can't size an array in C
+  static char formatted_battlevel[12] = {0};
+  static uint8_t LowBatteryAlert = 100;
+  
+	uint8_t current_battlevel = 0;
+  char battlevel_percent[6] = {0};
+
+	// CODE START
+	
+	// initialize inverter layer to hide
+	set_face_hidden_cgm(FACE_INV_RIG_BATTLEVEL, true);
+
+	//APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BATTLEVEL, LAST BATTLEVEL: %i", last_battlevel);
+  
+	if (last_battlevel == CGM_UBAT_NONE) {
+      // Init code or no battery, can't do battery; set text layer & icon to empty value 
+      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, NO BATTERY");
+      update_text_layer(FACE_RIG_BATTLEVEL, "");
+      LowBatteryAlert = 100;	
+      return;
+    }
+  
+	if (last_battlevel == 0) {
+      // Zero battery level; set here, so if we get zero later we know we have an error instead
+      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, ZERO BATTERY, SET STRING");
+      update_text_layer(FACE_RIG_BATTLEVEL, "0%");
+      set_face_hidden_cgm(FACE_INV_RIG_BATTLEVEL, false);
+      if ((LowBatteryAlert == 100) && (RestoringState == 100)) {
+		//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, ZERO BATTERY, VIBRATE");
+		alert_handler_cgm(LOWBATTERY_VIBE);
+		LowBatteryAlert = 111;
+      }	 
+      return;
+    }
+  
+	current_battlevel = last_battlevel;
+  
+	//APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BATTLEVEL, CURRENT BATTLEVEL: %i", current_battlevel);
+  
+	if ((current_battlevel == CGM_UBAT_ERR) || (current_battlevel == 0) || (current_battlevel > 100)) { 
+    // phone couldn't read the battery level, or it is out of bounds
+	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, UNKNOWN, ERROR BATTERY");
+	  update_text_layer(FACE_RIG_BATTLEVEL, "ERR");
+	  set_face_hidden_cgm(FACE_INV_RIG_BATTLEVEL, false);
+    return;
+	}
+	// initialize formatted battlevel
+  strncpy(formatted_battlevel, " ", BATTLEVEL_FORMAT_SIZE);
+  
+	// get current battery level and set battery level text with percent
+  if (current_battlevel < 10) { strncpy(formatted_battlevel, "Rig  ", BATTLEVEL_LABEL_SIZE); }
+  else { strncpy(formatted_battlevel, "Rig ", BATTLEVEL_LABEL_SIZE); }
+	snprintf(battlevel_percent, BATTLEVEL_PERCENT_SIZE, "%i%%", current_battlevel);
+  strcat(formatted_battlevel, battlevel_percent);
+	update_text_layer(FACE_RIG_BATTLEVEL, formatted_battlevel);	  
+
+	if ( (current_battlevel > 10) && (current_battlevel <= 20) ) {
+    set_face_hidden_cgm(FACE_INV_RIG_BATTLEVEL, false);
+    if ((LowBatteryAlert == 100) && (RestoringState == 100)) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, LOW BATTERY, 20 OR LESS, VIBRATE");
+	    alert_handler_cgm(LOWBATTERY_VIBE);
+	    LowBatteryAlert = 111;
+    }
+	}
+  
+	if ( (current_battlevel > 5) && (current_battlevel <= 10) ) {
+    set_face_hidden_cgm(FACE_INV_RIG_BATTLEVEL, false);
+    if ((LowBatteryAlert == 100) && (RestoringState == 100)) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, LOW BATTERY, 10 OR LESS, VIBRATE");
+	    alert_handler_cgm(LOWBATTERY_VIBE);
+	    LowBatteryAlert = 111;
+    }
+  }
+  
+	if ( (current_battlevel > 0) && (current_battlevel <= 5) ) {
+    set_face_hidden_cgm(FACE_INV_RIG_BATTLEVEL, false);
+    if ((LowBatteryAlert == 100) && (RestoringState == 100)) {
+	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, LOW BATTERY, 5 OR LESS, VIBRATE");
+	    alert_handler_cgm(LOWBATTERY_VIBE);
+	    LowBatteryAlert = 111;
+    }	  
+  }
+	
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, END FUNCTION");
+} // end load_rig_battlevel
+
+static void load_noise() {
+    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD NOISE, FUNCTION START");
+
+  	// CONSTANTS
+  	#define NO_NOISE 0
+  	#define CLEAN_NOISE 1
+  	#define LIGHT_NOISE 2
+  	#define MEDIUM_NOISE 3
+  	#define HEAVY_NOISE 4
+  	#define WARMUP_NOISE 5
+  	#define OTHER_NOISE 6  
+  
+  	const uint8_t NOISE_FORMATTED_SIZE = 8;
+  
+    // VARIABLES
+  	static char formatted_noise[8] = {0};
+  
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD NOISE, CURRENT NOISE VALUE: %i ", current_noise_value);  
+    
+    switch (current_noise_value) {
+      
+    case NO_NOISE:;
+      strncpy(formatted_noise, " ", NOISE_FORMATTED_SIZE);
+      break;
+    case CLEAN_NOISE:;
+      strncpy(formatted_noise, "Cln", NOISE_FORMATTED_SIZE);
+      break;
+    case LIGHT_NOISE:;
+      strncpy(formatted_noise, "Lgt", NOISE_FORMATTED_SIZE);
+      break;
+    case MEDIUM_NOISE:;
+      strncpy(formatted_noise, "Med", NOISE_FORMATTED_SIZE);
+      break;
+    case HEAVY_NOISE:;
+      strncpy(formatted_noise, "Hvy", NOISE_FORMATTED_SIZE);
+      break;
+    case WARMUP_NOISE:;
+      strncpy(formatted_noise, " ", NOISE_FORMATTED_SIZE);
+      break;
+    case OTHER_NOISE:;
+      strncpy(formatted_noise, " ", NOISE_FORMATTED_SIZE);
+      break;
+    default:;
+      strncpy(formatted_noise, "ERR", NOISE_FORMATTED_SIZE);
+    }
+  
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, NOISE: %s ", formatted_noise);
+  
+    update_text_layer(FACE_NOISE, formatted_noise);
+  
+	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD NOISE, END FUNCTION");
+} // end load_noise
+
+static void init_reading_cgm(CgmMessage *msg, const uint8_t status) {
+  
+  // init values; blank BG so logo continues to show
+  // these are init values, not bad or null values
+  msg->status = status;
+  msg->flags = 0;
+  msg->arrow = 10;
+  msg->bg = 0;
+  msg->bg_delta = 0;
+  msg->tcgm = 0;
+  msg->tapp = 0;
+  msg->battlevel = CGM_UBAT_NONE;
+  msg->noise = 0;
+  msg->calc_raw = CGM_RAW_NONE;
+  msg->raw_unfilt = CGM_RAW_NONE;
+  strncpy(msg->t1dname, " ", sizeof(msg->t1dname));
+  
+} // end init_reading_cgm
+
+static uint8_t decode_data_bytes_cgm(const uint8_t *data, const uint16_t data_length, CgmMessage *msg) {
+  
+  // VARIABLES
+  uint8_t name_len = 0;
+  CgmSettings decoded_settings;
+  uint8_t decoded_keys = 0;
+  const uint8_t *decoded_hist_data = NULL;
+  uint16_t decoded_hist_length = 0;
+  uint32_t same_tcgm = 0;
+  
+  // CODE START
+  
+  if ((data_length < CGM_DATA_STATUS_SIZE) || (data[CGM_DATA_VERSION] != CGM_PROTOCOL_VERSION)) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE DATA, BAD MESSAGE, LENGTH: %i", data_length);
+    return 100;
+  }
+  
+  msg->status = data[CGM_DATA_STATUS];
+  
+  if (msg->status == CGM_STATUS_NOEP) {
+    // no endpoint; phone only sends the status, go back to init values
+    init_reading_cgm(msg, CGM_STATUS_NOEP);
+    return 111;
+  }
+  
+  if (msg->status == CGM_STATUS_SAME) {
+    // no new reading; replay the last one with the new app time
+    if (data_length < CGM_DATA_SAME_SIZE) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE DATA, SHORT SAME, LENGTH: %i", data_length);
+      return 100;
+    }
+    same_tcgm = read_uint32_cgm(&data[CGM_DATA_SAME_TCGM]);
+    if ((last_reading_cgm.status != CGM_STATUS_READING) || (last_reading_cgm.tcgm != same_tcgm)) {
+      // we don't have that reading; drop it, next request asks again with what we have
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE DATA, SAME BUT NO MATCH, TCGM: %lu", (unsigned long)same_tcgm);
+      return 100;
+    }
+    // keep whatever else this message already decoded; settings and history can come before the data
+    decoded_settings = msg->settings;
+    decoded_keys = msg->received_keys;
+    decoded_hist_data = msg->hist_data;
+    decoded_hist_length = msg->hist_length;
+    memcpy(msg, &last_reading_cgm, sizeof(CgmMessage));
+    msg->settings = decoded_settings;
+    msg->received_keys = decoded_keys;
+    msg->hist_data = decoded_hist_data;
+    msg->hist_length = decoded_hist_length;
+    msg->tapp = read_uint32_cgm(&data[CGM_DATA_SAME_TAPP]);
+    return 111;
+  }
+  
+  if (msg->status != CGM_STATUS_READING) {
+    // status only message, nothing else to decode
+    return 111;
+  }
+  
+  if (data_length < CGM_DATA_NAME) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE DATA, SHORT READING, LENGTH: %i", data_length);
+    return 100;
+  }
+  
+  msg->flags = data[CGM_DATA_FLAGS];
+  msg->arrow = data[CGM_DATA_ARROW];
+  msg->bg = (int16_t)read_uint16_cgm(&data[CGM_DATA_BG]);
+  msg->bg_delta = (int16_t)read_uint16_cgm(&data[CGM_DATA_DLTA]);
+  msg->tcgm = read_uint32_cgm(&data[CGM_DATA_TCGM]);
+  msg->tapp = read_uint32_cgm(&data[CGM_DATA_TAPP]);
+  msg->battlevel = data[CGM_DATA_UBAT];
+  msg->noise = data[CGM_DATA_NOIZ];
+  msg->calc_raw = (int16_t)read_uint16_cgm(&data[CGM_DATA_CLRW]);
+  msg->raw_unfilt = (int16_t)read_uint16_cgm(&data[CGM_DATA_RWUF]);
+  
+  // name is not terminated on the wire; clip to the buffer and the message
+  name_len = data[CGM_DATA_NAME_LEN];
+  if (name_len > (sizeof(msg->t1dname) - 1)) {
+    name_len = sizeof(msg->t1dname) - 1;
+  }
+  if (name_len > (data_length - CGM_DATA_NAME)) {
+    name_len = data_length - CGM_DATA_NAME;
+  }
+  memcpy(msg->t1dname, &data[CGM_DATA_NAME], name_len);
+  msg->t1dname[name_len] = '\0';
+  
+  return 111;
+  
+} // end decode_data_bytes_cgm
+
+static uint8_t decode_data_cgm(const Tuple *msg_tuple, CgmMessage *msg) {
+  
+  if (msg_tuple->type != TUPLE_BYTE_ARRAY) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE DATA, NOT A BYTE ARRAY, TYPE: %i", msg_tuple->type);
+    return 100;
+  }
+  return decode_data_bytes_cgm(msg_tuple->value->data, msg_tuple->length, msg);
+  
+} // end decode_data_cgm
+
+static uint8_t decode_vals_bytes_cgm(const uint8_t *data, const uint16_t data_length, CgmSettings *settings) {
+  
+  // CODE START
+  
+  if ((data_length < CGM_VALS_SIZE) || (data[CGM_VALS_VERSION] != CGM_PROTOCOL_VERSION)) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE VALS, BAD MESSAGE, LENGTH: %i", data_length);
+    return 100;
+  }
+  
+  settings->units = data[CGM_VALS_UNITS];
+  settings->low_bg = read_uint16_cgm(&data[CGM_VALS_LOWBG]);
+  settings->high_bg = read_uint16_cgm(&data[CGM_VALS_HIGHBG]);
+  settings->low_snooze = data[CGM_VALS_LOWSNZ];
+  settings->high_snooze = data[CGM_VALS_HIGHSNZ];
+  settings->low_vibe = data[CGM_VALS_LOWVIBE];
+  settings->high_vibe = data[CGM_VALS_HIGHVIBE];
+  settings->vibe_pattern = data[CGM_VALS_VIBEPATTERN];
+  settings->time_format = data[CGM_VALS_TIMEFORMAT];
+  settings->raw_vibrate = data[CGM_VALS_RAWVIBRATE];
+  settings->cfg_version = read_uint16_cgm(&data[CGM_VALS_CFGVERSION]);
+  
+  return 111;
+  
+} // end decode_vals_bytes_cgm
+
+static uint8_t decode_vals_cgm(const Tuple *msg_tuple, CgmSettings *settings) {
+  
+  if (msg_tuple->type != TUPLE_BYTE_ARRAY) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE VALS, NOT A BYTE ARRAY, TYPE: %i", msg_tuple->type);
+    return 100;
+  }
+  return decode_vals_bytes_cgm(msg_tuple->value->data, msg_tuple->length, settings);
+  
+} // end decode_vals_cgm
+
+static uint8_t encode_data_cgm(const CgmMessage *msg, uint8_t *data) {
+  
+  // VARIABLES
+  uint8_t name_len = strlen(msg->t1dname);
+  
+  // CODE START
+  
+  // same layout the phone sends, so decode_data_bytes_cgm reads it back; returns the length
+  data[CGM_DATA_VERSION] = CGM_PROTOCOL_VERSION;
+  data[CGM_DATA_STATUS] = msg->status;
+  data[CGM_DATA_FLAGS] = msg->flags;
+  data[CGM_DATA_ARROW] = msg->arrow;
+  write_uint16_cgm(&data[CGM_DATA_BG], (uint16_t)msg->bg);
+  write_uint16_cgm(&data[CGM_DATA_DLTA], (uint16_t)msg->bg_delta);
+  write_uint32_cgm(&data[CGM_DATA_TCGM], msg->tcgm);
+  write_uint32_cgm(&data[CGM_DATA_TAPP], msg->tapp);
+  data[CGM_DATA_UBAT] = msg->battlevel;
+  data[CGM_DATA_NOIZ] = msg->noise;
+  write_uint16_cgm(&data[CGM_DATA_CLRW], (uint16_t)msg->calc_raw);
+  write_uint16_cgm(&data[CGM_DATA_RWUF], (uint16_t)msg->raw_unfilt);
+  
+  if (name_len > (CGM_DATA_MAX_SIZE - CGM_DATA_NAME)) {
+    name_len = CGM_DATA_MAX_SIZE - CGM_DATA_NAME;
+  }
+  data[CGM_DATA_NAME_LEN] = name_len;
+  memcpy(&data[CGM_DATA_NAME], msg->t1dname, name_len);
+  
+  return CGM_DATA_NAME + name_len;
+  
+} // end encode_data_cgm
+
+static uint8_t encode_vals_cgm(const CgmSettings *settings, uint8_t *data) {
+  
+  // same layout the phone sends, so decode_vals_bytes_cgm reads it back; returns the length
+  data[CGM_VALS_VERSION] = CGM_PROTOCOL_VERSION;
+  data[CGM_VALS_UNITS] = settings->units;
+  write_uint16_cgm(&data[CGM_VALS_LOWBG], settings->low_bg);
+  write_uint16_cgm(&data[CGM_VALS_HIGHBG], settings->high_bg);
+  data[CGM_VALS_LOWSNZ] = settings->low_snooze;
+  data[CGM_VALS_HIGHSNZ] = settings->high_snooze;
+  data[CGM_VALS_LOWVIBE] = settings->low_vibe;
+  data[CGM_VALS_HIGHVIBE] = settings->high_vibe;
+  data[CGM_VALS_VIBEPATTERN] = settings->vibe_pattern;
+  data[CGM_VALS_TIMEFORMAT] = settings->time_format;
+  data[CGM_VALS_RAWVIBRATE] = settings->raw_vibrate;
+  write_uint16_cgm(&data[CGM_VALS_CFGVERSION], settings->cfg_version);
+  
+  return CGM_VALS_SIZE;
+  
+} // end encode_vals_cgm
 
-static void load_bg_delta() {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "BG DELTA FUNCTION START");
-	
-	// CONSTANTS
-	const uint8_t MSGLAYER_BUFFER_SIZE = 14;
-	const uint8_t BGDELTA_LABEL_SIZE = 14;
-	const uint8_t BGDELTA_FORMATTED_SIZE = 14;
+static uint8_t decode_hist_cgm(const Tuple *msg_tuple, CgmMessage *msg) {
   
   // VARIABLES
-  static char formatted_bg_delta[14] = {0};
+  const uint8_t *data = msg_tuple->value->data;
   
-  char delta_label_buffer[14] = {0};
+  // CODE START
+  
+  if ((msg_tuple->type != TUPLE_BYTE_ARRAY) || (msg_tuple->length < CGM_HIST_ENTRIES) || 
+      (data[CGM_HIST_VERSION] != CGM_PROTOCOL_VERSION)) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "DECODE HIST, BAD MESSAGE, LENGTH: %i", msg_tuple->length);
+    return 100;
+  }
+  
+  // only valid until the handler returns; commit backfills from it in place
+  msg->hist_data = data;
+  msg->hist_length = msg_tuple->length;
+  
+  return 111;
+  
+} // end decode_hist_cgm
 
-	
-	// CODE START
-	
-	// check bluetooth connection
-	bluetooth_connected_cgm = bluetooth_connection_service_peek();
+static void decode_message_cgm(DictionaryIterator *msg_iter, CgmMessage *msg) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "DECODE MESSAGE");
+  
+  // VARIABLES
+  Tuple *msg_tuple = NULL;
+  uint8_t decoded_ok = 100;
+  
+  // CODE START
+  
+  msg->received_keys = 0;
+  msg->hist_data = NULL;
+  msg->hist_length = 0;
+  
+  // one pass over the dictionary; only decode values here, no layer or alert work
+  for (msg_tuple = dict_read_first(msg_iter); msg_tuple != NULL; msg_tuple = dict_read_next(msg_iter)) {
     
-	if ((!bluetooth_connected_cgm) || (BluetoothAlert == 111)) {
-	  // Bluetooth is out; BT message already set, so return
-	  return;
-	}
+    switch (msg_tuple->key) {
+      
+    case CGM_DATA_KEY:;
+      decoded_ok = decode_data_cgm(msg_tuple, msg);
+      break;
+    case CGM_VALS_KEY:;
+      decoded_ok = decode_vals_cgm(msg_tuple, &msg->settings);
+      break;
+    case CGM_HIST_KEY:;
+      decoded_ok = decode_hist_cgm(msg_tuple, msg);
+      break;
+    default:;
+      // unknown key, skip it
+      continue;
+    } // switch msg_tuple->key
     
-	// check for CHECK PHONE condition, if true set message
-	if ((PhoneOffAlert == 111) && (ClearedOutage == 100) && (ClearedBTOutage == 100) && 
-      (TurnOff_CHECKPHONE_Msg == 100)) {
-	  text_layer_set_text(message_layer, "CHECK PHONE");
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG DELTA MSG, init_loading_cgm_timeago: %i", init_loading_cgm_timeago);
-    return;	
-	}
+    if (decoded_ok == 111) {
+      msg->received_keys |= (1 << msg_tuple->key);
+    }
+  } // for msg_tuple
+  
+} // end decode_message_cgm
 
-	// check for CHECK CGM condition, if true set message
+static uint8_t message_has_key(const CgmMessage *msg, const uint8_t key) {
+  
+  if (msg->received_keys & (1 << key)) {
+    return 111;
+  }
+  return 100;
+  
+} // end message_has_key
+
+static uint8_t format_raw_cgm(char *raw_text, const uint8_t raw_text_size, const Glucose raw) {
+  
+  // returns 111 (true) if there is a raw value or code to show
+  switch (raw.value) {
     
-	if ((CGMOffAlert == 111) && (ClearedOutage == 100) && (ClearedBTOutage == 100) && 
-      (current_cgm_timeago != 0) && (stored_cgm_time == current_cgm_time) &&
-      (TurnOff_CHECKCGM_Msg == 100)) {
-	  text_layer_set_text(message_layer, "CHECK RIG");
-    return;	
-	}
+  case CGM_RAW_NONE:;
+  case 0:;
+    strncpy(raw_text, " ", raw_text_size);
+    return 100;
+  case CGM_RAW_LO:;
+    strncpy(raw_text, "LO", raw_text_size);
+    return 111;
+  case CGM_RAW_HI:;
+    strncpy(raw_text, "HI", raw_text_size);
+    return 111;
+  case CGM_RAW_CAL:;
+    strncpy(raw_text, "CAL", raw_text_size);
+    return 111;
+  default:;
+    if (raw.value < 0) {
+      // CGM_RAW_ERR or unknown code
+      strncpy(raw_text, "ERR", raw_text_size);
+    }
+    else {
+      format_glucose_cgm(raw_text, raw_text_size, raw, 100);
+    }
+    return 111;
+  }
   
-  // Clear out any remaining CHECK RIG condition
-  if ((CGMOffAlert == 111) && (current_cgm_timeago == 0) &&
-      (TurnOff_CHECKCGM_Msg == 100)) {
-	  init_loading_cgm_timeago = 100;
+} // end format_raw_cgm
+
+static void format_history_calc_raw(const uint8_t age_index, char *raw_text, const uint8_t raw_text_size) {
+  
+  // VARIABLES
+  const HistoryEntry *history_entry = get_history_cgm(age_index);
+  Glucose history_raw = { 0, history_units_cgm };
+  
+  // CODE START
+  
+  if (history_entry == NULL) {
+    strncpy(raw_text, " ", raw_text_size);
     return;
   }
-	
-	// check for special messages; if no string, set no message
-	if (strcmp(current_bg_delta, "") == 0) {
-      strncpy(formatted_bg_delta, "", MSGLAYER_BUFFER_SIZE); 
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      return;	
-    }
-	
-  	// check for NO ENDPOINT condition, if true set message
-	// put " " (space) in bg field so logo continues to show
-	if (strcmp(current_bg_delta, "NOEP") == 0) {
-      strncpy(formatted_bg_delta, "NO ENDPOINT", MSGLAYER_BUFFER_SIZE);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      text_layer_set_text(bg_layer, " ");
-      create_update_bitmap(&icon_bitmap,icon_layer,SPECIAL_VALUE_ICONS[LOGO_SPECVALUE_ICON_INDX]);
-      specvalue_alert = 100;
-      return;	
-	}
+  history_raw.value = history_entry->calc_raw;
+  format_raw_cgm(raw_text, raw_text_size, history_raw);
+  
+} // end format_history_calc_raw
 
-  // check for COMPRESSION (compression low) condition, if true set message
-	if (strcmp(current_bg_delta, "PRSS") == 0) {
-      strncpy(formatted_bg_delta, "COMPRESSION?", MSGLAYER_BUFFER_SIZE);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      return;	
-	}
+static void persist_settings_cgm(const CgmSettings *settings) {
   
-  	// check for DATA OFFLINE condition, if true set message to fix condition	
-	if (strcmp(current_bg_delta, "OFF") == 0) {
-    if (dataoffline_retries_counter >= DATAOFFLINE_RETRIES_MAX) {
-      strncpy(formatted_bg_delta, "ATTN: NO DATA", MSGLAYER_BUFFER_SIZE);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      text_layer_set_text(bg_layer, " ");
-      if (DataOfflineAlert == 100) {
-        //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG DELTA, DATA OFFLINE, VIBRATE");
-        alert_handler_cgm(DATAOFFLINE_VIBE);
-        DataOfflineAlert = 111;
-      } // DataOfflineAlert
-      // NOTE: DataOfflineAlert is cleared in load_icon because that means we got a good message again
-      // NOTE: dataoffline_retries_counter is cleared in load_icon because that means we got a good message again
-    }  
-    else {
-      dataoffline_retries_counter++; 
-	  }  
-	  return;	
-  } // strcmp "OFF"
+  // VARIABLES
+  uint8_t vals_data[CGM_VALS_SIZE];
+  uint8_t vals_length = encode_vals_cgm(settings, vals_data);
   
-  	// check if LOADING.., if true set message
-  	// put " " (space) in bg field so logo continues to show
-    if (strcmp(current_bg_delta, "LOAD") == 0) {
-      strncpy(formatted_bg_delta, "LOADING 7.3", MSGLAYER_BUFFER_SIZE);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      text_layer_set_text(bg_layer, " ");
-      create_update_bitmap(&icon_bitmap,icon_layer,SPECIAL_VALUE_ICONS[LOGO_SPECVALUE_ICON_INDX]);
-      specvalue_alert = 100;
-      return;
-    }
- 
-	// check for zero delta here; if get later then we know we have an error instead
-    if (strcmp(current_bg_delta, "0") == 0) {
-      strncpy(formatted_bg_delta, "0", BGDELTA_FORMATTED_SIZE);
-      strncpy(delta_label_buffer, " mg/dL", BGDELTA_LABEL_SIZE);
-	  strcat(formatted_bg_delta, delta_label_buffer);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      return;	
-    }
+  // CODE START
   
-    if (strcmp(current_bg_delta, "0.0") == 0) {
-      strncpy(formatted_bg_delta, "0.0", BGDELTA_FORMATTED_SIZE);
-      strncpy(delta_label_buffer, " mmol", BGDELTA_LABEL_SIZE);
-	  strcat(formatted_bg_delta, delta_label_buffer);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      return;	
-    }
+  persist_write_int(PERSIST_LAYOUT_KEY, PERSIST_LAYOUT_VERSION);
+  persist_write_data(PERSIST_SETTINGS_KEY, vals_data, vals_length);
   
-	// check to see if we have MG/DL or MMOL
-	// get currentBG_isMMOL in myBGAtoi
-	converted_bgDelta = myBGAtoi(current_bg_delta);
- 
-	// Bluetooth is good, Phone is good, CGM connection is good, no special message 
-	// set delta BG message
-	
-	// zero here, means we have an error instead; set error message
-    if (converted_bgDelta == 0) {
-      strncpy(formatted_bg_delta, "BG DELTA ERR", BGDELTA_FORMATTED_SIZE);
-      text_layer_set_text(message_layer, formatted_bg_delta);
-      return;
-    }
+} // end persist_settings_cgm
+
+static void persist_reading_cgm(const CgmMessage *msg) {
   
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BG DELTA, DELTA STRING: %s", &current_bg_delta[i]);
-    if (currentBG_isMMOL == 100) {
-	  // set mg/dL string
-	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG DELTA: FOUND MG/DL, SET STRING");
-	    if (converted_bgDelta >= 100) {
-		  // bg delta too big, set zero instead
-	      strncpy(formatted_bg_delta, "0", BGDELTA_FORMATTED_SIZE);
-	    }
-	    else {
-	      strncpy(formatted_bg_delta, current_bg_delta, BGDELTA_FORMATTED_SIZE);
-	    }
-	    strncpy(delta_label_buffer, " mg/dL", BGDELTA_LABEL_SIZE);
-	    strcat(formatted_bg_delta, delta_label_buffer);
-	}
-	else {
-	  // set mmol string
-	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BG DELTA: FOUND MMOL, SET STRING");
-	  if (converted_bgDelta >= 55) {
-	    // bg delta too big, set zero instead
-	    strncpy(formatted_bg_delta, "0.0", BGDELTA_FORMATTED_SIZE);
-	  }
-	  else {
-	    strncpy(formatted_bg_delta, current_bg_delta, BGDELTA_FORMATTED_SIZE);
-	  }
-	  strncpy(delta_label_buffer, " mmol", BGDELTA_LABEL_SIZE);
-	  strcat(formatted_bg_delta, delta_label_buffer);
-	}
-	
-	text_layer_set_text(message_layer, formatted_bg_delta);
-	
-} // end load_bg_delta
+  // VARIABLES
+  uint8_t reading_data[CGM_DATA_MAX_SIZE];
+  uint8_t reading_length = 0;
+  
+  // CODE START
+  
+  // one write per new reading, not per message; saves flash
+  if ((msg->status != CGM_STATUS_READING) || (msg->tcgm == persisted_cgm_time)) {
+    return;
+  }
+  
+  // only the reading fields, never pointers or padding
+  reading_length = encode_data_cgm(msg, reading_data);
+  persist_write_int(PERSIST_LAYOUT_KEY, PERSIST_LAYOUT_VERSION);
+  persist_write_data(PERSIST_READING_KEY, reading_data, reading_length);
+  persisted_cgm_time = msg->tcgm;
+  
+} // end persist_reading_cgm
 
-static void load_rig_battlevel() {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, FUNCTION START");
+static void note_reading_arrival_cgm(const uint32_t reading_time) {
+  
+  // VARIABLES
+  uint32_t time_now = time(NULL);
+  
+  // CODE START
+  
+  // only new readings; restores and replays say nothing about how fast readings get here
+  if ((reading_time == 0) || (reading_time == last_reading_cgm.tcgm) || (RestoringState == 111)) {
+    return;
+  }
+  
+  perf_stats_cgm.fetch_new_readings++;
+  
+  // clock skew, or a reading from before an outage
+  if ((time_now < reading_time) || ((time_now - reading_time) > CGM_READING_INTERVAL_SECS)) {
+    return;
+  }
+  
+  // moving average; one late upload doesn't move the window much
+  fetch_latency_est_secs = ((fetch_latency_est_secs * 3) + (time_now - reading_time)) / 4;
+  
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "READING ARRIVAL, SECS: %lu LATENCY EST: %i", time_now - reading_time, fetch_latency_est_secs);
+  
+} // end note_reading_arrival_cgm
 
-	// CONSTANTS
-  const uint8_t BATTLEVEL_LABEL_SIZE = 5;
-	const uint8_t BATTLEVEL_PERCENT_SIZE = 6;
+static void commit_message_cgm(const CgmMessage *msg) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "COMMIT MESSAGE");
 	
-	// VARIABLES
-  static char formatted_battlevel[10] = {0};
-  static uint8_t LowBatteryAlert = 100;
+  // VARIABLES
+  uint8_t need_to_reset_outage_flag = 100;
+  uint8_t bg_units = BG_UNITS_MGDL;
+  Glucose raw_unfilt = { 0, BG_UNITS_MGDL };
   
-	uint8_t current_battlevel = 0;
-  char battlevel_percent[6] = {0};
+	// CONSTANTS
+	const uint8_t BG_MSGSTR_SIZE = 6;
 
 	// CODE START
 	
-	// initialize inverter layer to hide
-	layer_set_hidden((Layer *)inv_rig_battlevel_layer, true);
-
-	//APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BATTLEVEL, LAST BATTLEVEL: %s", last_battlevel);
+  // reset appsync retries counter; phone got through, so no more retries and no error alert
+  appsyncandmsg_retries_counter = 0;
+  if (AppSyncErrAlert == 111) { 
+    ClearedOutage = 111; 
+    //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, SET CLEARED OUTAGE: %i ", ClearedOutage);
+  } 
+  AppSyncErrAlert = 100;
+  
+  // thresholds first, so alerts use this message's values
+  if (message_has_key(msg, CGM_VALS_KEY) == 111) {
+      //APP_LOG(APP_LOG_LEVEL_INFO, "COMMIT: VALUES");
+      load_values(&msg->settings);
+      if (RestoringState == 100) {
+        persist_settings_cgm(&msg->settings);
+      }
+  }
   
-	if (strcmp(last_battlevel, " ") == 0) {
-      // Init code or no battery, can't do battery; set text layer & icon to empty value 
-      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, NO BATTERY");
-      text_layer_set_text(rig_battlevel_layer, "");
-      LowBatteryAlert = 100;	
+  // missed readings before the newest one; one chunk per message, oldest chunk first
+  if (message_has_key(msg, CGM_HIST_KEY) == 111) {
+      //APP_LOG(APP_LOG_LEVEL_INFO, "COMMIT: HISTORY");
+      backfill_history_cgm(msg->hist_data, msg->hist_length);
+  }
+  
+  if (message_has_key(msg, CGM_DATA_KEY) == 100) {
       return;
-    }
+  }
   
-	if (strcmp(last_battlevel, "0") == 0) {
-      // Zero battery level; set here, so if we get zero later we know we have an error instead
-      //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, ZERO BATTERY, SET STRING");
-      text_layer_set_text(rig_battlevel_layer, "0%");
-      layer_set_hidden((Layer *)inv_rig_battlevel_layer, false);
-      if (LowBatteryAlert == 100) {
-		//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, ZERO BATTERY, VIBRATE");
-		alert_handler_cgm(LOWBATTERY_VIBE);
-		LowBatteryAlert = 111;
-      }	 
+  fetch_last_status_cgm = msg->status;
+  
+  if (msg->status == CGM_STATUS_OFF) {
+      // data offline; only the message changes, keep the last reading on screen
+      current_delta_status = DELTA_STATUS_OFF;
+      load_bg_delta();
       return;
-    }
+  }
   
-	current_battlevel = atoi(last_battlevel);
+  // reading or init values; copy all new state first, so every load function below sees the whole message
+  bg_units = (msg->flags & CGM_FLAG_MMOL) ? BG_UNITS_MMOL : BG_UNITS_MGDL;
+  current_icon = msg->arrow;
+  current_bg.value = msg->bg;
+  current_bg.units = bg_units;
+  current_app_time = msg->tapp;
+  last_battlevel = msg->battlevel;
+  current_noise_value = msg->noise;
+  strncpy(current_t1dname, msg->t1dname, sizeof(current_t1dname));
+  
+  if (current_bg.value > 0) {
+    format_glucose_cgm(last_bg, BG_MSGSTR_SIZE, current_bg, 100);
+  }
+  else {
+    strncpy(last_bg, " ", BG_MSGSTR_SIZE);
+  }
   
-	//APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD BATTLEVEL, CURRENT BATTLEVEL: %i", current_battlevel);
+  // delta; status and compression are sent as flags
+  current_bg_delta.value = msg->bg_delta;
+  current_bg_delta.units = bg_units;
+  if (msg->status == CGM_STATUS_LOAD) {
+      current_delta_status = DELTA_STATUS_LOAD;
+  }
+  else if (msg->status == CGM_STATUS_NOEP) {
+      current_delta_status = DELTA_STATUS_NOEP;
+  }
+  else if (msg->flags & CGM_FLAG_PRSS) {
+      current_delta_status = DELTA_STATUS_PRSS;
+  }
+  else if (msg->bg_delta == CGM_DELTA_ERR) {
+      current_delta_status = DELTA_STATUS_ERR;
+  }
+  else {
+      current_delta_status = DELTA_STATUS_VALUE;
+  }
   
-	if ((current_battlevel <= 0) || (current_battlevel > 100) || (last_battlevel[0] == '-')) { 
-    // got a negative or out of bounds or error battery level
-	  //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, UNKNOWN, ERROR BATTERY");
-	  text_layer_set_text(rig_battlevel_layer, "ERR");
-	  layer_set_hidden((Layer *)inv_rig_battlevel_layer, false);
-    return;
-	}
-	// initialize formatted battlevel
-  strncpy(formatted_battlevel, " ", BATTLEVEL_FORMAT_SIZE);
+  // new readings go in the history before BG, so the calculated raw fields can use it
+  if (msg->status == CGM_STATUS_READING) {
+    add_history_cgm(msg->bg, msg->calc_raw, msg->arrow, msg->noise, msg->tcgm);
+    note_reading_arrival_cgm(msg->tcgm);
+    memcpy(&last_reading_cgm, msg, sizeof(CgmMessage));
+    last_reading_cgm.hist_data = NULL;
+    last_reading_cgm.hist_length = 0;
+  }
   
-	// get current battery level and set battery level text with percent
-  if (current_battlevel < 10) { strncpy(formatted_battlevel, "Rig  ", BATTLEVEL_LABEL_SIZE); }
-  else { strncpy(formatted_battlevel, "Rig ", BATTLEVEL_LABEL_SIZE); }
-	snprintf(battlevel_percent, BATTLEVEL_PERCENT_SIZE, "%i%%", current_battlevel);
-  strcat(formatted_battlevel, battlevel_percent);
-	text_layer_set_text(rig_battlevel_layer, formatted_battlevel);	  
+  // calculated raw and raw unfiltered before BG, so alerts use this message's values
+  //APP_LOG(APP_LOG_LEVEL_INFO, "COMMIT: CALCULATED RAW");
+  current_calc_raw.value = msg->calc_raw;
+  current_calc_raw.units = bg_units;
+  HaveCalcRaw = format_raw_cgm(last_calc_raw, BG_MSGSTR_SIZE, current_calc_raw);
+  if (current_calc_raw.value < 0) {
+    current_calc_raw.value = 0;
+  }
+  update_text_layer(FACE_RAW_CALC, last_calc_raw);
+    
+  //APP_LOG(APP_LOG_LEVEL_INFO, "COMMIT: RAW UNFILTERED");
+  raw_unfilt.value = msg->raw_unfilt;
+  raw_unfilt.units = bg_units;
+  format_raw_cgm(last_raw_unfilt, BG_MSGSTR_SIZE, raw_unfilt);
+  if (TurnOnUnfilteredRaw == 100) {
+      strncpy(last_raw_unfilt, " ", BG_MSGSTR_SIZE);
+  }
+  update_text_layer(FACE_RAW_UNFILT, last_raw_unfilt);
 
-	if ( (current_battlevel > 10) && (current_battlevel <= 20) ) {
-    layer_set_hidden((Layer *)inv_rig_battlevel_layer, false);
-    if (LowBatteryAlert == 100) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, LOW BATTERY, 20 OR LESS, VIBRATE");
-	    alert_handler_cgm(LOWBATTERY_VIBE);
-	    LowBatteryAlert = 111;
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, ICON VALUE: %i ", current_icon);
+  load_icon();
+
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, BG VALUE: %s ", last_bg);
+  load_bg();
+
+  //APP_LOG(APP_LOG_LEVEL_INFO, "COMMIT: READ CGM TIME");
+  current_cgm_time = msg->tcgm;
+  cgm_time_now = time(NULL);
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, CLEARED OUTAGE IN: %i ", ClearedOutage);
+  
+  // set up proper CGM time before calling load CGM time
+  if ( ((ClearedOutage == 111) || (ClearedBTOutage == 111)) && (stored_cgm_time != 0)) {
+    stored_cgm_time = current_cgm_time;
+    current_cgm_timeago = 0;
+    init_loading_cgm_timeago = 111;
+    need_to_reset_outage_flag = 111;
+  }
+ 
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, CURRENT CGM TIME: %lu ", current_cgm_time);
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, STORED CGM TIME: %lu ", stored_cgm_time);
+
+  load_cgmtime();
+
+  // if just cleared an outage, reset flags
+  if (need_to_reset_outage_flag == 111) {
+    // reset stored cgm_time for bluetooth race condition
+    if (ClearedBTOutage == 111) { 
+        // just cleared a BT outage, so make sure we are still in init_loading
+        init_loading_cgm_timeago = 111;
     }
-	}
+    // reset the ClearedOutages flag
+    ClearedOutage = 100;
+    ClearedBTOutage = 100;      
+  }
+
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, APP TIME VALUE: %lu ", current_app_time);
+  load_apptime();    
+
+  // delta after cgm time, so a new reading clears any CHECK RIG message here
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, BG DELTA VALUE: %i ", current_bg_delta.value);
+  load_bg_delta();
+	
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, BATTERY LEVEL VALUE: %i ", last_battlevel);
+  load_rig_battlevel();
+
+  update_text_layer(FACE_T1DNAME, current_t1dname);
+    
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "COMMIT, NOISE: %i ", current_noise_value);
+  load_noise();
+
+  if (RestoringState == 100) {
+    persist_reading_cgm(msg);
+  }
+
+} // end commit_message_cgm
+
+static uint8_t restore_state_cgm(CgmMessage *msg) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "RESTORE STATE");
   
-	if ( (current_battlevel > 5) && (current_battlevel <= 10) ) {
-    layer_set_hidden((Layer *)inv_rig_battlevel_layer, false);
-    if (LowBatteryAlert == 100) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, LOW BATTERY, 10 OR LESS, VIBRATE");
-	    alert_handler_cgm(LOWBATTERY_VIBE);
-	    LowBatteryAlert = 111;
+  // CONSTANTS
+  const uint8_t MSGLAYER_BUFFER_SIZE = 14;
+  
+  // VARIABLES
+  static char formatted_restored_age[14] = {0};
+  uint8_t saved_data[CGM_DATA_MAX_SIZE];
+  int saved_length = 0;
+  uint32_t restored_age_min = 0;
+  
+  // CODE START
+  
+  if (persist_read_int(PERSIST_LAYOUT_KEY) != PERSIST_LAYOUT_VERSION) {
+    // nothing saved, or saved by a different version; use init values
+    return 100;
+  }
+  
+  // same decoders as a message from the phone; a short or old format record is just not restored
+  saved_length = persist_read_data(PERSIST_READING_KEY, saved_data, sizeof(saved_data));
+  if ((saved_length <= 0) || (decode_data_bytes_cgm(saved_data, saved_length, msg) == 100) || 
+      (msg->status != CGM_STATUS_READING)) {
+    return 100;
+  }
+  
+  msg->received_keys = (1 << CGM_DATA_KEY);
+  msg->hist_data = NULL;
+  msg->hist_length = 0;
+  saved_length = persist_read_data(PERSIST_SETTINGS_KEY, saved_data, sizeof(saved_data));
+  if ((saved_length > 0) && (decode_vals_bytes_cgm(saved_data, saved_length, &msg->settings) == 111)) {
+    msg->received_keys |= (1 << CGM_VALS_KEY);
+  }
+  
+  // no app time, so an old restore doesn't look like the phone is out; the first message sets it
+  msg->tapp = 0;
+  persisted_cgm_time = msg->tcgm;
+  
+  // draw it all, without vibrating or saving it again; alert flags and snooze are left as they were,
+  // so the first live reading still alerts
+  RestoringState = 111;
+  commit_message_cgm(msg);
+  RestoringState = 100;
+  
+  // cgm time shows the time of the reading until the phone confirms it; show how old it is too
+  restored_age_min = abs(time(NULL) - msg->tcgm) / MINUTEAGO;
+  if ((msg->tcgm != 0) && (restored_age_min >= CGMOUT_INIT_WAIT_MIN) && (bluetooth_connected_cgm)) {
+    if (restored_age_min < (HOURAGO / MINUTEAGO)) {
+      snprintf(formatted_restored_age, MSGLAYER_BUFFER_SIZE, "%lu MIN OLD", restored_age_min);
+    }
+    else if (restored_age_min < (DAYAGO / MINUTEAGO)) {
+      snprintf(formatted_restored_age, MSGLAYER_BUFFER_SIZE, "%lu HR OLD", restored_age_min / (HOURAGO / MINUTEAGO));
+    }
+    else {
+      strncpy(formatted_restored_age, "OLD DATA", MSGLAYER_BUFFER_SIZE);
     }
+    update_text_layer(FACE_MESSAGE, formatted_restored_age);
   }
   
-	if ( (current_battlevel > 0) && (current_battlevel <= 5) ) {
-    layer_set_hidden((Layer *)inv_rig_battlevel_layer, false);
-    if (LowBatteryAlert == 100) {
-	    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, LOW BATTERY, 5 OR LESS, VIBRATE");
-	    alert_handler_cgm(LOWBATTERY_VIBE);
-	    LowBatteryAlert = 111;
-    }	  
-  }
-	
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD BATTLEVEL, END FUNCTION");
-} // end load_rig_battlevel
+  return 111;
+  
+} // end restore_state_cgm
 
-static void load_noise() {
-    //APP_LOG(APP_LOG_LEVEL_INFO, "LOAD NOISE, FUNCTION START");
+void timer_callback_cgm(void *data);
 
-  	// CONSTANTS
-  	#define NO_NOISE 0
-  	#define CLEAN_NOISE 1
-  	#define LIGHT_NOISE 2
-  	#define MEDIUM_NOISE 3
-  	#define HEAVY_NOISE 4
-  	#define WARMUP_NOISE 5
-  	#define OTHER_NOISE 6  
+static uint32_t next_fetch_delay_secs_cgm(void) {
   
-  	const uint8_t NOISE_FORMATTED_SIZE = 8;
+  // VARIABLES
+  uint32_t time_now = time(NULL);
+  uint32_t window_open = 0;
+  uint32_t window_close = 0;
+  uint32_t missed_readings = 0;
   
-    // VARIABLES
-  	static char formatted_noise[8] = {0};
+  // CODE START
   
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "LOAD NOISE, CURRENT NOISE VALUE: %i ", current_noise_value);  
-    
-    switch (current_noise_value) {
-      
-    case NO_NOISE:;
-      strncpy(formatted_noise, " ", NOISE_FORMATTED_SIZE);
-      break;
-    case CLEAN_NOISE:;
-      strncpy(formatted_noise, "Cln", NOISE_FORMATTED_SIZE);
-      break;
-    case LIGHT_NOISE:;
-      strncpy(formatted_noise, "Lgt", NOISE_FORMATTED_SIZE);
-      break;
-    case MEDIUM_NOISE:;
-      strncpy(formatted_noise, "Med", NOISE_FORMATTED_SIZE);
-      break;
-    case HEAVY_NOISE:;
-      strncpy(formatted_noise, "Hvy", NOISE_FORMATTED_SIZE);
-      break;
-    case WARMUP_NOISE:;
-      strncpy(formatted_noise, " ", NOISE_FORMATTED_SIZE);
-      break;
-    case OTHER_NOISE:;
-      strncpy(formatted_noise, " ", NOISE_FORMATTED_SIZE);
-      break;
-    default:;
-      strncpy(formatted_noise, "ERR", NOISE_FORMATTED_SIZE);
-    }
+  // no reading yet, or data offline; ask every minute, offline retries are counted in minutes
+  if ((fetch_last_status_cgm != CGM_STATUS_READING) || (last_reading_cgm.tcgm == 0)) {
+    return WATCH_MSGSEND_SECS;
+  }
   
-    //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, NOISE: %s ", formatted_noise);
+  window_open = last_reading_cgm.tcgm + CGM_READING_INTERVAL_SECS + fetch_latency_est_secs - FETCH_WINDOW_EARLY_SECS;
+  window_close = window_open + FETCH_WINDOW_EARLY_SECS + FETCH_WINDOW_LATE_SECS;
   
-    text_layer_set_text(noise_layer, formatted_noise);
+  // missed readings; move to the window of the next one
+  if (time_now > window_close) {
+    missed_readings = ((time_now - window_close) / CGM_READING_INTERVAL_SECS) + 1;
+    window_open += missed_readings * CGM_READING_INTERVAL_SECS;
+  }
   
-	//APP_LOG(APP_LOG_LEVEL_INFO, "LOAD NOISE, END FUNCTION");
-} // end load_noise
+  if (time_now < window_open) {
+    // sleep until the window; never longer than one reading, in case the watch clock jumped
+    return ((window_open - time_now) < CGM_READING_INTERVAL_SECS) ? (window_open - time_now) : CGM_READING_INTERVAL_SECS;
+  }
+  
+  // in the window; poll slower every time a reading is missed, at most 4 times slower
+  return FETCH_WINDOW_POLL_SECS << ((missed_readings < 2) ? missed_readings : 2);
+  
+} // end next_fetch_delay_secs_cgm
 
-void sync_tuple_changed_callback_cgm(const uint32_t key, const Tuple* new_tuple, const Tuple* old_tuple, void* context) {
-	//APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE");
-	
+static void schedule_fetch_cgm(const uint32_t delay_ms) {
+  
   // VARIABLES
-  uint8_t need_to_reset_outage_flag = 100;
-  uint8_t get_new_cgm_time = 100;
+  uint32_t slack_ms = delay_ms / 4;
   
-	// CONSTANTS
-	const uint8_t ICON_MSGSTR_SIZE = 4;
-	const uint8_t BG_MSGSTR_SIZE = 6;
-	const uint8_t BGDELTA_MSGSTR_SIZE = 6;
-	const uint8_t BATTLEVEL_MSGSTR_SIZE = 4;
-	const uint8_t VALUE_MSGSTR_SIZE = 25;
-
-	// CODE START
-	
-  // reset appsync retries counter
-  appsyncandmsg_retries_counter = 0;
+  // CODE START
   
-  //parse key and tuple
-	switch (key) {
-
-	case CGM_ICON_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: ICON ARROW");
-      strncpy(current_icon, new_tuple->value->cstring, ICON_MSGSTR_SIZE);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, ICON VALUE: %s ", current_icon);
-	  load_icon();
-      break; // break for CGM_ICON_KEY
-
-	case CGM_BG_KEY:;
-	  //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: BG CURRENT");
-      strncpy(last_bg, new_tuple->value->cstring, BG_MSGSTR_SIZE);
-	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, BG VALUE: %s ", last_bg);
-      load_bg();
-      break; // break for CGM_BG_KEY
-
-	case CGM_TCGM_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: READ CGM TIME");
-      current_cgm_time = new_tuple->value->uint32;
-      cgm_time_now = time(NULL);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, CLEARED OUTAGE IN: %i ", ClearedOutage);
-      
-      // set up proper CGM time before calling load CGM time
-      if ( ((ClearedOutage == 111) || (ClearedBTOutage == 111)) && (stored_cgm_time != 0)) {
-        stored_cgm_time = current_cgm_time;
-        current_cgm_timeago = 0;
-        init_loading_cgm_timeago = 111;
-        need_to_reset_outage_flag = 111;
-        
-      }
-      // get stored cgm time again for bluetooth race condition
-      if (get_new_cgm_time == 111) { 
-         stored_cgm_time = current_cgm_time;
-         current_cgm_timeago = 0;
-        // reset flag
-         get_new_cgm_time = 100;
-      }
-    
-      // clear CHECK RIG message if still there
-      if ((CGMOffAlert == 111) && (need_to_reset_outage_flag = 111) && (stored_cgm_time != current_cgm_time)) {
-        load_bg_delta();
-      }
-     
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, CURRENT CGM TIME: %lu ", current_cgm_time);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, STORED CGM TIME: %lu ", stored_cgm_time);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, TIME NOW: %lu ", cgm_time_now);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, CLEARED OUTAGE OUT: %i ", ClearedOutage);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, CURRENT CGM TIMEAGO: %lu ", current_cgm_timeago);
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, CURRENT CGM TIMEAGO DIFF: %i ", cgm_timeago_diff);   
-    
-      load_cgmtime();
- 
-      // if just cleared an outage, reset flags
-      if (need_to_reset_outage_flag == 111) {
-        // reset stored cgm_time for bluetooth race condition
-        if (ClearedBTOutage == 111) { 
-            // just cleared a BT outage, so make sure we are still in init_loading
-            init_loading_cgm_timeago = 111;
-            // set get new CGM time flag
-            get_new_cgm_time = 111;
-        }
-        // reset the ClearedOutages flag
-        ClearedOutage = 100;
-        ClearedBTOutage = 100;      
-        // reset outage flag
-        need_to_reset_outage_flag = 100;
-      }
-    
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: READ CGM TIME OUT");
-      break; // break for CGM_TCGM_KEY
-
-	case CGM_TAPP_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: READ APP TIME NOW");
-      current_app_time = new_tuple->value->uint32;
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, APP TIME VALUE: %i ", current_app_time);
-      load_apptime();    
-      break; // break for CGM_TAPP_KEY
-
-	case CGM_DLTA_KEY:;
-   	  //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: BG DELTA");
-	  strncpy(current_bg_delta, new_tuple->value->cstring, BGDELTA_MSGSTR_SIZE);
-   	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, BG DELTA VALUE: %s ", current_bg_delta);
-	  load_bg_delta();
-	  break; // break for CGM_DLTA_KEY
-	
-	case CGM_UBAT_KEY:;
-   	  //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: UPLOADER BATTERY LEVEL");
-      strncpy(last_battlevel, new_tuple->value->cstring, BATTLEVEL_MSGSTR_SIZE);
-   	  //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, BATTERY LEVEL VALUE: %s ", last_battlevel);
-      load_rig_battlevel();
-      break; // break for CGM_UBAT_KEY
-
-	case CGM_NAME_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: T1D NAME");
-      text_layer_set_text(t1dname_layer, new_tuple->value->cstring);
-      break; // break for CGM_NAME_KEY
-    
-  case CGM_VALS_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: VALUES");
-      strncpy(current_values, new_tuple->value->cstring, VALUE_MSGSTR_SIZE);
-      load_values();
-      break; // break for CGM_VALS_KEY
-    
-  case CGM_CLRW_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: CALCULATED RAW");
-      strncpy(last_calc_raw, new_tuple->value->cstring, BG_MSGSTR_SIZE);
-      if ( (strcmp(last_calc_raw, "0") == 0) || (strcmp(last_calc_raw, "0.0") == 0) ) {
-        strncpy(last_calc_raw, " ", BG_MSGSTR_SIZE);
-        HaveCalcRaw = 100;
-      }
-      else { HaveCalcRaw = 111; }  
-      text_layer_set_text(raw_calc_layer, last_calc_raw);
-      break; // break for CGM_CLRW_KEY
-    
- 	case CGM_RWUF_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: RAW UNFILTERED");
-      strncpy(last_raw_unfilt, new_tuple->value->cstring, BG_MSGSTR_SIZE);
-      if ( (strcmp(last_raw_unfilt, "0") == 0) || (strcmp(last_raw_unfilt, "0.0") == 0) || (TurnOnUnfilteredRaw == 100) ) {
-        strncpy(last_raw_unfilt, " ", BG_MSGSTR_SIZE);
-      }
-      text_layer_set_text(raw_unfilt_layer, last_raw_unfilt);
-      break; // break for CGM_RWUF_KEY
-    
-  case CGM_NOIZ_KEY:;
-      //APP_LOG(APP_LOG_LEVEL_INFO, "SYNC TUPLE: NOISE");
-	    current_noise_value = new_tuple->value->uint8;
-      //APP_LOG(APP_LOG_LEVEL_DEBUG, "SYNC TUPLE, NOISE: %i ", current_noise_value);
-      load_noise();
-      break; // break for CGM_NOIZ_KEY
-  }  // end switch(key)
+  //APP_LOG(APP_LOG_LEVEL_DEBUG, "SCHEDULE FETCH, MS: %lu", delay_ms);
+  
+  // a little early is fine, not more than the reading window opens early
+  if (slack_ms > (FETCH_WINDOW_EARLY_SECS * MS_IN_A_SECOND)) {
+    slack_ms = FETCH_WINDOW_EARLY_SECS * MS_IN_A_SECOND;
+  }
+  
+  // moves the pending request if there is one, so there is only ever one
+  schedule_timer_cgm(WATCH_TIMER_FETCH, delay_ms, slack_ms);
+  
+} // end schedule_fetch_cgm
 
-} // end sync_tuple_changed_callback_cgm()
+void inbox_received_handler_cgm(DictionaryIterator *msg_iter, void *context) {
+	//APP_LOG(APP_LOG_LEVEL_INFO, "INBOX RECEIVED");
+  
+  // VARIABLES
+  uint32_t perf_start_ms = 0;
+  
+  // CODE START
+  
+  if (TurnOnPerfStats == 111) {
+    perf_start_ms = get_time_ms_cgm();
+  }
+  
+  decode_message_cgm(msg_iter, &staged_msg_cgm);
+  commit_message_cgm(&staged_msg_cgm);
+  
+  // phone answered; drop any retry, next request goes out when the next reading should be there
+  fetch_pending_cgm = 100;
+  cancel_timer_cgm(WATCH_TIMER_RETRY);
+  schedule_fetch_cgm(next_fetch_delay_secs_cgm() * MS_IN_A_SECOND);
+  
+  if (TurnOnPerfStats == 111) {
+    perf_stats_cgm.messages++;
+    perf_stats_cgm.cpu_ms += (get_time_ms_cgm() - perf_start_ms);
+  }
+  
+} // end inbox_received_handler_cgm
 
 static void send_cmd_cgm(void) {
   
@@ -2340,13 +3980,23 @@ static void send_cmd_cgm(void) {
      return;
   }
 
+  // tell the phone which settings we have, so it only sends them if they changed
+  dict_write_uint16(iter, CGM_CFGV_KEY, current_cfg_version);
+  // and which reading we have, so it only sends what we missed
+  dict_write_uint32(iter, CGM_LAST_KEY, (last_reading_cgm.status == CGM_STATUS_READING) ? last_reading_cgm.tcgm : 0);
+  dict_write_end(iter);
+  
   //APP_LOG(APP_LOG_LEVEL_INFO, "SEND CMD, MSG OUTBOX OPEN, NO ERROR, ABOUT TO SEND MSG TO APP");
   sendcmd_senderr = app_message_outbox_send();
   
   if (sendcmd_senderr != APP_MSG_OK) {
      //APP_LOG(APP_LOG_LEVEL_INFO, "WATCH SENDCMD SEND ERROR");
      APP_LOG(APP_LOG_LEVEL_DEBUG, "WATCH SENDCMD SEND ERR CODE: %i RES: %s", sendcmd_senderr, translate_app_error(sendcmd_senderr));
+     return;
   }
+  
+  fetch_pending_cgm = 111;
+  perf_stats_cgm.fetch_requests++;
 
   //APP_LOG(APP_LOG_LEVEL_INFO, "SEND CMD OUT, SENT MSG TO APP");
   
@@ -2355,22 +4005,41 @@ static void send_cmd_cgm(void) {
 void timer_callback_cgm(void *data) {
 
   //APP_LOG(APP_LOG_LEVEL_INFO, "TIMER CALLBACK IN, TIMER POP, ABOUT TO CALL SEND CMD");
-  // reset msg timer to NULL
-  if (timer_cgm != NULL) {
-    timer_cgm = NULL;
-  }
+  
+  // log performance counters since last request, if turned on
+  log_perf_stats_cgm();
   
   // send message
   send_cmd_cgm();
   
   //APP_LOG(APP_LOG_LEVEL_INFO, "TIMER CALLBACK, SEND CMD DONE, ABOUT TO REGISTER TIMER");
-  // set msg timer
-  timer_cgm = app_timer_register((WATCH_MSGSEND_SECS*MS_IN_A_SECOND), timer_callback_cgm, NULL);
+  // set msg timer; the answer moves it to the next reading window, this one is for when no answer comes
+  schedule_fetch_cgm(next_fetch_delay_secs_cgm()*MS_IN_A_SECOND);
 
   //APP_LOG(APP_LOG_LEVEL_INFO, "TIMER CALLBACK, REGISTER TIMER DONE");
   
 } // end timer_callback_cgm
 
+static void refresh_ages_cgm() {
+  
+  // CODE START
+  
+  // nothing to age yet
+  if ((current_cgm_time == 0) || (current_app_time == 0)) {
+    return;
+  }
+  
+  // bluetooth handler owns the screen while bluetooth is out
+  if ((!bluetooth_connected_cgm) || (BluetoothAlert == 111)) {
+    return;
+  }
+  
+  // ages come from the stored times, not from the phone; same checks as when a message comes in
+  load_cgmtime();
+  load_apptime();
+  
+} // end refresh_ages_cgm
+
 // format current time from watch
 
 void handle_minute_tick_cgm(struct tm* tick_time_cgm, TimeUnits units_changed_cgm) {
@@ -2388,7 +4057,7 @@ void handle_minute_tick_cgm(struct tm* tick_time_cgm, TimeUnits units_changed_cg
       tick_return_cgm = strftime(time_watch_text, TIME_TEXTBUFF_SIZE, "%H:%M", tick_time_cgm);
     }
 	if (tick_return_cgm != 0) {
-      text_layer_set_text(time_watch_layer, time_watch_text);
+      update_text_layer(FACE_TIME_WATCH, time_watch_text);
 	}
 	
 	//APP_LOG(APP_LOG_LEVEL_DEBUG, "lastAlertTime IN:  %i", lastAlertTime);
@@ -2398,11 +4067,276 @@ void handle_minute_tick_cgm(struct tm* tick_time_cgm, TimeUnits units_changed_cg
 	
   // check watch battery
   handle_watch_battery_cgm(battery_state_service_peek());
+  
+  // time ago, CHECK RIG and CHECK PHONE move on without a message from the phone
+  refresh_ages_cgm();
+  
+  // already awake; anything due within its slack goes now instead of its own wakeup
+  run_due_timers_cgm();
     
   } 
   
 } // end handle_minute_tick_cgm
 
+void face_canvas_update_proc_cgm(Layer *layer, GContext *ctx) {
+  
+  // VARIABLES
+  const FaceLayout *face_layout = NULL;
+  GBitmap *face_bitmap = NULL;
+  GRect bitmap_rect = GRect(0,0,0,0);
+  
+  // CODE START
+  
+  // bottom up, same order the layers were stacked in; only reads the view model
+  for (uint8_t face_id = 0; face_id < FACE_ELEMENT_COUNT; face_id++) {
+    if (face_view_cgm.hidden[face_id] == 111) {
+      continue;
+    }
+    face_layout = &FACE_LAYOUT[face_id];
+    
+    if ((face_layout->kind == FACE_KIND_TEXT) || (face_layout->kind == FACE_KIND_BITMAP)) {
+      if (face_layout->background_color != GColorClear) {
+        graphics_context_set_fill_color(ctx, face_layout->background_color);
+        graphics_fill_rect(ctx, face_layout->frame, 0, GCornerNone);
+      }
+    }
+    
+    switch (face_layout->kind) {
+      case FACE_KIND_TEXT:
+        if ((face_view_cgm.text[face_id] != NULL) && (face_view_cgm.text[face_id][0] != '\0')) {
+          graphics_context_set_text_color(ctx, face_layout->text_color);
+          graphics_draw_text(ctx, face_view_cgm.text[face_id], face_fonts_cgm[face_id], face_layout->frame, 
+                             GTextOverflowModeWordWrap, (GTextAlignment)face_layout->alignment, NULL);
+        }
+        break;
+      
+      case FACE_KIND_BITMAP:
+        face_bitmap = face_view_cgm.bitmap[face_id];
+        if (face_bitmap != NULL) {
+          bitmap_rect = (GRect) { .origin = GPoint(0, 0), .size = face_bitmap->bounds.size };
+          grect_align(&bitmap_rect, &face_layout->frame, (GAlign)face_layout->alignment, false);
+          graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+          graphics_draw_bitmap_in_rect(ctx, face_bitmap, bitmap_rect);
+        }
+        break;
+      
+      case FACE_KIND_SPARKLINE:
+        draw_sparkline_cgm(ctx, face_layout->frame);
+        break;
+      
+      default:
+        // inverter is its own layer, on top of the canvas
+        break;
+    }
+  }
+  
+} // end face_canvas_update_proc_cgm
+
+static Layer* create_face_layer_cgm(const uint8_t face_id) {
+  
+  // VARIABLES
+  const FaceLayout *face_layout = &FACE_LAYOUT[face_id];
+  TextLayer *face_text_layer = NULL;
+  BitmapLayer *face_bitmap_layer = NULL;
+  
+  // CODE START
+  
+  switch (face_layout->kind) {
+    case FACE_KIND_TEXT:
+      face_text_layer = text_layer_create(face_layout->frame);
+      if (face_text_layer == NULL) {
+        // out of heap, leave it off the face so don't crash
+        return NULL;
+      }
+      text_layer_set_text_color(face_text_layer, face_layout->text_color);
+      text_layer_set_background_color(face_text_layer, face_layout->background_color);
+      text_layer_set_font(face_text_layer, fonts_get_system_font(face_layout->font_key));
+      text_layer_set_text_alignment(face_text_layer, (GTextAlignment)face_layout->alignment);
+      if (face_view_cgm.text[face_id] != NULL) {
+        text_layer_set_text(face_text_layer, face_view_cgm.text[face_id]);
+      }
+      face_text_layers_cgm[face_id] = face_text_layer;
+      face_layers_cgm[face_id] = text_layer_get_layer(face_text_layer);
+      break;
+    
+    case FACE_KIND_BITMAP:
+      face_bitmap_layer = bitmap_layer_create(face_layout->frame);
+      if (face_bitmap_layer == NULL) {
+        return NULL;
+      }
+      bitmap_layer_set_alignment(face_bitmap_layer, (GAlign)face_layout->alignment);
+      bitmap_layer_set_background_color(face_bitmap_layer, face_layout->background_color);
+      if (face_view_cgm.bitmap[face_id] != NULL) {
+        bitmap_layer_set_bitmap(face_bitmap_layer, face_view_cgm.bitmap[face_id]);
+      }
+      face_bitmap_layers_cgm[face_id] = face_bitmap_layer;
+      face_layers_cgm[face_id] = bitmap_layer_get_layer(face_bitmap_layer);
+      break;
+    
+    case FACE_KIND_INVERTER:
+      face_inverter_layer_cgm = inverter_layer_create(face_layout->frame);
+      if (face_inverter_layer_cgm == NULL) {
+        return NULL;
+      }
+      face_layers_cgm[face_id] = inverter_layer_get_layer(face_inverter_layer_cgm);
+      break;
+    
+    case FACE_KIND_SPARKLINE:
+      face_layers_cgm[face_id] = layer_create(face_layout->frame);
+      if (face_layers_cgm[face_id] == NULL) {
+        return NULL;
+      }
+      layer_set_update_proc(face_layers_cgm[face_id], sparkline_update_proc_cgm);
+      break;
+  }
+  
+  if (face_view_cgm.hidden[face_id] == 111) {
+    layer_set_hidden(face_layers_cgm[face_id], true);
+  }
+  perf_stats_cgm.face_layer_creates++;
+  return face_layers_cgm[face_id];
+  
+} // end create_face_layer_cgm
+
+static void ensure_face_layer_cgm(const uint8_t face_id) {
+  
+  // VARIABLES
+  Layer *new_face_layer = NULL;
+  
+  // CODE START
+  
+  // only in layer mode with the window up; canvas mode draws optional elements like the rest
+  if ((face_root_layer_cgm == NULL) || (face_layers_cgm[face_id] != NULL)) {
+    return;
+  }
+  
+  new_face_layer = create_face_layer_cgm(face_id);
+  if (new_face_layer == NULL) {
+    return;
+  }
+  
+  // keep the drawing order; go under the next element up that has a layer, or on top if none
+  for (uint8_t above_id = face_id + 1; above_id < FACE_ELEMENT_COUNT; above_id++) {
+    if (face_layers_cgm[above_id] != NULL) {
+      layer_insert_below_sibling(new_face_layer, face_layers_cgm[above_id]);
+      return;
+    }
+  }
+  layer_add_child(face_root_layer_cgm, new_face_layer);
+  
+} // end ensure_face_layer_cgm
+
+static void release_face_layer_cgm(const uint8_t face_id) {
+  
+  // CODE START
+  
+  // the view model keeps what it showed, so ensure_face_layer_cgm can put it back
+  if (face_layers_cgm[face_id] == NULL) {
+    return;
+  }
+  
+  switch (FACE_LAYOUT[face_id].kind) {
+    case FACE_KIND_TEXT:
+      destroy_null_TextLayer(&face_text_layers_cgm[face_id]);
+      break;
+    case FACE_KIND_BITMAP:
+      destroy_null_BitmapLayer(&face_bitmap_layers_cgm[face_id]);
+      break;
+    case FACE_KIND_INVERTER:
+      destroy_null_InverterLayer(&face_inverter_layer_cgm);
+      break;
+    default:
+      layer_destroy(face_layers_cgm[face_id]);
+      break;
+  }
+  face_layers_cgm[face_id] = NULL;
+  perf_stats_cgm.face_layer_destroys++;
+  
+} // end release_face_layer_cgm
+
+static void create_face_layers_cgm(Layer *window_layer_cgm) {
+  
+  // CODE START
+  
+  face_root_layer_cgm = window_layer_cgm;
+  
+  // optional elements get their layer the first time they have something to show
+  for (uint8_t face_id = 0; face_id < FACE_ELEMENT_COUNT; face_id++) {
+    if (FACE_LAYOUT[face_id].optional == 111) {
+      continue;
+    }
+    if (create_face_layer_cgm(face_id) != NULL) {
+      layer_add_child(window_layer_cgm, face_layers_cgm[face_id]);
+    }
+  }
+  
+} // end create_face_layers_cgm
+
+static void create_face_canvas_cgm(Layer *window_layer_cgm) {
+  
+  // CODE START
+  
+  face_canvas_layer_cgm = layer_create(layer_get_bounds(window_layer_cgm));
+  layer_set_update_proc(face_canvas_layer_cgm, face_canvas_update_proc_cgm);
+  layer_add_child(window_layer_cgm, face_canvas_layer_cgm);
+  
+  for (uint8_t face_id = 0; face_id < FACE_ELEMENT_COUNT; face_id++) {
+    if (FACE_LAYOUT[face_id].kind == FACE_KIND_TEXT) {
+      face_fonts_cgm[face_id] = fonts_get_system_font(FACE_LAYOUT[face_id].font_key);
+    }
+  }
+  
+  // no inverter drawing in SDK 2, so the inverter stays a layer; it has to be above what it inverts
+  if (create_face_layer_cgm(FACE_INV_RIG_BATTLEVEL) != NULL) {
+    layer_add_child(window_layer_cgm, face_layers_cgm[FACE_INV_RIG_BATTLEVEL]);
+  }
+  
+} // end create_face_canvas_cgm
+
+static void destroy_face_cgm() {
+  
+  // CODE START
+  
+  face_root_layer_cgm = NULL;
+  for (uint8_t face_id = 0; face_id < FACE_ELEMENT_COUNT; face_id++) {
+    release_face_layer_cgm(face_id);
+  }
+  
+  if (face_canvas_layer_cgm != NULL) {
+    layer_destroy(face_canvas_layer_cgm);
+    face_canvas_layer_cgm = NULL;
+  }
+  
+  // the bitmaps and text buffers it pointed to are gone or will be redrawn on the next load
+  memset(&face_view_cgm, 0, sizeof(face_view_cgm));
+  
+} // end destroy_face_cgm
+
+static void log_face_heap_cgm(const char *log_when) {
+  
+  // VARIABLES
+  uint8_t face_layer_count = 0;
+  
+  // CODE START
+  
+  if (TurnOnPerfStats == 100) {
+    return;
+  }
+  
+  for (uint8_t face_id = 0; face_id < FACE_ELEMENT_COUNT; face_id++) {
+    if (face_layers_cgm[face_id] != NULL) {
+      face_layer_count++;
+    }
+  }
+  
+  // heap in use depends on the mode and on which optional layers are up, so log both
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "PERF, HEAP %s, USED: %u FREE: %u CANVAS: %i FACE LAYERS: %i CREATED: %i DESTROYED: %i", 
+          log_when, (unsigned int)heap_bytes_used(), (unsigned int)heap_bytes_free(), 
+          (face_canvas_layer_cgm != NULL), face_layer_count, 
+          perf_stats_cgm.face_layer_creates, perf_stats_cgm.face_layer_destroys);
+  
+} // end log_face_heap_cgm
+
 void window_load_cgm(Window *window_cgm) {
   //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW LOAD");
   
@@ -2413,224 +4347,56 @@ void window_load_cgm(Window *window_cgm) {
 
   window_layer_cgm = window_get_root_layer(window_cgm);
   
-  // TOPHALF WHITE
-  tophalf_layer = text_layer_create(GRect(0, 0, 144, 83));
-  text_layer_set_text_color(tophalf_layer, GColorBlack);
-  text_layer_set_background_color(tophalf_layer, GColorWhite);
-  text_layer_set_font(tophalf_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD));
-  text_layer_set_text_alignment(tophalf_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(tophalf_layer));
-  
-  // HAPPY MSG LAYER
-  happymsg_layer = text_layer_create(GRect(-10, 33, 144, 55));
-  text_layer_set_text_color(happymsg_layer, GColorBlack);
-  text_layer_set_background_color(happymsg_layer, GColorClear);
-  text_layer_set_font(happymsg_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(happymsg_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(happymsg_layer));
-  
-  // DELTA BG / MESSAGE LAYER
-  message_layer = text_layer_create(GRect(0, 33, 144, 55));
-  text_layer_set_text_color(message_layer, GColorBlack);
-  text_layer_set_background_color(message_layer, GColorClear);
-  text_layer_set_font(message_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD));
-  text_layer_set_text_alignment(message_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(message_layer));
-  
-  // ICON, ARROW OR SPECIAL VALUE
-  icon_layer = bitmap_layer_create(GRect(78, -2, 78, 50));
-  bitmap_layer_set_alignment(icon_layer, GAlignCenter);
-  bitmap_layer_set_background_color(icon_layer, GColorClear);
-  layer_add_child(window_layer_cgm, bitmap_layer_get_layer(icon_layer)); 
-
-  // RIG BATTERY LEVEL
-  rig_battlevel_layer = text_layer_create(GRect(70, 61, 72, 22));
-  text_layer_set_text_color(rig_battlevel_layer, GColorBlack);
-  text_layer_set_background_color(rig_battlevel_layer, GColorClear);
-  text_layer_set_font(rig_battlevel_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(rig_battlevel_layer, GTextAlignmentRight);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(rig_battlevel_layer));
-  
-  // INVERTER BATTERY LAYER
-  inv_rig_battlevel_layer = inverter_layer_create(GRect(112, 66, 30, 15));
-  layer_add_child(window_get_root_layer(window_cgm), inverter_layer_get_layer(inv_rig_battlevel_layer));
-  
-  // BG
-  bg_layer = text_layer_create(GRect(0, -5, 95, 47));
-  text_layer_set_text_color(bg_layer, GColorBlack);
-  text_layer_set_background_color(bg_layer, GColorClear);
-  text_layer_set_font(bg_layer, fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD));
-  text_layer_set_text_alignment(bg_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(bg_layer));
-
-  // CALCULATED RAW INSTEAD OF BG - LAST VALUE (1)
-  calcraw_last1_layer = text_layer_create(GRect(0, -7, 40, 25));
-  text_layer_set_text_color(calcraw_last1_layer, GColorBlack);
-  text_layer_set_background_color(calcraw_last1_layer, GColorClear);
-  text_layer_set_font(calcraw_last1_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(calcraw_last1_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(calcraw_last1_layer));
-  
-  // CALCULATED RAW INSTEAD OF BG - 2ND LAST VALUE (2)
-  calcraw_last2_layer = text_layer_create(GRect(32, 3, 40, 25));
-  text_layer_set_text_color(calcraw_last2_layer, GColorBlack);
-  text_layer_set_background_color(calcraw_last2_layer, GColorClear);
-  text_layer_set_font(calcraw_last2_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(calcraw_last2_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(calcraw_last2_layer)); 
-  
-  // CALCULATED RAW INSTEAD OF BG - 3RD LAST VALUE (3)
-  calcraw_last3_layer = text_layer_create(GRect(63, 16, 40, 25));
-  text_layer_set_text_color(calcraw_last3_layer, GColorBlack);
-  text_layer_set_background_color(calcraw_last3_layer, GColorClear);
-  text_layer_set_font(calcraw_last3_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(calcraw_last3_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(calcraw_last3_layer)); 
-  
-  // PERFECT BG
-  perfectbg_layer = bitmap_layer_create(GRect(0, -7, 95, 47));
-  bitmap_layer_set_alignment(perfectbg_layer, GAlignTopLeft);
-  bitmap_layer_set_background_color(perfectbg_layer, GColorClear);
-  layer_add_child(window_layer_cgm, bitmap_layer_get_layer(perfectbg_layer));
-  
-  // CGM TIME AGO ICON
-  cgmicon_layer = bitmap_layer_create(GRect(0, 63, 40, 19));
-  bitmap_layer_set_alignment(cgmicon_layer, GAlignLeft);
-  bitmap_layer_set_background_color(cgmicon_layer, GColorWhite);
-  layer_add_child(window_layer_cgm, bitmap_layer_get_layer(cgmicon_layer));  
-  
-  // CGM TIME AGO READING
-  cgmtime_layer = text_layer_create(GRect(26, 56, 50, 24));
-  text_layer_set_text_color(cgmtime_layer, GColorBlack);
-  text_layer_set_background_color(cgmtime_layer, GColorClear);
-  text_layer_set_font(cgmtime_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(cgmtime_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(cgmtime_layer));
-
-  // T1D NAME
-  t1dname_layer = text_layer_create(GRect(2, 140, 69, 28));
-  text_layer_set_text_color(t1dname_layer, GColorWhite);
-  text_layer_set_background_color(t1dname_layer, GColorClear);
-  text_layer_set_font(t1dname_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(t1dname_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(t1dname_layer));
-  
-  // WATCH BATTERY LEVEL
-  watch_battlevel_layer = text_layer_create(GRect(71, 145, 72, 22));
-  text_layer_set_text_color(watch_battlevel_layer, GColorWhite);
-  text_layer_set_background_color(watch_battlevel_layer, GColorBlack);
-  text_layer_set_font(watch_battlevel_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_text_alignment(watch_battlevel_layer, GTextAlignmentRight);
+  // ICON ATLAS; only resource decode for icons, everything else is a sub bitmap
+  icon_atlas_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_ICON_ATLAS);
+  
+  // FACE; a layer per element, or one canvas for all of them
+  if (TurnOnCanvasMode == 111) {
+    create_face_canvas_cgm(window_layer_cgm);
+  }
+  else {
+    create_face_layers_cgm(window_layer_cgm);
+  }
+  
+  // WATCH BATTERY LEVEL, SPARKLINE AND DATE; the rest is drawn from the saved reading below
   handle_watch_battery_cgm(battery_state_service_peek());
-  layer_add_child(window_layer_cgm, text_layer_get_layer(watch_battlevel_layer));
-
-  // TIME; CURRENT ACTUAL TIME FROM WATCH
-  time_watch_layer = text_layer_create(GRect(0, 102, 144, 44));
-  text_layer_set_text_color(time_watch_layer, GColorWhite);
-  text_layer_set_background_color(time_watch_layer, GColorClear);
-  text_layer_set_font(time_watch_layer, fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD));
-  text_layer_set_text_alignment(time_watch_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(time_watch_layer));
-  
-  // DATE
-  date_app_layer = text_layer_create(GRect(39, 80, 72, 28));
-  text_layer_set_text_color(date_app_layer, GColorWhite);
-  text_layer_set_background_color(date_app_layer, GColorClear);
-  text_layer_set_font(date_app_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD));
-  text_layer_set_text_alignment(date_app_layer, GTextAlignmentCenter);
+  rebuild_sparkline_cgm();
   draw_date_from_app();
-  layer_add_child(window_layer_cgm, text_layer_get_layer(date_app_layer));
-  
-  // RAW CALCULATED
-  raw_calc_layer = text_layer_create(GRect(0, 76, 40, 25));
-  text_layer_set_text_color(raw_calc_layer, GColorWhite);
-  text_layer_set_background_color(raw_calc_layer, GColorClear);
-  text_layer_set_font(raw_calc_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(raw_calc_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(raw_calc_layer));
-  
-  // NOISE
-  noise_layer = text_layer_create(GRect(85, 76, 58, 27));
-  text_layer_set_text_color(noise_layer, GColorWhite);
-  text_layer_set_background_color(noise_layer, GColorClear);
-  text_layer_set_font(noise_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(noise_layer, GTextAlignmentRight);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(noise_layer));
-  
-  // RAW UNFILT
-  raw_unfilt_layer = text_layer_create(GRect(0, 92, 40, 25)); 
-  text_layer_set_text_color(raw_unfilt_layer, GColorWhite);
-  text_layer_set_background_color(raw_unfilt_layer, GColorClear);
-  text_layer_set_font(raw_unfilt_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  text_layer_set_text_alignment(raw_unfilt_layer, GTextAlignmentLeft);
-  layer_add_child(window_layer_cgm, text_layer_get_layer(raw_unfilt_layer));
-  
-  // put " " (space) in bg field so logo continues to show
-  // " " (space) also shows these are init values, not bad or null values
-  Tuplet initial_values_cgm[] = {
-  TupletCString(CGM_ICON_KEY, " "),
-	TupletCString(CGM_BG_KEY, " "),
-	TupletInteger(CGM_TCGM_KEY, 0),
-	TupletInteger(CGM_TAPP_KEY, 0),
-	TupletCString(CGM_DLTA_KEY, "LOAD"),
-	TupletCString(CGM_UBAT_KEY, " "),
-	TupletCString(CGM_NAME_KEY, " "),
-  TupletCString(CGM_VALS_KEY, " "),
-  TupletCString(CGM_CLRW_KEY, " "),
-  TupletCString(CGM_RWUF_KEY, " "),
-  TupletInteger(CGM_NOIZ_KEY, 0)
-  };
   
-  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW LOAD, ABOUT TO CALL APP SYNC INIT");
-  app_sync_init(&sync_cgm, sync_buffer_cgm, sizeof(sync_buffer_cgm), initial_values_cgm, ARRAY_LENGTH(initial_values_cgm), sync_tuple_changed_callback_cgm, sync_error_callback_cgm, NULL);
+  // default BG ranges, until saved or new thresholds are loaded
+  compile_bg_ranges_cgm();
   
-  // init timer to null if needed, and register timer
-  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW LOAD, APP INIT DONE, ABOUT TO REGISTER TIMER");  
-  if (timer_cgm != NULL) {
-    timer_cgm = NULL;
+  // draw the last saved reading and thresholds if we have them
+  memset(&staged_msg_cgm, 0, sizeof(staged_msg_cgm));
+  if (restore_state_cgm(&staged_msg_cgm) == 100) {
+    // nothing saved; put " " (space) in bg field so logo continues to show
+    // " " (space) also shows these are init values, not bad or null values
+    memset(&staged_msg_cgm, 0, sizeof(staged_msg_cgm));
+    init_reading_cgm(&staged_msg_cgm, CGM_STATUS_LOAD);
+    staged_msg_cgm.received_keys = (1 << CGM_DATA_KEY);
+  
+    //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW LOAD, ABOUT TO COMMIT INITIAL VALUES");
+    commit_message_cgm(&staged_msg_cgm);
   }
-  timer_cgm = app_timer_register((LOADING_MSGSEND_SECS*MS_IN_A_SECOND), timer_callback_cgm, NULL);
+  
+  // register timer
+  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW LOAD, APP INIT DONE, ABOUT TO REGISTER TIMER");  
+  schedule_fetch_cgm(LOADING_MSGSEND_MS);
+  fetch_start_time_cgm = time(NULL);
   //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW LOAD, TIMER REGISTER DONE");
   
+  log_face_heap_cgm("LOAD");
+  
 } // end window_load_cgm
 
 void window_unload_cgm(Window *window_cgm) {
   //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD IN");
   
-  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD, APP SYNC DEINIT");
-  app_sync_deinit(&sync_cgm);
+  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD, DESTROY FACE LAYERS IF EXIST");
+  destroy_face_cgm();
   
   //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD, DESTROY GBITMAPS IF EXIST");
-  destroy_null_GBitmap(&icon_bitmap);
-  destroy_null_GBitmap(&cgmicon_bitmap);
-  destroy_null_GBitmap(&specialvalue_bitmap);
-  destroy_null_GBitmap(&perfectbg_bitmap);
-  
-  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD, DESTROY BITMAPS IF EXIST");  
-  destroy_null_BitmapLayer(&icon_layer);
-  destroy_null_BitmapLayer(&cgmicon_layer);
-  destroy_null_BitmapLayer(&perfectbg_layer);
-
-  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD, DESTROY TEXT LAYERS IF EXIST");  
-  destroy_null_TextLayer(&tophalf_layer);
-  destroy_null_TextLayer(&bg_layer);
-  destroy_null_TextLayer(&cgmtime_layer);
-  destroy_null_TextLayer(&message_layer);
-  destroy_null_TextLayer(&rig_battlevel_layer);
-  destroy_null_TextLayer(&watch_battlevel_layer);  
-  destroy_null_TextLayer(&t1dname_layer);
-  destroy_null_TextLayer(&time_watch_layer);
-  destroy_null_TextLayer(&date_app_layer);
-  destroy_null_TextLayer(&happymsg_layer);
-  destroy_null_TextLayer(&raw_calc_layer);
-  destroy_null_TextLayer(&raw_unfilt_layer);
-  destroy_null_TextLayer(&noise_layer);
-  destroy_null_TextLayer(&calcraw_last1_layer);
-  destroy_null_TextLayer(&calcraw_last2_layer);
-  destroy_null_TextLayer(&calcraw_last3_layer);
-
-  //APP_LOG(APP_LOG_LEVEL_INFO, "WINDOW UNLOAD, DESTROY INVERTER LAYERS IF EXIST");  
-  destroy_null_InverterLayer(&inv_rig_battlevel_layer);
+  destroy_icon_cache();
   
   // destroy animation
   //destroy_perfectbg_animation(&perfectbg_animation);
@@ -2642,10 +4408,15 @@ void window_unload_cgm(Window *window_cgm) {
 static void init_cgm(void) {
   //APP_LOG(APP_LOG_LEVEL_INFO, "INIT CODE IN");
 
+  // seed the retry jitter
+  srand(time(NULL));
+  
   // subscribe to the tick timer service
   tick_timer_service_subscribe(MINUTE_UNIT, &handle_minute_tick_cgm);
 
-  // subscribe to the bluetooth connection service
+  // subscribe to the bluetooth connection service; the only peek, after this the handler keeps it
+  bluetooth_connected_cgm = bluetooth_connection_service_peek();
+  bt_stats_cgm.changed_time = time(NULL);
   bluetooth_connection_service_subscribe(&handle_bluetooth_cgm);
   
   // subscribe to the watch battery state service
@@ -2665,12 +4436,14 @@ static void init_cgm(void) {
     .unload = window_unload_cgm  
   });
   
-  //APP_LOG(APP_LOG_LEVEL_INFO, "INIT CODE, REGISTER APP MESSAGE ERROR HANDLERS"); 
+  //APP_LOG(APP_LOG_LEVEL_INFO, "INIT CODE, REGISTER APP MESSAGE HANDLERS"); 
+  app_message_register_inbox_received(inbox_received_handler_cgm);
   app_message_register_inbox_dropped(inbox_dropped_handler_cgm);
   app_message_register_outbox_failed(outbox_failed_handler_cgm);
   
   //APP_LOG(APP_LOG_LEVEL_INFO, "INIT CODE, ABOUT TO CALL APP MSG OPEN"); 
-  app_message_open(app_message_inbox_size_maximum(), app_message_outbox_size_maximum());
+  // inbox only has to hold one data and one settings array; outbox only sends the request
+  app_message_open(dict_calc_buffer_size(3, CGM_DATA_MAX_SIZE, CGM_VALS_SIZE, CGM_HIST_MAX_SIZE), APPMSG_OUTBOX_SIZE);
   //APP_LOG(APP_LOG_LEVEL_INFO, "INIT CODE, APP MSG OPEN DONE");
   
   const bool animated_cgm = true;
@@ -2695,15 +4468,13 @@ static void deinit_cgm(void) {
   
   // cancel timers if they exist
   //APP_LOG(APP_LOG_LEVEL_INFO, "DEINIT, CANCEL APP TIMER");
-  if (timer_cgm != NULL) {
-    app_timer_cancel(timer_cgm);
-    timer_cgm = NULL;
+  // fetch, bluetooth and retry timers are all on the one wheel timer
+  for (uint8_t timer_index = 0; timer_index < WATCH_TIMER_COUNT; timer_index++) {
+    watch_timers_cgm[timer_index].armed = 100;
   }
-  
-  //APP_LOG(APP_LOG_LEVEL_INFO, "DEINIT, CANCEL BLUETOOTH TIMER");
-  if (BT_timer != NULL) {
-    app_timer_cancel(BT_timer);
-    BT_timer = NULL;
+  if (wheel_timer_cgm != NULL) {
+    app_timer_cancel(wheel_timer_cgm);
+    wheel_timer_cgm = NULL;
   }
   
   // destroy the window if it exists
@@ -0,0 +1,50 @@
+#pragma once
+
+// GENERATED BY tools/pack_icon_atlas.py; DO NOT EDIT BY HAND
+// ATLAS 160x197, DECODED 3940 BYTES; ALL ICONS DECODED SEPARATELY 4188 BYTES
+
+enum IconAtlasIndex {
+  ICON_SPECVALUE_NONE = 0,
+  ICON_UPUP = 1,
+  ICON_UP = 2,
+  ICON_UP45 = 3,
+  ICON_FLAT = 4,
+  ICON_DOWN45 = 5,
+  ICON_DOWN = 6,
+  ICON_DOWNDOWN = 7,
+  ICON_LOGO = 8,
+  ICON_BROKEN_ANTENNA = 9,
+  ICON_BLOOD_DROP = 10,
+  ICON_STOP_LIGHT = 11,
+  ICON_HOURGLASS = 12,
+  ICON_QUESTION_MARKS = 13,
+  ICON_RCVRNONE = 14,
+  ICON_RCVRON = 15,
+  ICON_RCVROFF = 16,
+  ICON_CLUB100 = 17,
+  ICON_CLUB55 = 18,
+  ICON_ATLAS_COUNT = 19
+};
+
+// POSITION OF EACH ICON IN RESOURCE_ID_IMAGE_ICON_ATLAS
+static const GRect ICON_ATLAS_RECTS[] = {
+  { { 97, 166 }, { 5, 5 } },  // ICON_SPECVALUE_NONE
+  { { 95, 0 }, { 50, 40 } },  // ICON_UPUP
+  { { 62, 127 }, { 31, 37 } },  // ICON_UP
+  { { 80, 87 }, { 39, 39 } },  // ICON_UP45
+  { { 0, 166 }, { 44, 31 } },  // ICON_FLAT
+  { { 120, 87 }, { 39, 39 } },  // ICON_DOWN45
+  { { 0, 127 }, { 31, 38 } },  // ICON_DOWN
+  { { 0, 46 }, { 50, 40 } },  // ICON_DOWNDOWN
+  { { 32, 127 }, { 29, 38 } },  // ICON_LOGO
+  { { 52, 0 }, { 42, 41 } },  // ICON_BROKEN_ANTENNA
+  { { 24, 0 }, { 27, 43 } },  // ICON_BLOOD_DROP
+  { { 0, 0 }, { 23, 45 } },  // ICON_STOP_LIGHT
+  { { 51, 46 }, { 25, 40 } },  // ICON_HOURGLASS
+  { { 94, 127 }, { 47, 33 } },  // ICON_QUESTION_MARKS
+  { { 103, 166 }, { 5, 5 } },  // ICON_RCVRNONE
+  { { 45, 166 }, { 25, 18 } },  // ICON_RCVRON
+  { { 71, 166 }, { 25, 18 } },  // ICON_RCVROFF
+  { { 77, 46 }, { 79, 39 } },  // ICON_CLUB100
+  { { 0, 87 }, { 79, 39 } },  // ICON_CLUB55
+};
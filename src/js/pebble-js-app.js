@@ -1,10 +1,282 @@
+// binary message format; has to match CgmDataOffset, CgmValsOffset and CgmHistOffset in cgm.c
+// every key is sent as a byte array, numbers little endian
+// BG values are integers; for mmol the last digit is the decimal (5.6 is sent as 56)
+var CGM_PROTOCOL_VERSION = 3,
+    CGM_STATUS_READING = 0,
+    CGM_STATUS_NOEP = 2,
+    CGM_STATUS_OFF = 3,
+    CGM_STATUS_SAME = 4,
+    CGM_FLAG_MMOL = 0x01,
+    CGM_FLAG_PRSS = 0x02,
+    CGM_DELTA_ERR = -32768,
+    CGM_UBAT_NONE = 255,
+    CGM_UBAT_ERR = 254,
+    CGM_RAW_NONE = -1,
+    CGM_RAW_LO = -2,
+    CGM_RAW_HI = -3,
+    CGM_RAW_ERR = -4,
+    CGM_RAW_CAL = -5,
+    CGM_NAME_MAX = 9,
+    // history chunk is 7 header bytes and 5 bytes per entry; 9 entries is CGM_HIST_MAX_SIZE on the watch
+    CGM_HIST_CHUNK_MAX = 9,
+    // watch keeps 36 readings; ask for that many when it has missed some
+    CGM_HIST_COUNT = 36,
+    CGM_HIST_GAP_SECS = 600;
+
+// settings are only sent when they change; on config close, on first connect,
+// or when the config version the watch reports is not ours
+var settingsNeeded = true;
+
+// cgm time of the newest reading the watch has, from its last request; 0 means it has none
+var watchLastTcgm = 0;
+
+// name or units changed on the phone; the watch gets a whole reading even if it has this one
+var fullReadingNeeded = false;
+
+// config version is bumped every time the config page is closed; 0 means watch has no settings
+function getCfgVersion() {
+    return parseInt(window.localStorage.getItem('cgmPebbleCfgVersion'), 10) || 1;
+}
+
+function bumpCfgVersion() {
+    var cfgVersion = (getCfgVersion() % 65535) + 1;
+    window.localStorage.setItem('cgmPebbleCfgVersion', cfgVersion);
+    return cfgVersion;
+}
+
+function pushInt16(bytes, value) {
+    bytes.push(value & 0xFF, (value >> 8) & 0xFF);
+}
+
+function pushUint32(bytes, value) {
+    bytes.push(value & 0xFF, (value >>> 8) & 0xFF, (value >>> 16) & 0xFF, (value >>> 24) & 0xFF);
+}
+
+// convert a mg/dL or mmol value to the integer sent to the watch; mmol keeps one decimal
+function toFixedBG(value, isMmol) {
+    var bg = Number(value);
+    if ( (value === null) || (isNaN(bg)) ) { return 0; }
+    bg = Math.round(isMmol ? bg * 10 : bg);
+    return Math.max(-32767, Math.min(32767, bg));
+}
+
+// status only message; no endpoint or data offline
+function encodeStatus(status) {
+    return [CGM_PROTOCOL_VERSION, status];
+}
+
+// watch already has this reading; only the app time is new
+function encodeSame(tcgm, tapp) {
+    var bytes = [CGM_PROTOCOL_VERSION, CGM_STATUS_SAME];
+    pushUint32(bytes, tcgm);
+    pushUint32(bytes, tapp);
+    return bytes;
+}
+
+// missed readings, oldest first; each entry is {time, bg, arrow, noise}
+// returns one byte array per chunk, time is sent as seconds since the entry before
+function encodeHistory(entries, flags) {
+    var chunks = [], bytes = null, count = 0, lastTime = 0, timeDelta = 0;
+    
+    for (var i = 0; i < entries.length; i++) {
+      timeDelta = entries[i].time - lastTime;
+      // start a new chunk when full, or when the gap doesn't fit in 16 bits
+      if ( (bytes === null) || (count >= CGM_HIST_CHUNK_MAX) || (timeDelta > 65535) ) {
+        bytes = [CGM_PROTOCOL_VERSION, flags, 0];
+        pushUint32(bytes, entries[i].time);
+        chunks.push(bytes);
+        count = 0;
+        timeDelta = 0;
+      }
+      pushInt16(bytes, timeDelta);
+      pushInt16(bytes, entries[i].bg);
+      bytes.push((entries[i].arrow & 0x0F) | ((Math.min(15, entries[i].noise) & 0x0F) << 4));
+      bytes[2] = ++count;
+      lastTime = entries[i].time;
+    }
+    return chunks;
+}
+
+// convert arrow to a number; sending one byte to save memory
+// putting NOT COMPUTABLE first because that's most common and can get out fastest
+function directionToIcon(direction) {
+    switch (direction) {
+      case "NOT COMPUTABLE": return 8;
+      case "NONE": return 0;
+      case "DoubleUp": return 1;
+      case "SingleUp": return 2;
+      case "FortyFiveUp": return 3;
+      case "Flat": return 4;
+      case "FortyFiveDown": return 5;
+      case "SingleDown": return 6;
+      case "DoubleDown": return 7;
+      case "RATE OUT OF RANGE": return 9;
+      default: return 10;
+    }
+}
+
+function encodeReading(reading) {
+    var bytes = [CGM_PROTOCOL_VERSION, CGM_STATUS_READING, reading.flags, reading.arrow],
+    name = String(reading.name).substring(0, CGM_NAME_MAX),
+    charCode = 0;
+    
+    pushInt16(bytes, reading.bg);
+    pushInt16(bytes, reading.delta);
+    pushUint32(bytes, reading.tcgm);
+    pushUint32(bytes, reading.tapp);
+    bytes.push(reading.battery, reading.noise);
+    pushInt16(bytes, reading.calcRaw);
+    pushInt16(bytes, reading.rawUnfilt);
+    
+    // name is not null terminated; watch font only has ascii
+    bytes.push(name.length);
+    for (var i = 0; i < name.length; i++) {
+      charCode = name.charCodeAt(i);
+      bytes.push(charCode < 128 ? charCode : 63);
+    }
+    return bytes;
+}
+
+function encodeSettings(opts) {
+    var bytes = [CGM_PROTOCOL_VERSION, (opts.radio == "mgdl_form") ? 0 : 1];
+    
+    // same as atoi on the watch before; mmol thresholds are already sent without the decimal
+    pushInt16(bytes, parseInt(opts.lowbg, 10) || 0);   //Low BG Level
+    pushInt16(bytes, parseInt(opts.highbg, 10) || 0);  //High BG Level
+    bytes.push(
+      (parseInt(opts.lowsnooze, 10) || 0) & 0xFF,    //LowSnooze minutes
+      (parseInt(opts.highsnooze, 10) || 0) & 0xFF,   //HighSnooze minutes
+      (parseInt(opts.lowvibe, 10) || 0) & 0xFF,      //Low Vibration
+      (parseInt(opts.highvibe, 10) || 0) & 0xFF,     //High Vibration
+      (parseInt(opts.vibepattern, 10) || 0) & 0xFF,  //Vibration Pattern
+      (opts.timeformat == "12") ? 0 : 1,             //Time Format 12 Hour = 0; 24 Hour = 1
+      (opts.rawvibrate == "1") ? 1 : 0               //Vibrate on raw value in special value, if have raw
+    );
+    pushInt16(bytes, getCfgVersion());
+    return bytes;
+}
+
+// one request to the endpoint at a time; watch requests that come in while it's out share its answer
+// a parsed answer is kept for CGM_CACHE_TTL_MS, so a request right after a fetch needs no network
+// after that the request is conditional; 304 reuses the last parsed answer, no download or JSON.parse
+var CGM_CACHE_TTL_MS = 10000,
+    CGM_FETCH_TIMEOUT_MS = 59000;  // can not go beyond 59 seconds
+
+var cgmFetch = {
+    pending: null,
+    cache: null,
+    validated: null,
+    hits: 0,
+    misses: 0,
+    shared: 0,
+    notModified: 0,
+    fetchMs: 0
+};
+
+function logCgmFetchStats(result, latencyMs) {
+    console.log("CGM fetch " + result + " in " + latencyMs + " ms; hits: " + cgmFetch.hits + 
+      " misses: " + cgmFetch.misses + " shared: " + cgmFetch.shared + " not modified: " + cgmFetch.notModified + 
+      " avg fetch ms: " + (cgmFetch.misses ? Math.round(cgmFetch.fetchMs / cgmFetch.misses) : 0));
+}
+
+// calls back with the parsed response, or null if the endpoint didn't answer
+// a history request can't be answered from a request without history; any other one can
+function getCgmResponse(opts, wantHistory, callback) {
+    var now = Date.now(), cache = cgmFetch.cache, pending = cgmFetch.pending, url = opts.endpoint;
+    
+    if ( cache && (cache.endpoint == opts.endpoint) && (now - cache.time < CGM_CACHE_TTL_MS) && 
+      (cache.history || !wantHistory) ) {
+        cgmFetch.hits++;
+        logCgmFetchStats("hit", Date.now() - now);
+        callback(cache.response);
+        return;
+    }
+    
+    if ( pending && (pending.endpoint == opts.endpoint) && (pending.history || !wantHistory) ) {
+        cgmFetch.shared++;
+        pending.callbacks.push(callback);
+        return;
+    }
+    
+    cgmFetch.misses++;
+    pending = {
+      endpoint: opts.endpoint,
+      history: wantHistory,
+      callbacks: [callback],
+      start: now,
+      done: false
+    };
+    cgmFetch.pending = pending;
+    
+    // if the watch missed readings, ask for enough to fill its history
+    if (wantHistory) {
+      url = opts.endpoint + ((opts.endpoint.indexOf('?') < 0) ? '?' : '&') + 'count=' + CGM_HIST_COUNT;
+    }
+    
+    var req = new XMLHttpRequest();
+    var validated = (cgmFetch.validated && (cgmFetch.validated.url == url)) ? cgmFetch.validated : null;
+    var finish = function (response, result) {
+        if (pending.done) { return; }
+        pending.done = true;
+        clearTimeout(myCGMTimeout);
+        if (cgmFetch.pending === pending) { cgmFetch.pending = null; }
+        cgmFetch.fetchMs += Date.now() - pending.start;
+        if (response) {
+          cgmFetch.cache = { endpoint: pending.endpoint, history: pending.history, response: response, time: Date.now() };
+        }
+        logCgmFetchStats(result, Date.now() - pending.start);
+        pending.callbacks.forEach(function (waiting) { waiting(response); });
+    };
+    
+    req.open('GET', url, true);
+    req.setRequestHeader('Cache-Control', 'no-cache');
+    if (validated && validated.etag) { req.setRequestHeader('If-None-Match', validated.etag); }
+    if (validated && validated.lastModified) { req.setRequestHeader('If-Modified-Since', validated.lastModified); }
+    req.onload = function(e) {
+        if (req.readyState != 4) { return; }
+        if (req.status == 304 && validated) {
+            // nothing new; same answer as last time
+            cgmFetch.notModified++;
+            finish(validated.response, "not modified");
+        }
+        else if (req.status == 200) {
+            var response = null;
+            try {
+              response = JSON.parse(req.responseText);
+            } catch (err) {
+              console.log("CGM fetch, bad JSON: " + err);
+            }
+            // keep the validators for the next request to this url
+            cgmFetch.validated = response ? {
+              url: url,
+              etag: req.getResponseHeader('ETag'),
+              lastModified: req.getResponseHeader('Last-Modified'),
+              response: response
+            } : null;
+            finish(response, response ? "miss" : "fail");
+        }
+        else {
+            // error status, or a 304 we have nothing cached for; don't leave the waiting callers hanging
+            finish(null, "fail");
+        }
+    }; // req.onload
+    req.onerror = function(e) {
+        finish(null, "fail");
+    }; // req.onerror
+    req.send(null);
+    var myCGMTimeout = setTimeout (function () {
+      req.abort();
+      finish(null, "fail");
+    }, CGM_FETCH_TIMEOUT_MS );
+} // end getCgmResponse
+
 // main function to retrieve, format, and send cgm data
 function fetchCgmData() {
   
     //console.log ("START fetchCgmData");
                 
     // declare local variables for message data
-    var response, responsebgs, responsecals, message;
+    var message;
 
     //get options from configuration window
     var opts = [ ].slice.call(arguments).pop( );
@@ -13,19 +285,9 @@ function fetchCgmData() {
 	// check if endpoint exists
     if (!opts.endpoint) {
         // endpoint doesn't exist, return no endpoint to watch
-		// " " (space) shows these are init values, not bad or null values
+		// watch goes back to init values on this status
         message = {
-          icon: " ",
-          bg: " ",
-          tcgm: 0,
-          tapp: 0,
-          dlta: "NOEP",
-          ubat: " ",
-          name: " ",
-          vals: " ",
-          clrw: " ",
-          rwuf: " ",
-          noiz: 0
+          data: encodeStatus(CGM_STATUS_NOEP)
         };
         
         console.log("NO ENDPOINT JS message", JSON.stringify(message));
@@ -36,313 +298,334 @@ function fetchCgmData() {
     // show current options
     //console.log("fetchCgmData IN OPTIONS = " + JSON.stringify(opts));
   
-    // call XML
-    var req = new XMLHttpRequest();
+    // get cgm data; if the watch missed readings, ask for enough to fill its history
+    var wantHistory = ( (watchLastTcgm === 0) || 
+      ((Math.floor(Date.now() / 1000) - (new Date().getTimezoneOffset() * 60)) - watchLastTcgm > CGM_HIST_GAP_SECS) );
     
-    // get cgm data
-    req.open('GET', opts.endpoint, true);
-    
-    req.setRequestHeader('Cache-Control', 'no-cache');
-	
-    req.onload = function(e) {
+    var fetchStart = Date.now();
+    getCgmResponse(opts, wantHistory, function (response) {
+        sendCgmData(opts, response, fetchStart);
+    });
+} // end fetchCgmData
 
-        if (req.readyState == 4) {
+// queue a message for the watch; log how long it took from the watch request to the watch ack
+function sendToWatch(message, fetchStart) {
+    MessageQueue.sendAppMessage(message, function () {
+        console.log("JS fetch to watch ack ms: " + (Date.now() - fetchStart) + " queue: " + JSON.stringify(MessageQueue.stats()));
+    });
+}
 
-            if(req.status == 200) {
-                
-                // clear the XML timeout
-                clearTimeout(myCGMTimeout);
-              
-                // Load response   
-                response = JSON.parse(req.responseText);
-                responsebgs = response.bgs;
-                responsecals = response.cals;
-                
-                // check response data
-                if (responsebgs && responsebgs.length > 0) {
-
-                    // response data is good; send log with response 
-                    // console.log('got response', JSON.stringify(response));
-
-                    // initialize message data
-                  
-                    // get direction arrow and BG
-                    var currentDirection = responsebgs[0].direction,
-                    values = " ",
-                    currentIcon = "10",
-                    currentBG = responsebgs[0].sgv,
-                    //currentBG = "107",
-                    currentConvBG = currentBG,
-                    rawCalcOffset = 5,
-                    specialValue = false,
-                    calibrationValue = false,
-
-                    // get timezone offset
-                    timezoneDate = new Date(),
-                    timezoneOffset = timezoneDate.getTimezoneOffset(),
-                        
-                    // get CGM time delta and format
-                    readingTime = new Date(responsebgs[0].datetime).getTime(),
-                    //readingTime = null,
-                    formatReadTime = Math.floor( (readingTime / 1000) - (timezoneOffset * 60) ),
-
-                    // get app time and format
-                    appTime = new Date().getTime(),
-                    //appTime = null,
-                    formatAppTime = Math.floor( (appTime / 1000) - (timezoneOffset * 60) ),   
-                    
-                    // get BG delta and format
-                    currentBGDelta = responsebgs[0].bgdelta,
-                    //currentBGDelta = -8,
-                    formatBGDelta = " ",
-
-                    // get battery level
-                    currentBattery = responsebgs[0].battery,
-                    //currentBattery = "100",
- 
-                   // get NameofT1DPerson and IOB
-                    NameofT1DPerson = opts.t1name,
-                    currentIOB = responsebgs[0].iob,
- 
-                    // sensor fields
-                    currentCalcRaw = 0,
-                    //currentCalcRaw = 100000,
-                    formatCalcRaw = " ",
-                    currentRawFilt = responsebgs[0].filtered,
-                    formatRawFilt = " ",
-                    currentRawUnfilt = responsebgs[0].unfiltered,
-                    formatRawUnfilt = " ",
-                    currentNoise = responsebgs[0].noise,
-                    currentIntercept = "undefined",
-                    currentSlope = "undefined",
-                    currentScale = "undefined",
-                    currentRatio = 0;
-  
-                    // get name of T1D; if iob (case insensitive), use IOB
-                    if ( (NameofT1DPerson.toUpperCase() === "IOB") && 
-                    ((typeof currentIOB != "undefined") && (currentIOB !== null)) ) {
-                      NameofT1DPerson = "IOB:" + currentIOB;
-                    }
-                    else {
-                      NameofT1DPerson = opts.t1name;
-                    }
+// format a parsed endpoint response and send it to the watch; no response is data offline
+function sendCgmData(opts, response, fetchStart) {
   
-                    if (responsecals && responsecals.length > 0) {
-                      currentIntercept = responsecals[0].intercept;
-                      currentSlope = responsecals[0].slope;
-                      currentScale = responsecals[0].scale;
-                    }
-                  
-                    //currentDirection = "NONE";
+    // declare local variables for message data
+    var responsebgs = response ? response.bgs : null,
+    responsecals = response ? response.cals : null,
+    message;
+    
+    // response is shared with the cache; only read it here
+    
+    // check response data
+    if (responsebgs && responsebgs.length > 0) {
 
-                    // set some specific flags needed for later
-                    if (opts.radio == "mgdl_form") { 
-                      if ( (currentBG < 40) || (currentBG > 400) ) { specialValue = true; }
-                      if (currentBG == 5) { calibrationValue = true; }
-                    }
-                    else {
-                      if ( (currentBG < 2.3) || (currentBG > 22.2) ) { specialValue = true; }
-                      if (currentBG == 0.3) { calibrationValue = true; }
-                      currentConvBG = (Math.round(currentBG * 18.018).toFixed(0));                                                                   
-                    }
-              
-                    // convert arrow to a number string; sending number string to save memory
-                    // putting NOT COMPUTABLE first because that's most common and can get out fastest
-                    switch (currentDirection) {
-                      case "NOT COMPUTABLE": currentIcon = "8"; break;
-                      case "NONE": currentIcon = "0"; break;
-                      case "DoubleUp": currentIcon = "1"; break;
-                      case "SingleUp": currentIcon = "2"; break;
-                      case "FortyFiveUp": currentIcon = "3"; break;
-                      case "Flat": currentIcon = "4"; break;
-                      case "FortyFiveDown": currentIcon = "5"; break;
-                      case "SingleDown": currentIcon = "6"; break;
-                      case "DoubleDown": currentIcon = "7"; break;
-                      case "RATE OUT OF RANGE": currentIcon = "9"; break;
-                      default: currentIcon = "10";
-                    }
+        // response data is good; send log with response 
+        // console.log('got response', JSON.stringify(response));
+
+        // initialize message data
+      
+        // get direction arrow and BG
+        var currentDirection = responsebgs[0].direction,
+        isMmol = (opts.radio != "mgdl_form"),
+        messageFlags = 0,
+        currentIcon = 10,
+        currentBG = responsebgs[0].sgv,
+        //currentBG = "107",
+        currentConvBG = currentBG,
+        rawCalcOffset = 5,
+        specialValue = false,
+        calibrationValue = false,
+
+        // get timezone offset
+        timezoneDate = new Date(),
+        timezoneOffset = timezoneDate.getTimezoneOffset(),
+            
+        // get CGM time delta and format
+        readingTime = new Date(responsebgs[0].datetime).getTime(),
+        //readingTime = null,
+        formatReadTime = Math.floor( (readingTime / 1000) - (timezoneOffset * 60) ),
+
+        // get app time and format
+        appTime = new Date().getTime(),
+        //appTime = null,
+        formatAppTime = Math.floor( (appTime / 1000) - (timezoneOffset * 60) ),   
+        
+        // get BG delta and format
+        currentBGDelta = responsebgs[0].bgdelta,
+        //currentBGDelta = -8,
+        formatBGDelta = CGM_DELTA_ERR,
+
+        // get battery level
+        currentBattery = responsebgs[0].battery,
+        //currentBattery = "100",
+
+       // get NameofT1DPerson and IOB
+        NameofT1DPerson = opts.t1name,
+        currentIOB = responsebgs[0].iob,
+
+        // sensor fields
+        currentCalcRaw = 0,
+        //currentCalcRaw = 100000,
+        formatCalcRaw = CGM_RAW_NONE,
+        currentRawFilt = responsebgs[0].filtered,
+        formatRawFilt = " ",
+        currentRawUnfilt = responsebgs[0].unfiltered,
+        formatRawUnfilt = CGM_RAW_NONE,
+        currentNoise = responsebgs[0].noise,
+        currentIntercept = "undefined",
+        currentSlope = "undefined",
+        currentScale = "undefined",
+        currentRatio = 0;
+
+        // get name of T1D; if iob (case insensitive), use IOB
+        if ( (NameofT1DPerson.toUpperCase() === "IOB") && 
+        ((typeof currentIOB != "undefined") && (currentIOB !== null)) ) {
+          NameofT1DPerson = "IOB:" + currentIOB;
+        }
+        else {
+          NameofT1DPerson = opts.t1name;
+        }
+        
+        // watch already has this reading; IOB changes without a new reading, so always send that
+        if ( (!fullReadingNeeded) && (watchLastTcgm !== 0) && (formatReadTime == watchLastTcgm) && (NameofT1DPerson == opts.t1name) ) {
+          message = {
+            data: encodeSame(formatReadTime, formatAppTime)
+          };
+          if (settingsNeeded) {
+            message.vals = encodeSettings(opts);
+            settingsNeeded = false;
+          }
+          console.log("JS send same message: " + JSON.stringify(message));
+          sendToWatch(message, fetchStart);
+          return;
+        }
+
+        if (responsecals && responsecals.length > 0) {
+          currentIntercept = responsecals[0].intercept;
+          currentSlope = responsecals[0].slope;
+          currentScale = responsecals[0].scale;
+        }
+      
+        //currentDirection = "NONE";
+
+        // set some specific flags needed for later
+        if (opts.radio == "mgdl_form") { 
+          if ( (currentBG < 40) || (currentBG > 400) ) { specialValue = true; }
+          if (currentBG == 5) { calibrationValue = true; }
+        }
+        else {
+          if ( (currentBG < 2.3) || (currentBG > 22.2) ) { specialValue = true; }
+          if (currentBG == 0.3) { calibrationValue = true; }
+          currentConvBG = (Math.round(currentBG * 18.018).toFixed(0));                                                                   
+        }
+  
+        currentIcon = directionToIcon(currentDirection);
 					
-                    // if no battery being sent yet, then send nothing to watch
-                    // console.log("Battery Value: " + currentBattery);
-                    if ( (typeof currentBattery == "undefined") || (currentBattery === null) ) {
-                      currentBattery = " ";  
-                    }
-                  
-                    // assign bg delta string
-                    formatBGDelta = ((currentBGDelta > 0 ? '+' : '') + currentBGDelta);
-
-                    //console.log("Current Unfiltered: " + currentRawUnfilt);                  
-                    //console.log("Current Intercept: " + currentIntercept);
-                    //console.log("Special Value Flag: " + specialValue);
-                    //console.log("Current BG: " + currentBG);
-                  
-                    // assign calculated raw value if we can
-                    if ( (typeof currentIntercept != "undefined") && (currentIntercept !== null) ){
-                        if (specialValue) {
-                          // don't use ratio adjustment
-                          currentCalcRaw = ((currentScale * (currentRawUnfilt - currentIntercept) / currentSlope)*1 - rawCalcOffset*1);
-                          //console.log("Special Value Calculated Raw: " + currentCalcRaw);
-                        } 
-                        else {
-                          currentRatio = (currentScale * (currentRawFilt - currentIntercept) / currentSlope / (currentConvBG*1 + rawCalcOffset*1));
-                          currentCalcRaw = ((currentScale * (currentRawUnfilt - currentIntercept) / currentSlope / currentRatio)*1 - rawCalcOffset*1);
-                          //console.log("Current Converted BG: " + currentConvBG);
-                          //console.log("Current Ratio: " + currentRatio);
-                          //console.log("Normal BG Calculated Raw: " + currentCalcRaw);
-                        }          
-                    } // if currentIntercept                  
-
-                    // assign raw sensor values if they exist
-                    if ( (typeof currentRawUnfilt != "undefined") && (currentRawUnfilt !== null) ) {
-                      
-                      // zero out any invalid values; defined anything not between 0 and 900
-                      if ( (currentRawFilt < 0) || (currentRawFilt > 900000) || 
-                            (isNaN(currentRawFilt)) ) { currentRawFilt = "ERR"; }
-                      if ( (currentRawUnfilt < 0) || (currentRawUnfilt > 900000) || 
-                            (isNaN(currentRawUnfilt)) ) { currentRawUnfilt = "ERR"; }
-                      
-                      // set 0, LO and HI in calculated raw
-                      if ( (currentCalcRaw >= 0) && (currentCalcRaw < 30) ) { formatCalcRaw = "LO"; }
-                      if ( (currentCalcRaw > 500) && (currentCalcRaw <= 900) ) { formatCalcRaw = "HI"; }
-                      if ( (currentCalcRaw < 0 ) || (currentCalcRaw > 900) ) { formatCalcRaw = "ERR"; }
-                      
-                      // if slope is 0 or if currentCalcRaw is NaN, 
-                      // calculated raw is invalid and need a calibration
-                      if ( (currentSlope === 0) || (isNaN(currentCalcRaw)) ) { formatCalcRaw = "CAL"; }
-                      
-                      // check for compression warning
-                      if ( ((currentCalcRaw < (currentRawFilt/1000)) && (!calibrationValue)) && (currentRawFilt !== 0) ){
-                        var compressionSlope = 0;
-                        compressionSlope = (((currentRawFilt/1000) - currentCalcRaw)/(currentRawFilt/1000));
-                        //console.log("compression slope: " + compressionSlope);
-                        if (compressionSlope > 0.7) {
-                          // set COMPRESSION? message
-                          formatBGDelta = "PRSS";
-                        } // if compressionSlope
-                      } // if check for compression condition
-                      
-                      if (opts.radio == "mgdl_form") { 
-                        formatRawFilt = ((Math.round(currentRawFilt / 1000)).toFixed(0));
-                        formatRawUnfilt = ((Math.round(currentRawUnfilt / 1000)).toFixed(0));
-                        if ( (formatCalcRaw != "LO") && (formatCalcRaw != "HI") && 
-                             (formatCalcRaw != "ERR") && (formatCalcRaw != "CAL") ) 
-                            { formatCalcRaw = ((Math.round(currentCalcRaw)).toFixed(0)); }
-                        //console.log("Format Unfiltered: " + formatRawUnfilt);
-                      } 
-                      else {
-                        formatRawFilt = ((Math.round(((currentRawFilt/1000)*0.0555) * 10) / 10).toFixed(1));
-                        formatRawUnfilt = ((Math.round(((currentRawUnfilt/1000)*0.0555) * 10) / 10).toFixed(1));
-                        if ( (formatCalcRaw != "LO") && (formatCalcRaw != "HI") &&
-                             (formatCalcRaw != "ERR") && (formatCalcRaw != "CAL") ) 
-                        { formatCalcRaw = ((Math.round(currentCalcRaw)*0.0555).toFixed(1)); }
-                        //console.log("Format Unfiltered: " + formatRawUnfilt);
-                      }
-                    } // if currentRawUnfilt 
-                  
-                    //console.log("Calculated Raw To Be Sent: " + formatCalcRaw);
-                  
-                    // assign blank noise if it doesn't exist
-                    if ( (typeof currentNoise == "undefined") || (currentNoise === null) ) {
-                      currentNoise = 0;  
-                    }
-                    
-                    if (opts.radio == "mgdl_form") {
-                      values = "0";  //mgdl selected
-                    } else {
-                      values = "1"; //mmol selected
-                    }
-                    values += "," + opts.lowbg;  //Low BG Level
-                    values += "," + opts.highbg; //High BG Level                      
-                    values += "," + opts.lowsnooze;  //LowSnooze minutes 
-                    values += "," + opts.highsnooze; //HighSnooze minutes
-                    values += "," + opts.lowvibe;  //Low Vibration 
-                    values += "," + opts.highvibe; //High Vibration
-                    values += "," + opts.vibepattern; //Vibration Pattern
-                    if (opts.timeformat == "12"){
-                      values += ",0";  //Time Format 12 Hour  
-                    } else {
-                      values += ",1";  //Time Format 24 Hour  
-                    }
-                    // Vibrate on raw value in special value; Yes = 1; No = 0;
-                    if ( (currentCalcRaw !== 0) && (opts.rawvibrate == "1") ) {
-                      values += ",1";  // Vibrate on raw value when in special values  
-                    } else {
-                      values += ",0";  // Do not vibrate on raw value when in special values                        
-                    }
-                    
-                    //console.log("Current Value: " + values);
-                    //console.log("Current rawvibrate: " + opts.rawvibrate);
-                    //console.log("Current currentCalcRaw: " + currentCalcRaw);
-                  
-                    // debug logs; uncomment when need to debug something
- 
-                    //console.log("current Direction: " + currentDirection);
-                    //console.log("current Icon: " + currentIcon);
-                    //console.log("current BG: " + currentBG);
-                    //console.log("now: " + formatAppTime);
-                    //console.log("readingtime: " + formatReadTime);
-                    //console.log("current BG delta: " + currentBGDelta);
-                    //console.log("current Formatted Delta: " + formatBGDelta);              
-                    //console.log("current Battery: " + currentBattery);
-                    
-                    // load message data  
-                    message = {
-                      icon: currentIcon,
-                      bg: currentBG,
-                      tcgm: formatReadTime,
-                      tapp: formatAppTime,
-                      dlta: formatBGDelta,
-                      ubat: currentBattery,
-                      name: NameofT1DPerson,
-                      vals: values,
-                      clrw: formatCalcRaw,
-                      rwuf: formatRawUnfilt,
-                      noiz: currentNoise
-                    };
-                    
-                    // send message data to log and to watch
-                    console.log("JS send message: " + JSON.stringify(message));
-                    MessageQueue.sendAppMessage(message);
-
-                // response data is not good; format error message and send to watch
-                // have to send space in BG field for logo to show up on screen				
-                } else {
-                  
-                    // " " (space) shows these are init values (even though it's an error), not bad or null values
-                    message = {
-                      dlta: "OFF"
-                    };
-                  
-                    console.log("DATA OFFLINE JS message", JSON.stringify(message));
-                    MessageQueue.sendAppMessage(message);
-                }
-            } // end req.status == 200
-        } // end req.readyState == 4
-    }; // req.onload
-    req.send(null);
-    var myCGMTimeout = setTimeout (function () {
-      req.abort();
-      message = {
-        dlta: "OFF"
-      };          
-      console.log("DATA OFFLINE JS message", JSON.stringify(message));
-      MessageQueue.sendAppMessage(message);
-    }, 59000 ); // timeout in ms; set at 45 seconds; can not go beyond 59 seconds      
-} // end fetchCgmData
+        // if no battery being sent yet, then send none to watch
+        // out of range battery is sent as error
+        // console.log("Battery Value: " + currentBattery);
+        if ( (typeof currentBattery == "undefined") || (currentBattery === null) ) {
+          currentBattery = CGM_UBAT_NONE;  
+        }
+        else {
+          currentBattery = parseInt(currentBattery, 10);
+          if ( (isNaN(currentBattery)) || (currentBattery < 0) || (currentBattery > 100) ) { currentBattery = CGM_UBAT_ERR; }
+        }
+      
+        // assign bg delta; watch shows error if it's not a number
+        if ( (typeof currentBGDelta != "undefined") && (currentBGDelta !== null) && (!isNaN(Number(currentBGDelta))) ) {
+          formatBGDelta = toFixedBG(currentBGDelta, isMmol);
+        }
+
+        //console.log("Current Unfiltered: " + currentRawUnfilt);                  
+        //console.log("Current Intercept: " + currentIntercept);
+        //console.log("Special Value Flag: " + specialValue);
+        //console.log("Current BG: " + currentBG);
+      
+        // assign calculated raw value if we can
+        if ( (typeof currentIntercept != "undefined") && (currentIntercept !== null) ){
+            if (specialValue) {
+              // don't use ratio adjustment
+              currentCalcRaw = ((currentScale * (currentRawUnfilt - currentIntercept) / currentSlope)*1 - rawCalcOffset*1);
+              //console.log("Special Value Calculated Raw: " + currentCalcRaw);
+            } 
+            else {
+              currentRatio = (currentScale * (currentRawFilt - currentIntercept) / currentSlope / (currentConvBG*1 + rawCalcOffset*1));
+              currentCalcRaw = ((currentScale * (currentRawUnfilt - currentIntercept) / currentSlope / currentRatio)*1 - rawCalcOffset*1);
+              //console.log("Current Converted BG: " + currentConvBG);
+              //console.log("Current Ratio: " + currentRatio);
+              //console.log("Normal BG Calculated Raw: " + currentCalcRaw);
+            }          
+        } // if currentIntercept                  
+
+        // assign raw sensor values if they exist
+        if ( (typeof currentRawUnfilt != "undefined") && (currentRawUnfilt !== null) ) {
+          
+          // zero out any invalid values; defined anything not between 0 and 900
+          if ( (currentRawFilt < 0) || (currentRawFilt > 900000) || 
+                (isNaN(currentRawFilt)) ) { currentRawFilt = "ERR"; }
+          if ( (currentRawUnfilt < 0) || (currentRawUnfilt > 900000) || 
+                (isNaN(currentRawUnfilt)) ) { currentRawUnfilt = "ERR"; }
+          
+          // set 0, LO and HI in calculated raw
+          if ( (currentCalcRaw >= 0) && (currentCalcRaw < 30) ) { formatCalcRaw = CGM_RAW_LO; }
+          if ( (currentCalcRaw > 500) && (currentCalcRaw <= 900) ) { formatCalcRaw = CGM_RAW_HI; }
+          if ( (currentCalcRaw < 0 ) || (currentCalcRaw > 900) ) { formatCalcRaw = CGM_RAW_ERR; }
+          
+          // if slope is 0 or if currentCalcRaw is NaN, 
+          // calculated raw is invalid and need a calibration
+          if ( (currentSlope === 0) || (isNaN(currentCalcRaw)) ) { formatCalcRaw = CGM_RAW_CAL; }
+          
+          // check for compression warning
+          if ( ((currentCalcRaw < (currentRawFilt/1000)) && (!calibrationValue)) && (currentRawFilt !== 0) ){
+            var compressionSlope = 0;
+            compressionSlope = (((currentRawFilt/1000) - currentCalcRaw)/(currentRawFilt/1000));
+            //console.log("compression slope: " + compressionSlope);
+            if (compressionSlope > 0.7) {
+              // set COMPRESSION? message
+              messageFlags |= CGM_FLAG_PRSS;
+            } // if compressionSlope
+          } // if check for compression condition
+          
+          if (opts.radio == "mgdl_form") { 
+            formatRawFilt = ((Math.round(currentRawFilt / 1000)).toFixed(0));
+            formatRawUnfilt = toFixedBG(currentRawUnfilt / 1000, false);
+            if (formatCalcRaw == CGM_RAW_NONE) 
+                { formatCalcRaw = toFixedBG(currentCalcRaw, false); }
+            //console.log("Format Unfiltered: " + formatRawUnfilt);
+          } 
+          else {
+            formatRawFilt = ((Math.round(((currentRawFilt/1000)*0.0555) * 10) / 10).toFixed(1));
+            formatRawUnfilt = toFixedBG((currentRawUnfilt/1000)*0.0555, true);
+            if (formatCalcRaw == CGM_RAW_NONE) 
+            { formatCalcRaw = toFixedBG(Math.round(currentCalcRaw)*0.0555, true); }
+            //console.log("Format Unfiltered: " + formatRawUnfilt);
+          }
+          if (currentRawUnfilt == "ERR") { formatRawUnfilt = CGM_RAW_ERR; }
+        } // if currentRawUnfilt 
+      
+        //console.log("Calculated Raw To Be Sent: " + formatCalcRaw);
+      
+        // assign blank noise if it doesn't exist
+        if ( (typeof currentNoise == "undefined") || (currentNoise === null) ) {
+          currentNoise = 0;  
+        }
+        
+        if (isMmol) { messageFlags |= CGM_FLAG_MMOL; }
+        
+        //console.log("Current Flags: " + messageFlags);
+        //console.log("Current rawvibrate: " + opts.rawvibrate);
+        //console.log("Current currentCalcRaw: " + currentCalcRaw);
+      
+        // debug logs; uncomment when need to debug something
+
+        //console.log("current Direction: " + currentDirection);
+        //console.log("current Icon: " + currentIcon);
+        //console.log("current BG: " + currentBG);
+        //console.log("now: " + formatAppTime);
+        //console.log("readingtime: " + formatReadTime);
+        //console.log("current BG delta: " + currentBGDelta);
+        //console.log("current Formatted Delta: " + formatBGDelta);              
+        //console.log("current Battery: " + currentBattery);
+        
+        // load message data  
+        message = {
+          data: encodeReading({
+            flags: messageFlags,
+            arrow: currentIcon,
+            bg: toFixedBG(currentBG, isMmol),
+            delta: formatBGDelta,
+            tcgm: formatReadTime,
+            tapp: formatAppTime,
+            battery: currentBattery,
+            noise: Math.min(255, Math.max(0, parseInt(currentNoise, 10) || 0)),
+            calcRaw: formatCalcRaw,
+            rawUnfilt: formatRawUnfilt,
+            name: NameofT1DPerson
+          })
+        };
+        
+        // only send settings if watch doesn't have them
+        if (settingsNeeded) {
+          message.vals = encodeSettings(opts);
+          settingsNeeded = false;
+        }
+        fullReadingNeeded = false;
+        
+        // readings the watch missed go first, oldest first, so its history is filled before the newest one
+        var missedReadings = [], missedTime = 0;
+        for (var i = responsebgs.length - 1; i >= 1; i--) {
+          missedTime = Math.floor( (new Date(responsebgs[i].datetime).getTime() / 1000) - (timezoneOffset * 60) );
+          if ( (!isNaN(missedTime)) && (missedTime > watchLastTcgm) && (missedTime < formatReadTime) ) {
+            missedReadings.push({
+              time: missedTime,
+              bg: toFixedBG(responsebgs[i].sgv, isMmol),
+              arrow: directionToIcon(responsebgs[i].direction),
+              noise: Math.max(0, parseInt(responsebgs[i].noise, 10) || 0)
+            });
+          }
+        }
+        encodeHistory(missedReadings, isMmol ? CGM_FLAG_MMOL : 0).forEach(function (chunk) {
+          MessageQueue.sendAppMessage({ hist: chunk });
+        });
+        if (missedReadings.length > 0) {
+          console.log("JS send history, readings: " + missedReadings.length);
+        }
+        
+        // send message data to log and to watch
+        console.log("JS send message: " + JSON.stringify(message));
+        sendToWatch(message, fetchStart);
+
+    // response data is not good; format error message and send to watch
+    // have to send space in BG field for logo to show up on screen				
+    } else {
+      
+        // watch keeps the last reading and shows the data offline message
+        message = {
+          data: encodeStatus(CGM_STATUS_OFF)
+        };
+      
+        console.log("DATA OFFLINE JS message", JSON.stringify(message));
+        sendToWatch(message, fetchStart);
+    }
+} // end sendCgmData
 
 // message queue-ing to pace calls from C function on watch
+// queued messages are coalesced by key, latest wins; the watch only needs the current state
+// history chunks are never coalesced, they are in order and each one is different data
 var MessageQueue = (function () {
                     
                     var RETRY_MAX = 5;
+                    var ORDERED_KEY = 'hist';
                     
                     var queue = [];
                     var sending = false;
                     var timer = null;
+                    var counters = {
+                    queued: 0,
+                    merged: 0,
+                    superseded: 0,
+                    sent: 0,
+                    acked: 0,
+                    nacked: 0,
+                    timedOut: 0,
+                    failed: 0
+                    };
                     
                     return {
                     reset: reset,
                     sendAppMessage: sendAppMessage,
-                    size: size
+                    size: size,
+                    stats: stats
                     };
                     
                     function reset() {
@@ -350,18 +633,40 @@ var MessageQueue = (function () {
                     sending = false;
                     }
                     
-                    function sendAppMessage(message, ack, nack) {
+                    // superseded is called instead of ack when newer values replace a message before the watch gets it
+                    function sendAppMessage(message, ack, nack, superseded) {
                     
                     if (! isValidMessage(message)) {
                     return false;
                     }
                     
-                    queue.push({
+                    var entry = {
                                message: message,
                                ack: ack || null,
                                nack: nack || null,
+                               superseded: superseded || null,
                                attempts: 0
-                               });
+                               };
+                    
+                    counters.queued += 1;
+                    
+                    // older queued values for the same keys are stale now
+                    dropSuperseded(entry.message, queue.length);
+                    
+                    // merge into the last queued message if we can, so it all goes in one send
+                    var last = queue[queue.length - 1];
+                    if (last && canMerge(last.message, entry.message)) {
+                    Object.keys(entry.message).forEach(function (key) {
+                                                       last.message[key] = entry.message[key];
+                                                       });
+                    last.ack = chain(last.ack, entry.ack);
+                    last.nack = chain(last.nack, entry.nack);
+                    last.superseded = chain(last.superseded, entry.superseded);
+                    counters.merged += 1;
+                    }
+                    else {
+                    queue.push(entry);
+                    }
                     
                     setTimeout(function () {
                                sendNextMessage();
@@ -374,6 +679,43 @@ var MessageQueue = (function () {
                     return queue.length;
                     }
                     
+                    function stats() {
+                    var copy = { queue: queue.length };
+                    Object.keys(counters).forEach(function (key) { copy[key] = counters[key]; });
+                    return copy;
+                    }
+                    
+                    // remove keys of message from queue entries before index; drop entries left empty
+                    function dropSuperseded(message, index) {
+                    Object.keys(message).forEach(function (key) {
+                                                 if (key == ORDERED_KEY) { return; }
+                                                 for (var q = 0; q < index; q += 1) {
+                                                 delete queue[q].message[key];
+                                                 }
+                                                 });
+                    for (var q = index - 1; q >= 0; q -= 1) {
+                    if (! Object.keys(queue[q].message).length) {
+                    if (queue[q].superseded) { queue[q].superseded(); }
+                    queue.splice(q, 1);
+                    counters.superseded += 1;
+                    }
+                    }
+                    }
+                    
+                    // no merging with history chunks, the newest data has to go after them
+                    function canMerge(queued, message) {
+                    return (! (ORDERED_KEY in queued)) && (! (ORDERED_KEY in message));
+                    }
+                    
+                    function chain(first, second) {
+                    if (! first) { return second; }
+                    if (! second) { return first; }
+                    return function () {
+                    first.apply(null, arguments);
+                    second.apply(null, arguments);
+                    };
+                    }
+                    
                     function isValidMessage(message) {
                     // A message must be an object.
                     if (message !== Object(message)) {
@@ -420,6 +762,7 @@ var MessageQueue = (function () {
                     
                     message.attempts += 1;
                     sending = true;
+                    counters.sent += 1;
                     Pebble.sendAppMessage(message.message, ack, nack);
                     
                     timer = setTimeout(function () {
@@ -428,6 +771,7 @@ var MessageQueue = (function () {
                     
                     function ack() {
                     clearTimeout(timer);
+                    counters.acked += 1;
                     setTimeout(function () {
                                sending = false;
                                sendNextMessage();
@@ -439,7 +783,27 @@ var MessageQueue = (function () {
                     
                     function nack() {
                     clearTimeout(timer);
+                    counters.nacked += 1;
                     if (message.attempts < RETRY_MAX) {
+                    // anything queued since is newer; only retry what hasn't been replaced
+                    Object.keys(message.message).forEach(function (key) {
+                                                         if (key == ORDERED_KEY) { return; }
+                                                         for (var q = 0; q < queue.length; q += 1) {
+                                                         if (key in queue[q].message) {
+                                                         delete message.message[key];
+                                                         return;
+                                                         }
+                                                         }
+                                                         });
+                    if (! Object.keys(message.message).length) {
+                    counters.superseded += 1;
+                    if (message.superseded) { message.superseded(); }
+                    setTimeout(function () {
+                               sending = false;
+                               sendNextMessage();
+                               }, 200);
+                    return;
+                    }
                     queue.unshift(message);
                     setTimeout(function () {
                                sending = false;
@@ -447,6 +811,12 @@ var MessageQueue = (function () {
                                }, 200 * message.attempts);
                     }
                     else {
+                    // give up on this one, but keep the queue going
+                    counters.failed += 1;
+                    setTimeout(function () {
+                               sending = false;
+                               sendNextMessage();
+                               }, 200);
                     if (message.nack) {
                     message.nack.apply(null, arguments);
                     }
@@ -454,6 +824,7 @@ var MessageQueue = (function () {
                     }
                     
                     function timeout() {
+                    counters.timedOut += 1;
                     setTimeout(function () {
                                sending = false;
                                sendNextMessage();
@@ -477,6 +848,12 @@ Pebble.addEventListener("ready",
 Pebble.addEventListener("appmessage",
                         function(e) {
                         console.log("JS Recvd Msg From Watch: " + JSON.stringify(e.payload));
+                        // watch has old or no settings, send them with this reading
+                        if ( (typeof e.payload.cfgv != "undefined") && (e.payload.cfgv != getCfgVersion()) ) {
+                          settingsNeeded = true;
+                        }
+                        // newest reading the watch has; it only gets what it missed
+                        watchLastTcgm = (typeof e.payload.last != "undefined") ? (e.payload.last >>> 0) : 0;
                         fetchCgmData();
                         });
 
@@ -490,4 +867,25 @@ Pebble.addEventListener("webviewclosed", function(e) {
                         console.log("CLOSE CONFIG OPTIONS = " + JSON.stringify(opts));
                         // store endpoint in local storage
                         window.localStorage.setItem('cgmPebble', JSON.stringify(opts));                      
+                        // new config version, send settings now so watch doesn't wait for next reading
+                        bumpCfgVersion();
+                        MessageQueue.sendAppMessage({ vals: encodeSettings(opts) });
+                        settingsNeeded = false;
+                        // name or units may have changed; send a whole reading next time
+                        fullReadingNeeded = true;
                         });
+
+// lets the phone code be loaded and measured outside the phone app, with Pebble, XMLHttpRequest
+// and window.localStorage stubbed; the phone app has no module object
+if ( (typeof module !== "undefined") && (module.exports) ) {
+    module.exports = {
+      fetchCgmData: fetchCgmData,
+      getCgmResponse: getCgmResponse,
+      sendCgmData: sendCgmData,
+      encodeReading: encodeReading,
+      encodeSettings: encodeSettings,
+      encodeHistory: encodeHistory,
+      MessageQueue: MessageQueue,
+      cgmFetch: cgmFetch
+    };
+}
@@ -0,0 +1,1117 @@
+// HOST IMPLEMENTATION OF THE PEBBLE SHIM
+// Enough of the SDK for src/cgm.c to run on Linux: real layer tree, dictionaries and persist
+// storage, no pixels. Every allocation, layer update and graphics call is counted in stub_stats.
+
+#include <stdarg.h>
+#include "stub_stats.h"
+
+// app heap on the original Pebble; heap_bytes_free is measured against it
+#define STUB_APP_HEAP_BYTES 24576
+
+#define STUB_PERSIST_KEYS 16
+#define STUB_PERSIST_MAX_SIZE 256
+#define STUB_ANIMATION_RUNS_MAX 64
+
+// VARIABLES
+
+StubStats stub_stats;
+bool stub_log_enabled = false;
+
+typedef enum {
+  LAYER_KIND_PLAIN = 0,
+  LAYER_KIND_TEXT = 1,
+  LAYER_KIND_BITMAP = 2,
+  LAYER_KIND_INVERTER = 3
+} LayerKind;
+
+// first member of every layer type, so a Layer pointer is also a pointer to its owner
+struct Layer {
+  LayerKind kind;
+  GRect frame;
+  bool hidden;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GColor text_color;
+  GColor background_color;
+  GTextAlignment alignment;
+};
+
+struct BitmapLayer {
+  Layer layer;
+  const GBitmap *bitmap;
+  GAlign alignment;
+  GColor background_color;
+  GCompOp compositing_mode;
+};
+
+struct InverterLayer {
+  Layer layer;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  bool loaded;
+};
+
+struct GContext {
+  GColor stroke_color;
+  GColor fill_color;
+  GColor text_color;
+  GCompOp compositing_mode;
+};
+
+struct Animation {
+  AnimationHandlers handlers;
+  void *context;
+  uint32_t duration_ms;
+  AnimationCurve curve;
+  bool scheduled;
+  Animation *next_scheduled;
+};
+
+// the animation is the first member, the SDK casts one to the other
+struct PropertyAnimation {
+  Animation animation;
+  Layer *layer;
+  GRect from_frame;
+  GRect to_frame;
+};
+
+struct AppTimer {
+  uint32_t timeout_ms;
+  AppTimerCallback callback;
+  void *callback_data;
+};
+
+struct __attribute__((__packed__)) Dictionary {
+  uint8_t count;
+  Tuple head[];
+};
+
+typedef struct {
+  uint32_t key;
+  uint16_t length;
+  uint8_t data[STUB_PERSIST_MAX_SIZE];
+} StubPersistEntry;
+
+// keeps the size in front of every allocation, aligned for anything that follows it
+typedef union {
+  size_t size;
+  long long align_int;
+  long double align_float;
+  void *align_pointer;
+} StubAllocHeader;
+
+static time_t stub_time_now = 0;
+static bool stub_bluetooth_connected = true;
+static bool stub_needs_render = false;
+static Window *stub_pushed_window = NULL;
+static Animation *stub_scheduled_animations = NULL;
+static struct GContext stub_context;
+
+static StubPersistEntry stub_persist[STUB_PERSIST_KEYS];
+static uint8_t stub_persist_count = 0;
+
+static AppMessageInboxReceived stub_inbox_received = NULL;
+static uint8_t stub_outbox_buffer[256];
+static DictionaryIterator stub_outbox_iter;
+
+// CODE START
+
+// ALLOCATIONS
+
+static void *stub_alloc(const size_t size) {
+
+  StubAllocHeader *header = calloc(1, sizeof(StubAllocHeader) + size);
+
+  if (header == NULL) {
+    return NULL;
+  }
+  header->size = size;
+  stub_stats.allocs++;
+  stub_stats.alloc_bytes += size;
+  stub_stats.live_bytes += size;
+  if (stub_stats.live_bytes > stub_stats.peak_live_bytes) {
+    stub_stats.peak_live_bytes = stub_stats.live_bytes;
+  }
+  return header + 1;
+
+} // end stub_alloc
+
+static void stub_free(void *ptr) {
+
+  StubAllocHeader *header = NULL;
+
+  if (ptr == NULL) {
+    return;
+  }
+  header = ((StubAllocHeader *)ptr) - 1;
+  stub_stats.frees++;
+  stub_stats.live_bytes -= header->size;
+  free(header);
+
+} // end stub_free
+
+void stub_reset_stats(void) {
+
+  uint32_t live_bytes = stub_stats.live_bytes;
+  uint32_t peak_live_bytes = stub_stats.peak_live_bytes;
+
+  memset(&stub_stats, 0, sizeof(stub_stats));
+  stub_stats.live_bytes = live_bytes;
+  stub_stats.peak_live_bytes = peak_live_bytes;
+
+} // end stub_reset_stats
+
+size_t heap_bytes_used(void) {
+  return stub_stats.live_bytes;
+} // end heap_bytes_used
+
+size_t heap_bytes_free(void) {
+  return (stub_stats.live_bytes < STUB_APP_HEAP_BYTES) ? (STUB_APP_HEAP_BYTES - stub_stats.live_bytes) : 0;
+} // end heap_bytes_free
+
+// GRAPHICS
+
+GFont fonts_get_system_font(const char *font_key) {
+  // fonts are built into the firmware; the key itself is a good enough handle
+  return (GFont)font_key;
+} // end fonts_get_system_font
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+
+  GBitmap *bitmap = stub_alloc(sizeof(GBitmap));
+  GSize size = GSize(24, 28);
+
+  if (resource_id == RESOURCE_ID_IMAGE_ICON_ATLAS) {
+    // see the size in src/icon_atlas.h
+    size = GSize(160, 197);
+  }
+
+  // decoded 1 bit image, rows padded to 32 bits, like the firmware does
+  bitmap->row_size_bytes = ((size.w + 31) / 32) * 4;
+  bitmap->addr = stub_alloc(bitmap->row_size_bytes * size.h);
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  return bitmap;
+
+} // end gbitmap_create_with_resource
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+
+  // shares the pixels of the base bitmap
+  GBitmap *bitmap = stub_alloc(sizeof(GBitmap));
+
+  bitmap->addr = NULL;
+  bitmap->row_size_bytes = base_bitmap->row_size_bytes;
+  bitmap->info_flags = 1;
+  bitmap->bounds = sub_rect;
+  return bitmap;
+
+} // end gbitmap_create_as_sub_bitmap
+
+void gbitmap_destroy(GBitmap *bitmap) {
+
+  if (bitmap == NULL) {
+    return;
+  }
+  if (bitmap->info_flags == 0) {
+    stub_free(bitmap->addr);
+  }
+  stub_free(bitmap);
+
+} // end gbitmap_destroy
+
+void grect_align(GRect *rect, const GRect *inside_rect, const GAlign alignment, const bool clip) {
+
+  int16_t left = inside_rect->origin.x;
+  int16_t right = inside_rect->origin.x + inside_rect->size.w - rect->size.w;
+  int16_t top = inside_rect->origin.y;
+  int16_t bottom = inside_rect->origin.y + inside_rect->size.h - rect->size.h;
+
+  rect->origin.x = (left + right) / 2;
+  rect->origin.y = (top + bottom) / 2;
+  if ((alignment == GAlignTopLeft) || (alignment == GAlignLeft) || (alignment == GAlignBottomLeft)) {
+    rect->origin.x = left;
+  }
+  if ((alignment == GAlignTopRight) || (alignment == GAlignRight) || (alignment == GAlignBottomRight)) {
+    rect->origin.x = right;
+  }
+  if ((alignment == GAlignTopLeft) || (alignment == GAlignTop) || (alignment == GAlignTopRight)) {
+    rect->origin.y = top;
+  }
+  if ((alignment == GAlignBottomLeft) || (alignment == GAlignBottom) || (alignment == GAlignBottomRight)) {
+    rect->origin.y = bottom;
+  }
+
+} // end grect_align
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+} // end graphics_context_set_stroke_color
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+} // end graphics_context_set_fill_color
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_color = color;
+} // end graphics_context_set_text_color
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  ctx->compositing_mode = mode;
+} // end graphics_context_set_compositing_mode
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  stub_stats.draw_pixel++;
+} // end graphics_draw_pixel
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  stub_stats.draw_line++;
+} // end graphics_draw_line
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, int corner_mask) {
+  stub_stats.fill_rect++;
+} // end graphics_fill_rect
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  stub_stats.draw_bitmap++;
+} // end graphics_draw_bitmap_in_rect
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        const void *layout) {
+  stub_stats.draw_text++;
+} // end graphics_draw_text
+
+// LAYERS
+
+static void stub_mark_changed(void) {
+  stub_stats.dirty_marks++;
+  stub_needs_render = true;
+} // end stub_mark_changed
+
+static void init_layer(Layer *layer, const LayerKind kind, const GRect frame) {
+  layer->kind = kind;
+  layer->frame = frame;
+} // end init_layer
+
+Layer *layer_create(GRect frame) {
+
+  Layer *layer = stub_alloc(sizeof(Layer));
+
+  init_layer(layer, LAYER_KIND_PLAIN, frame);
+  return layer;
+
+} // end layer_create
+
+void layer_remove_from_parent(Layer *child) {
+
+  Layer **link = NULL;
+
+  if ((child == NULL) || (child->parent == NULL)) {
+    return;
+  }
+  for (link = &child->parent->first_child; *link != NULL; link = &(*link)->next_sibling) {
+    if (*link == child) {
+      *link = child->next_sibling;
+      break;
+    }
+  }
+  child->parent = NULL;
+  child->next_sibling = NULL;
+  stub_mark_changed();
+
+} // end layer_remove_from_parent
+
+// a destroyed layer leaves its children without a parent, like the firmware does
+static void release_layer(Layer *layer) {
+
+  Layer *child = layer->first_child;
+  Layer *next_child = NULL;
+
+  layer_remove_from_parent(layer);
+  while (child != NULL) {
+    next_child = child->next_sibling;
+    child->parent = NULL;
+    child->next_sibling = NULL;
+    child = next_child;
+  }
+  layer->first_child = NULL;
+
+} // end release_layer
+
+void layer_destroy(Layer *layer) {
+
+  if (layer == NULL) {
+    return;
+  }
+  release_layer(layer);
+  stub_free(layer);
+
+} // end layer_destroy
+
+void layer_mark_dirty(Layer *layer) {
+  stub_mark_changed();
+} // end layer_mark_dirty
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+} // end layer_set_update_proc
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  layer->frame = frame;
+  stub_mark_changed();
+} // end layer_set_frame
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+} // end layer_get_frame
+
+GRect layer_get_bounds(const Layer *layer) {
+  return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+} // end layer_get_bounds
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+
+  stub_stats.hidden_sets++;
+  if (layer->hidden != hidden) {
+    layer->hidden = hidden;
+    stub_mark_changed();
+  }
+
+} // end layer_set_hidden
+
+bool layer_get_hidden(const Layer *layer) {
+  return layer->hidden;
+} // end layer_get_hidden
+
+void layer_add_child(Layer *parent, Layer *child) {
+
+  Layer **link = NULL;
+
+  layer_remove_from_parent(child);
+  for (link = &parent->first_child; *link != NULL; link = &(*link)->next_sibling) {
+  }
+  *link = child;
+  child->parent = parent;
+  stub_mark_changed();
+
+} // end layer_add_child
+
+void layer_insert_below_sibling(Layer *layer_to_insert, Layer *below_sibling_layer) {
+
+  Layer **link = NULL;
+
+  if (below_sibling_layer->parent == NULL) {
+    return;
+  }
+  layer_remove_from_parent(layer_to_insert);
+  for (link = &below_sibling_layer->parent->first_child; *link != below_sibling_layer; link = &(*link)->next_sibling) {
+  }
+  layer_to_insert->next_sibling = below_sibling_layer;
+  layer_to_insert->parent = below_sibling_layer->parent;
+  *link = layer_to_insert;
+  stub_mark_changed();
+
+} // end layer_insert_below_sibling
+
+void layer_insert_above_sibling(Layer *layer_to_insert, Layer *above_sibling_layer) {
+
+  if (above_sibling_layer->parent == NULL) {
+    return;
+  }
+  layer_remove_from_parent(layer_to_insert);
+  layer_to_insert->next_sibling = above_sibling_layer->next_sibling;
+  layer_to_insert->parent = above_sibling_layer->parent;
+  above_sibling_layer->next_sibling = layer_to_insert;
+  stub_mark_changed();
+
+} // end layer_insert_above_sibling
+
+TextLayer *text_layer_create(GRect frame) {
+
+  TextLayer *text_layer = stub_alloc(sizeof(TextLayer));
+
+  init_layer(&text_layer->layer, LAYER_KIND_TEXT, frame);
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  return text_layer;
+
+} // end text_layer_create
+
+void text_layer_destroy(TextLayer *text_layer) {
+
+  if (text_layer == NULL) {
+    return;
+  }
+  release_layer(&text_layer->layer);
+  stub_free(text_layer);
+
+} // end text_layer_destroy
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return &text_layer->layer;
+} // end text_layer_get_layer
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  stub_stats.text_sets++;
+  text_layer->text = text;
+  stub_mark_changed();
+} // end text_layer_set_text
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+  return text_layer->text;
+} // end text_layer_get_text
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  text_layer->background_color = color;
+  stub_mark_changed();
+} // end text_layer_set_background_color
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+  text_layer->text_color = color;
+  stub_mark_changed();
+} // end text_layer_set_text_color
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  text_layer->font = font;
+  stub_mark_changed();
+} // end text_layer_set_font
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+  text_layer->alignment = text_alignment;
+  stub_mark_changed();
+} // end text_layer_set_text_alignment
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+
+  BitmapLayer *bitmap_layer = stub_alloc(sizeof(BitmapLayer));
+
+  init_layer(&bitmap_layer->layer, LAYER_KIND_BITMAP, frame);
+  bitmap_layer->background_color = GColorClear;
+  return bitmap_layer;
+
+} // end bitmap_layer_create
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+
+  if (bitmap_layer == NULL) {
+    return;
+  }
+  release_layer(&bitmap_layer->layer);
+  stub_free(bitmap_layer);
+
+} // end bitmap_layer_destroy
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) {
+  return (Layer *)&bitmap_layer->layer;
+} // end bitmap_layer_get_layer
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) {
+  stub_stats.bitmap_sets++;
+  bitmap_layer->bitmap = bitmap;
+  stub_mark_changed();
+} // end bitmap_layer_set_bitmap
+
+void bitmap_layer_set_alignment(BitmapLayer *bitmap_layer, GAlign alignment) {
+  bitmap_layer->alignment = alignment;
+  stub_mark_changed();
+} // end bitmap_layer_set_alignment
+
+void bitmap_layer_set_background_color(BitmapLayer *bitmap_layer, GColor color) {
+  bitmap_layer->background_color = color;
+  stub_mark_changed();
+} // end bitmap_layer_set_background_color
+
+void bitmap_layer_set_compositing_mode(BitmapLayer *bitmap_layer, GCompOp mode) {
+  bitmap_layer->compositing_mode = mode;
+  stub_mark_changed();
+} // end bitmap_layer_set_compositing_mode
+
+InverterLayer *inverter_layer_create(GRect frame) {
+
+  InverterLayer *inverter_layer = stub_alloc(sizeof(InverterLayer));
+
+  init_layer(&inverter_layer->layer, LAYER_KIND_INVERTER, frame);
+  return inverter_layer;
+
+} // end inverter_layer_create
+
+void inverter_layer_destroy(InverterLayer *inverter_layer) {
+
+  if (inverter_layer == NULL) {
+    return;
+  }
+  release_layer(&inverter_layer->layer);
+  stub_free(inverter_layer);
+
+} // end inverter_layer_destroy
+
+Layer *inverter_layer_get_layer(InverterLayer *inverter_layer) {
+  return &inverter_layer->layer;
+} // end inverter_layer_get_layer
+
+// WINDOWS
+
+Window *window_create(void) {
+
+  Window *window = stub_alloc(sizeof(Window));
+
+  init_layer(&window->root, LAYER_KIND_PLAIN, GRect(0, 0, 144, 168));
+  return window;
+
+} // end window_create
+
+void window_destroy(Window *window) {
+
+  if (window == NULL) {
+    return;
+  }
+  if (window->loaded && (window->handlers.unload != NULL)) {
+    window->handlers.unload(window);
+  }
+  if (stub_pushed_window == window) {
+    stub_pushed_window = NULL;
+  }
+  release_layer(&window->root);
+  stub_free(window);
+
+} // end window_destroy
+
+Layer *window_get_root_layer(const Window *window) {
+  return (Layer *)&window->root;
+} // end window_get_root_layer
+
+void window_set_background_color(Window *window, GColor background_color) {
+} // end window_set_background_color
+
+void window_set_fullscreen(Window *window, bool enabled) {
+} // end window_set_fullscreen
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+} // end window_set_window_handlers
+
+void window_stack_push(Window *window, bool animated) {
+
+  stub_pushed_window = window;
+  if (!window->loaded) {
+    window->loaded = true;
+    if (window->handlers.load != NULL) {
+      window->handlers.load(window);
+    }
+  }
+  if (window->handlers.appear != NULL) {
+    window->handlers.appear(window);
+  }
+  stub_mark_changed();
+
+} // end window_stack_push
+
+static void render_layer(Layer *layer) {
+
+  const TextLayer *text_layer = (const TextLayer *)layer;
+  const BitmapLayer *bitmap_layer = (const BitmapLayer *)layer;
+
+  if (layer->hidden) {
+    return;
+  }
+
+  switch (layer->kind) {
+    case LAYER_KIND_TEXT:
+      if (text_layer->background_color != GColorClear) {
+        graphics_fill_rect(&stub_context, layer->frame, 0, GCornerNone);
+      }
+      if ((text_layer->text != NULL) && (text_layer->text[0] != '\0')) {
+        graphics_draw_text(&stub_context, text_layer->text, text_layer->font, layer->frame,
+                           GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+      }
+      break;
+    case LAYER_KIND_BITMAP:
+      if (bitmap_layer->background_color != GColorClear) {
+        graphics_fill_rect(&stub_context, layer->frame, 0, GCornerNone);
+      }
+      if (bitmap_layer->bitmap != NULL) {
+        graphics_draw_bitmap_in_rect(&stub_context, bitmap_layer->bitmap, layer->frame);
+      }
+      break;
+    case LAYER_KIND_INVERTER:
+      graphics_fill_rect(&stub_context, layer->frame, 0, GCornerNone);
+      break;
+    default:
+      if (layer->update_proc != NULL) {
+        layer->update_proc(layer, &stub_context);
+      }
+      break;
+  }
+
+  for (Layer *child = layer->first_child; child != NULL; child = child->next_sibling) {
+    render_layer(child);
+  }
+
+} // end render_layer
+
+void stub_render(void) {
+
+  if ((!stub_needs_render) || (stub_pushed_window == NULL)) {
+    return;
+  }
+  stub_needs_render = false;
+  stub_stats.renders++;
+  render_layer(&stub_pushed_window->root);
+
+} // end stub_render
+
+// ANIMATIONS
+
+PropertyAnimation *property_animation_create_layer_frame(Layer *layer, GRect *from_frame, GRect *to_frame) {
+
+  PropertyAnimation *property_animation = stub_alloc(sizeof(PropertyAnimation));
+
+  property_animation->layer = layer;
+  property_animation->from_frame = (from_frame != NULL) ? *from_frame : layer->frame;
+  property_animation->to_frame = (to_frame != NULL) ? *to_frame : layer->frame;
+  property_animation->animation.duration_ms = 250;
+  return property_animation;
+
+} // end property_animation_create_layer_frame
+
+static void remove_scheduled_animation(Animation *animation) {
+
+  Animation **link = NULL;
+
+  for (link = &stub_scheduled_animations; *link != NULL; link = &(*link)->next_scheduled) {
+    if (*link == animation) {
+      *link = animation->next_scheduled;
+      break;
+    }
+  }
+  animation->next_scheduled = NULL;
+  animation->scheduled = false;
+
+} // end remove_scheduled_animation
+
+void property_animation_destroy(PropertyAnimation *property_animation) {
+
+  if (property_animation == NULL) {
+    return;
+  }
+  remove_scheduled_animation(&property_animation->animation);
+  stub_free(property_animation);
+
+} // end property_animation_destroy
+
+void animation_set_duration(Animation *animation, uint32_t duration_ms) {
+  animation->duration_ms = duration_ms;
+} // end animation_set_duration
+
+void animation_set_curve(Animation *animation, AnimationCurve curve) {
+  animation->curve = curve;
+} // end animation_set_curve
+
+void animation_set_handlers(Animation *animation, AnimationHandlers callbacks, void *context) {
+  animation->handlers = callbacks;
+  animation->context = context;
+} // end animation_set_handlers
+
+void animation_schedule(Animation *animation) {
+
+  Animation **link = NULL;
+
+  if (animation->scheduled) {
+    return;
+  }
+  stub_stats.animations++;
+  animation->scheduled = true;
+  for (link = &stub_scheduled_animations; *link != NULL; link = &(*link)->next_scheduled) {
+  }
+  *link = animation;
+
+} // end animation_schedule
+
+void animation_unschedule(Animation *animation) {
+
+  if (!animation->scheduled) {
+    return;
+  }
+  remove_scheduled_animation(animation);
+  if (animation->handlers.stopped != NULL) {
+    animation->handlers.stopped(animation, false, animation->context);
+  }
+
+} // end animation_unschedule
+
+bool animation_is_scheduled(Animation *animation) {
+  return animation->scheduled;
+} // end animation_is_scheduled
+
+void stub_run_animations(void) {
+
+  Animation *animation = NULL;
+  PropertyAnimation *property_animation = NULL;
+
+  // a stopped handler can schedule the next one; don't spin forever if it always does
+  for (uint8_t run = 0; (run < STUB_ANIMATION_RUNS_MAX) && (stub_scheduled_animations != NULL); run++) {
+    animation = stub_scheduled_animations;
+    property_animation = (PropertyAnimation *)animation;
+    remove_scheduled_animation(animation);
+    if (animation->handlers.started != NULL) {
+      animation->handlers.started(animation, animation->context);
+    }
+    layer_set_frame(property_animation->layer, property_animation->to_frame);
+    // the stopped handler usually destroys the animation; don't touch it after this
+    if (animation->handlers.stopped != NULL) {
+      animation->handlers.stopped(animation, true, animation->context);
+    }
+  }
+
+} // end stub_run_animations
+
+// DICTIONARIES
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+
+  va_list sizes;
+  uint32_t total_size = sizeof(Dictionary) + (tuple_count * sizeof(Tuple));
+
+  va_start(sizes, tuple_count);
+  for (uint8_t tuple_index = 0; tuple_index < tuple_count; tuple_index++) {
+    total_size += va_arg(sizes, unsigned int);
+  }
+  va_end(sizes);
+  return total_size;
+
+} // end dict_calc_buffer_size
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t * const buffer, const uint16_t size) {
+
+  if ((iter == NULL) || (buffer == NULL) || (size < sizeof(Dictionary))) {
+    return DICT_INVALID_ARGS;
+  }
+  iter->dictionary = (Dictionary *)buffer;
+  iter->dictionary->count = 0;
+  iter->cursor = iter->dictionary->head;
+  iter->end = buffer + size;
+  return DICT_OK;
+
+} // end dict_write_begin
+
+static DictionaryResult dict_write_tuple(DictionaryIterator *iter, const uint32_t key, const TupleType type,
+                                         const void *data, const uint16_t size) {
+
+  if ((const uint8_t *)iter->cursor + sizeof(Tuple) + size > (const uint8_t *)iter->end) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  iter->cursor->key = key;
+  iter->cursor->type = type;
+  iter->cursor->length = size;
+  memcpy(iter->cursor->value->data, data, size);
+  iter->cursor = (Tuple *)((uint8_t *)iter->cursor + sizeof(Tuple) + size);
+  iter->dictionary->count++;
+  return DICT_OK;
+
+} // end dict_write_tuple
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size) {
+  return dict_write_tuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+} // end dict_write_data
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) {
+  return dict_write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+} // end dict_write_uint8
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value) {
+  return dict_write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+} // end dict_write_uint16
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value) {
+  return dict_write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+} // end dict_write_uint32
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+
+  iter->end = iter->cursor;
+  return (uint32_t)((const uint8_t *)iter->end - (const uint8_t *)iter->dictionary);
+
+} // end dict_write_end
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t * const buffer, const uint16_t size) {
+
+  iter->dictionary = (Dictionary *)buffer;
+  iter->end = buffer + size;
+  return dict_read_first(iter);
+
+} // end dict_read_begin_from_buffer
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+
+  iter->cursor = iter->dictionary->head;
+  if ((iter->dictionary->count == 0) || ((const void *)iter->cursor >= iter->end)) {
+    return NULL;
+  }
+  return iter->cursor;
+
+} // end dict_read_first
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+
+  if ((const void *)iter->cursor >= iter->end) {
+    return NULL;
+  }
+  iter->cursor = (Tuple *)((uint8_t *)iter->cursor + sizeof(Tuple) + iter->cursor->length);
+  if ((const void *)iter->cursor >= iter->end) {
+    return NULL;
+  }
+  return iter->cursor;
+
+} // end dict_read_next
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+
+  DictionaryIterator find_iter = *iter;
+
+  for (Tuple *tuple = dict_read_first(&find_iter); tuple != NULL; tuple = dict_read_next(&find_iter)) {
+    if (tuple->key == key) {
+      return tuple;
+    }
+  }
+  return NULL;
+
+} // end dict_find
+
+// APP MESSAGES
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  return APP_MSG_OK;
+} // end app_message_open
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+
+  AppMessageInboxReceived previous_callback = stub_inbox_received;
+
+  stub_inbox_received = received_callback;
+  return previous_callback;
+
+} // end app_message_register_inbox_received
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+  return NULL;
+} // end app_message_register_inbox_dropped
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+  return NULL;
+} // end app_message_register_outbox_failed
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+
+  dict_write_begin(&stub_outbox_iter, stub_outbox_buffer, sizeof(stub_outbox_buffer));
+  *iterator = &stub_outbox_iter;
+  return APP_MSG_OK;
+
+} // end app_message_outbox_begin
+
+AppMessageResult app_message_outbox_send(void) {
+  stub_stats.outbox_sends++;
+  return APP_MSG_OK;
+} // end app_message_outbox_send
+
+AppMessageInboxReceived stub_inbox_received_handler(void) {
+  return stub_inbox_received;
+} // end stub_inbox_received_handler
+
+// TIMERS AND SERVICES
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+
+  AppTimer *timer = stub_alloc(sizeof(AppTimer));
+
+  stub_stats.timer_registers++;
+  timer->timeout_ms = timeout_ms;
+  timer->callback = callback;
+  timer->callback_data = callback_data;
+  return timer;
+
+} // end app_timer_register
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+
+  if (timer_handle == NULL) {
+    return false;
+  }
+  stub_stats.timer_reschedules++;
+  timer_handle->timeout_ms = new_timeout_ms;
+  return true;
+
+} // end app_timer_reschedule
+
+void app_timer_cancel(AppTimer *timer_handle) {
+
+  if (timer_handle == NULL) {
+    return;
+  }
+  stub_stats.timer_cancels++;
+  stub_free(timer_handle);
+
+} // end app_timer_cancel
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+} // end tick_timer_service_subscribe
+
+void tick_timer_service_unsubscribe(void) {
+} // end tick_timer_service_unsubscribe
+
+BatteryChargeState battery_state_service_peek(void) {
+  return (BatteryChargeState){ .charge_percent = 80, .is_charging = false, .is_plugged = false };
+} // end battery_state_service_peek
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+} // end battery_state_service_subscribe
+
+void battery_state_service_unsubscribe(void) {
+} // end battery_state_service_unsubscribe
+
+void stub_set_bluetooth(bool connected) {
+  stub_bluetooth_connected = connected;
+} // end stub_set_bluetooth
+
+bool bluetooth_connection_service_peek(void) {
+  return stub_bluetooth_connected;
+} // end bluetooth_connection_service_peek
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler) {
+} // end bluetooth_connection_service_subscribe
+
+void bluetooth_connection_service_unsubscribe(void) {
+} // end bluetooth_connection_service_unsubscribe
+
+void vibes_enqueue_custom_pattern(VibePattern pattern) {
+  stub_stats.vibes++;
+} // end vibes_enqueue_custom_pattern
+
+// PERSIST
+
+static StubPersistEntry *find_persist_entry(const uint32_t key) {
+
+  for (uint8_t entry_index = 0; entry_index < stub_persist_count; entry_index++) {
+    if (stub_persist[entry_index].key == key) {
+      return &stub_persist[entry_index];
+    }
+  }
+  return NULL;
+
+} // end find_persist_entry
+
+void stub_persist_clear(void) {
+  stub_persist_count = 0;
+} // end stub_persist_clear
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+
+  const StubPersistEntry *entry = find_persist_entry(key);
+  size_t read_size = 0;
+
+  stub_stats.persist_reads++;
+  if (entry == NULL) {
+    return E_DOES_NOT_EXIST;
+  }
+  read_size = (entry->length < buffer_size) ? entry->length : buffer_size;
+  memcpy(buffer, entry->data, read_size);
+  return (int)read_size;
+
+} // end persist_read_data
+
+int32_t persist_read_int(const uint32_t key) {
+
+  int32_t value = 0;
+
+  if (persist_read_data(key, &value, sizeof(value)) != sizeof(value)) {
+    return 0;
+  }
+  return value;
+
+} // end persist_read_int
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+
+  StubPersistEntry *entry = find_persist_entry(key);
+
+  stub_stats.persist_writes++;
+  if (entry == NULL) {
+    if (stub_persist_count >= STUB_PERSIST_KEYS) {
+      return E_DOES_NOT_EXIST;
+    }
+    entry = &stub_persist[stub_persist_count++];
+    entry->key = key;
+  }
+  entry->length = (size < STUB_PERSIST_MAX_SIZE) ? size : STUB_PERSIST_MAX_SIZE;
+  memcpy(entry->data, data, entry->length);
+  return entry->length;
+
+} // end persist_write_data
+
+StatusCode persist_write_int(const uint32_t key, const int32_t value) {
+  persist_write_data(key, &value, sizeof(value));
+  return S_SUCCESS;
+} // end persist_write_int
+
+// TIME AND SYSTEM
+
+void stub_set_time(time_t now) {
+  stub_time_now = now;
+} // end stub_set_time
+
+time_t stub_get_time(void) {
+  return stub_time_now;
+} // end stub_get_time
+
+time_t time(time_t *tloc) {
+
+  if (tloc != NULL) {
+    *tloc = stub_time_now;
+  }
+  return stub_time_now;
+
+} // end time
+
+// the app only uses this to time itself, so it is the real clock, not the watch clock
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (tloc != NULL) {
+    *tloc = now.tv_sec;
+  }
+  if (out_ms != NULL) {
+    *out_ms = now.tv_nsec / 1000000;
+  }
+  return now.tv_nsec / 1000000;
+
+} // end time_ms
+
+void app_event_loop(void) {
+} // end app_event_loop
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+
+  va_list args;
+
+  if (!stub_log_enabled) {
+    return;
+  }
+  fprintf(stderr, "[%u] %s:%i ", log_level, src_filename, src_line_number);
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+
+} // end app_log
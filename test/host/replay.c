@@ -0,0 +1,275 @@
+// REPLAY OF RECORDED PHONE MESSAGES THROUGH THE WATCH FACE
+// Builds src/cgm.c against the host shim, feeds every recorded message to the inbox handler
+// the way the watch gets it, then draws the window. One line per message with the CPU time of
+// the handler and the draw, heap allocations and frees, layer updates, draw calls, vibes and the
+// stack the handler and the draw used.
+//
+// usage: replay [-q] [-v] stream.log ...
+//   -q  summary only
+//   -v  app log lines to stderr
+//
+// Streams are phone log lines ("JS send message: {...}"), optionally with the send time in unix
+// seconds in front, as test/js/record_stream.js writes them. Without a time, the watch clock is
+// moved to the reading time of the message, or a minute on.
+
+#include "stub_stats.h"
+#include "cgm.c"
+
+// the app's main is built as cgm_main and cgm.c comes from CGM_DIR, see the Makefile
+#undef main
+
+// CONSTANTS
+
+#define REPLAY_LINE_MAX 4096
+#define REPLAY_BYTES_MAX 256
+#define REPLAY_DICT_MAX 512
+
+// stack high water mark: this much below the caller is painted before each message and scanned after;
+// the top STACK_PROBE_SKIP bytes are left alone, the paint and scan functions run there, so that is
+// also the least it reports
+#define STACK_PROBE_BYTES 32768
+#define STACK_PROBE_SKIP 1024
+#define STACK_PROBE_PATTERN 0xA5A5A5A5u
+
+// app keys, same as appinfo.json
+static const struct {
+  const char *name;
+  uint32_t key;
+} REPLAY_KEYS[] = {
+  { "data", CGM_DATA_KEY },
+  { "vals", CGM_VALS_KEY },
+  { "hist", CGM_HIST_KEY }
+};
+
+// VARIABLES
+
+typedef struct {
+  uint32_t messages;
+  uint64_t cpu_ns;
+  uint64_t max_cpu_ns;
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t text_sets;
+  uint32_t bitmap_sets;
+  uint32_t draw_calls;
+  uint32_t vibes;
+  uint32_t max_stack_bytes;
+} ReplayTotals;
+
+static ReplayTotals totals;
+static uint8_t quiet = 100;
+
+// CODE START
+
+static uint64_t cpu_time_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+} // end func
+
+// host stack, x86-64 and -O2, with the shim's own frames; compare builds with it, not with the watch
+static __attribute__((noinline)) void stack_paint(uint8_t *stack_top) {
+  volatile uint32_t *word = (volatile uint32_t *)(((uintptr_t)(stack_top - STACK_PROBE_BYTES)) & ~(uintptr_t)3);
+  volatile uint32_t *paint_end = (volatile uint32_t *)(stack_top - STACK_PROBE_SKIP);
+
+  while (word < paint_end) {
+    *word++ = STACK_PROBE_PATTERN;
+  }
+} // end func
+
+// bytes below stack_top that were written since stack_paint
+static __attribute__((noinline)) uint32_t stack_used(uint8_t *stack_top) {
+  volatile uint32_t *word = (volatile uint32_t *)(((uintptr_t)(stack_top - STACK_PROBE_BYTES)) & ~(uintptr_t)3);
+  volatile uint32_t *paint_end = (volatile uint32_t *)(stack_top - STACK_PROBE_SKIP);
+
+  while ((word < paint_end) && (*word == STACK_PROBE_PATTERN)) {
+    word++;
+  }
+  return (uint32_t)(stack_top - (uint8_t *)word);
+} // end func
+
+// one message through the handler, the animations it starts and the draw; returns the stack it used,
+// measured from this frame, which is small, so the paint stays clear of the caller's buffers
+static __attribute__((noinline)) uint32_t run_message(DictionaryIterator *read_iter, uint64_t *cpu_ns) {
+  uint8_t *stack_top = __builtin_frame_address(0);
+  uint64_t start_ns = 0;
+
+  stack_paint(stack_top);
+
+  start_ns = cpu_time_ns();
+  stub_inbox_received_handler()(read_iter, NULL);
+  stub_run_animations();
+  stub_render();
+  *cpu_ns = cpu_time_ns() - start_ns;
+
+  return stack_used(stack_top);
+} // end func
+
+static uint32_t read_uint32_le(const uint8_t *bytes) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+} // end func
+
+// "name":[1,2,3] in a JSON line; returns the byte count, or -1 if the key isn't there
+static int parse_byte_array(const char *json, const char *name, uint8_t *bytes, int max_bytes) {
+  char pattern[16];
+  const char *cursor = NULL;
+  char *end = NULL;
+  int count = 0;
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":[", name);
+  cursor = strstr(json, pattern);
+  if (cursor == NULL) {
+    return -1;
+  }
+  cursor += strlen(pattern);
+
+  while ((*cursor != ']') && (*cursor != '\0') && (count < max_bytes)) {
+    bytes[count++] = (uint8_t)strtoul(cursor, &end, 10);
+    cursor = end;
+    if (*cursor == ',') {
+      cursor++;
+    }
+  }
+  return count;
+} // end func
+
+// watch clock for this message: the send time if the line has one, else the reading time
+static void set_clock(const char *line, const uint8_t *data, int data_size) {
+  char *end = NULL;
+  time_t sent = (time_t)strtoull(line, &end, 10);
+
+  if ((end != line) && (sent > 0)) {
+    stub_set_time(sent);
+  }
+  else if ((data_size >= CGM_DATA_NAME) && (data[CGM_DATA_STATUS] == CGM_STATUS_READING)) {
+    stub_set_time(read_uint32_le(&data[CGM_DATA_TAPP]));
+  }
+  else if ((data_size >= CGM_DATA_SAME_TAPP + 4) && (data[CGM_DATA_STATUS] == CGM_STATUS_SAME)) {
+    stub_set_time(read_uint32_le(&data[CGM_DATA_SAME_TAPP]));
+  }
+  else {
+    stub_set_time(stub_get_time() + 60);
+  }
+} // end func
+
+static void replay_line(const char *line, uint32_t line_number) {
+  const char *json = strchr(line, '{');
+  uint8_t bytes[ARRAY_LENGTH(REPLAY_KEYS)][REPLAY_BYTES_MAX];
+  int sizes[ARRAY_LENGTH(REPLAY_KEYS)];
+  uint8_t buffer[REPLAY_DICT_MAX];
+  DictionaryIterator write_iter;
+  DictionaryIterator read_iter;
+  uint32_t dict_size = 0;
+  uint8_t has_key = 100;
+  uint64_t cpu_ns = 0;
+  uint32_t draw_calls = 0;
+  uint32_t stack_bytes = 0;
+
+  if (json == NULL) {
+    return;
+  }
+
+  for (uint8_t k = 0; k < ARRAY_LENGTH(REPLAY_KEYS); k++) {
+    sizes[k] = parse_byte_array(json, REPLAY_KEYS[k].name, bytes[k], REPLAY_BYTES_MAX);
+    if (sizes[k] >= 0) {
+      has_key = 111;
+    }
+  }
+  if (has_key == 100) {
+    return;
+  }
+
+  // same dictionary the phone would have sent
+  dict_write_begin(&write_iter, buffer, sizeof(buffer));
+  for (uint8_t k = 0; k < ARRAY_LENGTH(REPLAY_KEYS); k++) {
+    if (sizes[k] >= 0) {
+      dict_write_data(&write_iter, REPLAY_KEYS[k].key, bytes[k], (uint16_t)sizes[k]);
+    }
+  }
+  dict_size = dict_write_end(&write_iter);
+  dict_read_begin_from_buffer(&read_iter, buffer, (uint16_t)dict_size);
+
+  set_clock(line, bytes[0], sizes[0]);
+  stub_reset_stats();
+  stack_bytes = run_message(&read_iter, &cpu_ns);
+
+  draw_calls = stub_stats.draw_text + stub_stats.draw_bitmap + stub_stats.draw_pixel +
+    stub_stats.draw_line + stub_stats.fill_rect;
+
+  totals.messages++;
+  totals.cpu_ns += cpu_ns;
+  if (cpu_ns > totals.max_cpu_ns) {
+    totals.max_cpu_ns = cpu_ns;
+  }
+  totals.allocs += stub_stats.allocs;
+  totals.frees += stub_stats.frees;
+  totals.text_sets += stub_stats.text_sets;
+  totals.bitmap_sets += stub_stats.bitmap_sets;
+  totals.draw_calls += draw_calls;
+  totals.vibes += stub_stats.vibes;
+  if (stack_bytes > totals.max_stack_bytes) {
+    totals.max_stack_bytes = stack_bytes;
+  }
+
+  if (quiet == 100) {
+    printf("%5u %-4s %5u us  alloc %3u free %3u live %6u  text %2u bitmap %2u  draw %4u (text %2u bitmap %2u pixel %4u)  vibe %u  stack %u\n",
+      line_number, (sizes[2] >= 0) ? "hist" : ((sizes[0] >= 0) ? "data" : "vals"),
+      (unsigned)(cpu_ns / 1000), stub_stats.allocs, stub_stats.frees, stub_stats.live_bytes,
+      stub_stats.text_sets, stub_stats.bitmap_sets, draw_calls,
+      stub_stats.draw_text, stub_stats.draw_bitmap, stub_stats.draw_pixel, stub_stats.vibes, stack_bytes);
+  }
+} // end func
+
+static void replay_file(const char *path) {
+  char line[REPLAY_LINE_MAX];
+  uint32_t line_number = 0;
+  FILE *stream = fopen(path, "r");
+
+  if (stream == NULL) {
+    perror(path);
+    exit(1);
+  }
+  while (fgets(line, sizeof(line), stream) != NULL) {
+    replay_line(line, ++line_number);
+  }
+  fclose(stream);
+} // end func
+
+int main(int argc, char **argv) {
+  int arg = 1;
+
+  // watch time is local time; keep it the same as the recorded stream
+  setenv("TZ", "UTC", 1);
+  tzset();
+
+  for (; (arg < argc) && (argv[arg][0] == '-'); arg++) {
+    if (strcmp(argv[arg], "-q") == 0) {
+      quiet = 111;
+    }
+    else if (strcmp(argv[arg], "-v") == 0) {
+      stub_log_enabled = true;
+    }
+  }
+  if (arg >= argc) {
+    fprintf(stderr, "usage: %s [-q] [-v] stream.log ...\n", argv[0]);
+    return 2;
+  }
+
+  stub_set_time(1767247200);
+  init_cgm();
+  stub_render();
+
+  for (; arg < argc; arg++) {
+    replay_file(argv[arg]);
+  }
+
+  if (totals.messages > 0) {
+    printf("messages %u  cpu us avg %.1f max %.1f  allocs %u frees %u  text sets %u bitmap sets %u  draw calls %u  vibes %u  peak heap %u  peak stack %u\n",
+      totals.messages, (double)totals.cpu_ns / totals.messages / 1000.0, (double)totals.max_cpu_ns / 1000.0,
+      totals.allocs, totals.frees, totals.text_sets, totals.bitmap_sets, totals.draw_calls, totals.vibes,
+      stub_stats.peak_live_bytes, totals.max_stack_bytes);
+  }
+
+  deinit_cgm();
+  return 0;
+} // end main
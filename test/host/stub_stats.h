@@ -0,0 +1,68 @@
+#pragma once
+
+// HARNESS SIDE OF THE PEBBLE SHIM
+// Counters kept by pebble_stub.c, and the controls the SDK itself doesn't have: the watch clock,
+// bluetooth, rendering the window and running scheduled animations to the end.
+
+#include "pebble.h"
+
+typedef struct {
+  // heap; every SDK object and bitmap the app creates or destroys
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t alloc_bytes;
+  uint32_t live_bytes;
+  uint32_t peak_live_bytes;
+
+  // layer updates the app asks for
+  uint32_t text_sets;
+  uint32_t bitmap_sets;
+  uint32_t hidden_sets;
+  uint32_t dirty_marks;
+
+  // graphics calls made while rendering, see stub_render
+  uint32_t renders;
+  uint32_t draw_text;
+  uint32_t draw_bitmap;
+  uint32_t draw_pixel;
+  uint32_t draw_line;
+  uint32_t fill_rect;
+
+  // everything else that costs power or flash wear
+  uint32_t vibes;
+  uint32_t timer_registers;
+  uint32_t timer_reschedules;
+  uint32_t timer_cancels;
+  uint32_t animations;
+  uint32_t persist_reads;
+  uint32_t persist_writes;
+  uint32_t outbox_sends;
+} StubStats;
+
+extern StubStats stub_stats;
+
+// counters back to zero; live and peak heap bytes are kept, they are state, not counts
+void stub_reset_stats(void);
+
+// watch clock in local seconds, what time() returns to the app
+void stub_set_time(time_t now);
+time_t stub_get_time(void);
+
+// bluetooth state the app sees at init
+void stub_set_bluetooth(bool connected);
+
+// draw the pushed window the way the system does when a layer is dirty: every visible layer,
+// bottom first; does nothing if nothing was marked dirty since the last render
+void stub_render(void);
+
+// run every scheduled animation to the end; started, then stopped with finished set
+void stub_run_animations(void);
+
+// forget the persisted keys, like a fresh install
+void stub_persist_clear(void);
+
+// the handler cgm.c registered for incoming messages
+AppMessageInboxReceived stub_inbox_received_handler(void);
+
+// app_log lines go to stderr only when this is set; they are off so they don't skew timings
+extern bool stub_log_enabled;
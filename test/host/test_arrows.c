@@ -0,0 +1,131 @@
+// TESTS FOR THE ARROW ICONS
+// load_icon for every arrow code the phone sends and for codes past the table: the icon the face
+// shows, and the DOUBLEDOWN alert, which vibrates once when the arrow turns to it.
+
+#include "stub_stats.h"
+#include "cgm.c"
+
+// the app's main is built as cgm_main, see the Makefile
+#undef main
+
+// CONSTANTS
+
+// icon for each arrow code; codes without an arrow show nothing, unknown codes show the logo
+static const uint8_t EXPECTED_ICONS[ARROW_CODE_COUNT] = {
+  ICON_SPECVALUE_NONE,	//NO_ARROW
+  ICON_UPUP,		//DOUBLEUP_ARROW
+  ICON_UP,		//SINGLEUP_ARROW
+  ICON_UP45,		//UP45_ARROW
+  ICON_FLAT,		//FLAT_ARROW
+  ICON_DOWN45,		//DOWN45_ARROW
+  ICON_DOWN,		//SINGLEDOWN_ARROW
+  ICON_DOWNDOWN,	//DOUBLEDOWN_ARROW
+  ICON_SPECVALUE_NONE,	//NOTCOMPUTE_ICON
+  ICON_SPECVALUE_NONE	//OUTOFRANGE_ICON
+};
+
+static const uint8_t UNKNOWN_CODES[] = { ARROW_CODE_COUNT, ARROW_CODE_COUNT + 1, 100, 255 };
+
+// VARIABLES
+
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+#define CHECK(condition, message, value) check((condition), message, value, __LINE__)
+
+// CODE START
+
+static void check(const bool condition, const char *message, const int value, const int line) {
+  checks++;
+  if (!condition) {
+    failures++;
+    printf("line %d: %s (arrow code %d)\n", line, message, value);
+  }
+} // end func
+
+// the arrow as the phone sends it; returns the vibes it caused
+static uint32_t show_arrow(const uint8_t arrow_code) {
+  stub_reset_stats();
+  current_icon = arrow_code;
+  load_icon();
+  return stub_stats.vibes;
+} // end func
+
+static bool showing_icon(const uint8_t icon_id) {
+  return face_view_cgm.bitmap[FACE_ICON] == get_cached_bitmap(icon_id);
+} // end func
+
+static void test_known_codes(void) {
+
+  for (uint8_t arrow_code = 0; arrow_code < ARROW_CODE_COUNT; arrow_code++) {
+    // from flat, so DOUBLEDOWN is a turn to an alert arrow every time
+    show_arrow(FLAT_ARROW);
+    uint32_t vibes = show_arrow(arrow_code);
+    CHECK(showing_icon(EXPECTED_ICONS[arrow_code]), "wrong icon", arrow_code);
+    CHECK(vibes == ((arrow_code == DOUBLEDOWN_ARROW) ? 1 : 0), "wrong vibes", arrow_code);
+  }
+
+} // end func
+
+static void test_unknown_codes(void) {
+
+  for (uint8_t code_index = 0; code_index < ARRAY_LENGTH(UNKNOWN_CODES); code_index++) {
+    show_arrow(DOUBLEDOWN_ARROW);
+    uint32_t vibes = show_arrow(UNKNOWN_CODES[code_index]);
+    CHECK(showing_icon(ICON_LOGO), "unknown code doesn't show the logo", UNKNOWN_CODES[code_index]);
+    CHECK(vibes == 0, "unknown code vibrates", UNKNOWN_CODES[code_index]);
+  }
+
+} // end func
+
+static void test_doubledown_alert(void) {
+
+  // once on the turn, not again while it stays down
+  show_arrow(SINGLEDOWN_ARROW);
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 1, "no vibe on the turn to DOUBLEDOWN", DOUBLEDOWN_ARROW);
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 0, "vibe again while DOUBLEDOWN", DOUBLEDOWN_ARROW);
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 0, "vibe again while DOUBLEDOWN", DOUBLEDOWN_ARROW);
+
+  // an unknown code in between clears it like any arrow without an alert
+  show_arrow(UNKNOWN_CODES[0]);
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 1, "no vibe after an unknown code", DOUBLEDOWN_ARROW);
+
+  // drawing the saved reading at startup shows the arrow, but doesn't vibrate
+  show_arrow(FLAT_ARROW);
+  RestoringState = 111;
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 0, "vibe while restoring state", DOUBLEDOWN_ARROW);
+  CHECK(showing_icon(ICON_DOWNDOWN), "no arrow while restoring state", DOUBLEDOWN_ARROW);
+  RestoringState = 100;
+
+  // vibrations off in the config
+  show_arrow(FLAT_ARROW);
+  TurnOffAllVibrations = 111;
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 0, "vibe with vibrations off", DOUBLEDOWN_ARROW);
+  TurnOffAllVibrations = 100;
+
+} // end func
+
+static void test_special_value(void) {
+
+  // a special value owns the icon; the arrow is ignored until it clears
+  show_arrow(FLAT_ARROW);
+  specvalue_alert = 111;
+  CHECK(show_arrow(DOUBLEDOWN_ARROW) == 0, "vibe with a special value", DOUBLEDOWN_ARROW);
+  CHECK(showing_icon(ICON_FLAT), "arrow drawn over a special value", DOUBLEDOWN_ARROW);
+  specvalue_alert = 100;
+
+} // end func
+
+int main(void) {
+
+  init_cgm();
+
+  test_known_codes();
+  test_unknown_codes();
+  test_doubledown_alert();
+  test_special_value();
+
+  printf("arrows: %u checks, %u failed\n", checks, failures);
+  deinit_cgm();
+  return (failures == 0) ? 0 : 1;
+} // end main
@@ -0,0 +1,268 @@
+// TESTS FOR THE HISTORY BACKFILL
+// hist chunks through the inbox handler the way the phone sends them: chunks in their own messages
+// before the newest reading, a chunk and a SAME data tuple in one message, entries the watch already
+// has, a gap too long for the minutes field and more entries than the history holds. Checks the
+// history count and every entry, newest first, and the time of the newest.
+
+#include "stub_stats.h"
+#include "cgm.c"
+
+// the app's main is built as cgm_main, see the Makefile
+#undef main
+
+// CONSTANTS
+
+#define BACKFILL_DICT_MAX 256
+#define BACKFILL_BASE_TIME 1767247200
+#define READING_SECS 300
+
+// VARIABLES
+
+typedef struct {
+  uint32_t time;
+  int16_t bg;
+} BackfillEntry;
+
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+#define CHECK(condition, message, value) check((condition), message, value, __LINE__)
+
+// CODE START
+
+static void check(const bool condition, const char *message, const int value, const int line) {
+  checks++;
+  if (!condition) {
+    failures++;
+    printf("line %d: %s (%d)\n", line, message, value);
+  }
+} // end func
+
+static void put_uint16(uint8_t *bytes, const uint16_t value) {
+  bytes[0] = value & 0xFF;
+  bytes[1] = (value >> 8) & 0xFF;
+} // end func
+
+static void put_uint32(uint8_t *bytes, const uint32_t value) {
+  put_uint16(bytes, value & 0xFFFF);
+  put_uint16(&bytes[2], value >> 16);
+} // end func
+
+// a whole reading, flat arrow, no name; returns its size
+static uint16_t reading_bytes(uint8_t *bytes, const int16_t bg, const uint32_t tcgm) {
+  memset(bytes, 0, CGM_DATA_NAME);
+  bytes[CGM_DATA_VERSION] = CGM_PROTOCOL_VERSION;
+  bytes[CGM_DATA_STATUS] = CGM_STATUS_READING;
+  bytes[CGM_DATA_ARROW] = FLAT_ARROW;
+  put_uint16(&bytes[CGM_DATA_BG], (uint16_t)bg);
+  put_uint32(&bytes[CGM_DATA_TCGM], tcgm);
+  put_uint32(&bytes[CGM_DATA_TAPP], tcgm + 30);
+  bytes[CGM_DATA_UBAT] = 80;
+  put_uint16(&bytes[CGM_DATA_CLRW], (uint16_t)CGM_RAW_NONE);
+  put_uint16(&bytes[CGM_DATA_RWUF], (uint16_t)CGM_RAW_NONE);
+  return CGM_DATA_NAME;
+} // end func
+
+static uint16_t same_bytes(uint8_t *bytes, const uint32_t tcgm, const uint32_t tapp) {
+  bytes[CGM_DATA_VERSION] = CGM_PROTOCOL_VERSION;
+  bytes[CGM_DATA_STATUS] = CGM_STATUS_SAME;
+  put_uint32(&bytes[CGM_DATA_SAME_TCGM], tcgm);
+  put_uint32(&bytes[CGM_DATA_SAME_TAPP], tapp);
+  return CGM_DATA_SAME_SIZE;
+} // end func
+
+// one chunk the way encodeHistory builds it: base time, then seconds since the entry before; arrow in
+// the low 4 bits, noise 1 in the high 4 bits
+static uint16_t hist_bytes(uint8_t *bytes, const BackfillEntry *entries, const uint8_t entry_count) {
+  uint8_t *entry_data = NULL;
+
+  bytes[CGM_HIST_VERSION] = CGM_PROTOCOL_VERSION;
+  bytes[CGM_HIST_FLAGS] = 0;
+  bytes[CGM_HIST_COUNT] = entry_count;
+  put_uint32(&bytes[CGM_HIST_BASE_TIME], entries[0].time);
+  for (uint8_t entry_index = 0; entry_index < entry_count; entry_index++) {
+    entry_data = &bytes[CGM_HIST_ENTRIES + (entry_index * CGM_HIST_ENTRY_SIZE)];
+    put_uint16(&entry_data[CGM_HIST_ENTRY_DELTA], (entry_index == 0) ? 0 : (uint16_t)(entries[entry_index].time - entries[entry_index - 1].time));
+    put_uint16(&entry_data[CGM_HIST_ENTRY_BG], (uint16_t)entries[entry_index].bg);
+    entry_data[CGM_HIST_ENTRY_ARROW] = FLAT_ARROW | (1 << 4);
+  }
+  return CGM_HIST_ENTRIES + (entry_count * CGM_HIST_ENTRY_SIZE);
+} // end func
+
+// one dictionary through the inbox handler, hist first like the phone writes it; size 0 leaves a key out
+static void send_message(const uint8_t *hist, const uint16_t hist_size, const uint8_t *data, const uint16_t data_size) {
+  uint8_t buffer[BACKFILL_DICT_MAX];
+  DictionaryIterator write_iter;
+  DictionaryIterator read_iter;
+  uint32_t dict_size = 0;
+
+  dict_write_begin(&write_iter, buffer, sizeof(buffer));
+  if (hist_size > 0) {
+    dict_write_data(&write_iter, CGM_HIST_KEY, hist, hist_size);
+  }
+  if (data_size > 0) {
+    dict_write_data(&write_iter, CGM_DATA_KEY, data, data_size);
+  }
+  dict_size = dict_write_end(&write_iter);
+  dict_read_begin_from_buffer(&read_iter, buffer, (uint16_t)dict_size);
+
+  stub_inbox_received_handler()(&read_iter, NULL);
+  stub_run_animations();
+} // end func
+
+static void send_reading(const int16_t bg, const uint32_t tcgm) {
+  uint8_t data[CGM_DATA_MAX_SIZE];
+
+  stub_set_time(tcgm + 30);
+  send_message(NULL, 0, data, reading_bytes(data, bg, tcgm));
+} // end func
+
+static void send_chunk(const BackfillEntry *entries, const uint8_t entry_count) {
+  uint8_t hist[CGM_HIST_MAX_SIZE];
+
+  send_message(hist, hist_bytes(hist, entries, entry_count), NULL, 0);
+} // end func
+
+// readings every READING_SECS from first_time, BG first_bg and up by one
+static void make_entries(BackfillEntry *entries, const uint8_t entry_count, const uint32_t first_time, const int16_t first_bg) {
+  for (uint8_t entry_index = 0; entry_index < entry_count; entry_index++) {
+    entries[entry_index].time = first_time + (entry_index * READING_SECS);
+    entries[entry_index].bg = first_bg + entry_index;
+  }
+} // end func
+
+// newest first: BG and minutes since the one before
+static void check_history(const int16_t *bgs, const uint8_t *delta_mins, const uint8_t entry_count, const uint32_t last_time) {
+  const HistoryEntry *history_entry = NULL;
+
+  CHECK(history_count_cgm == entry_count, "wrong history count", history_count_cgm);
+  CHECK(history_last_time_cgm == last_time, "wrong newest reading time", (int)(history_last_time_cgm - BACKFILL_BASE_TIME));
+  for (uint8_t age_index = 0; age_index < entry_count; age_index++) {
+    history_entry = get_history_cgm(age_index);
+    CHECK(history_entry != NULL, "history entry missing", age_index);
+    if (history_entry == NULL) {
+      continue;
+    }
+    CHECK(history_entry->bg == bgs[age_index], "wrong BG in history", age_index);
+    CHECK(history_entry->delta_min == delta_mins[age_index], "wrong minutes in history", age_index);
+    CHECK(history_entry->arrow == FLAT_ARROW, "wrong arrow in history", age_index);
+  }
+  CHECK(get_history_cgm(entry_count) == NULL, "history entry past the count", entry_count);
+} // end func
+
+// same as a watch that just started
+static void reset_history(void) {
+  history_head_cgm = 0;
+  history_count_cgm = 0;
+  history_last_time_cgm = 0;
+  history_units_cgm = BG_UNITS_MGDL;
+} // end func
+
+// 12 missed readings, a full chunk and a part one in their own messages, then the newest reading
+static void test_chunks_then_reading(void) {
+  BackfillEntry entries[12];
+  int16_t bgs[14];
+  uint8_t delta_mins[14];
+
+  reset_history();
+  send_reading(100, BACKFILL_BASE_TIME);
+  make_entries(entries, 12, BACKFILL_BASE_TIME + READING_SECS, 101);
+  send_chunk(entries, 9);
+  CHECK(history_count_cgm == 10, "first chunk not in history", history_count_cgm);
+  send_chunk(&entries[9], 3);
+  send_reading(113, BACKFILL_BASE_TIME + (13 * READING_SECS));
+
+  for (uint8_t age_index = 0; age_index < 14; age_index++) {
+    bgs[age_index] = 113 - age_index;
+    delta_mins[age_index] = (age_index == 13) ? 0 : 5;
+  }
+  check_history(bgs, delta_mins, 14, BACKFILL_BASE_TIME + (13 * READING_SECS));
+  CHECK(current_bg.value == 113, "newest reading not shown", current_bg.value);
+
+} // end func
+
+// a chunk and a SAME data tuple in one message: the chunk still goes into the history
+static void test_chunk_with_same(void) {
+  BackfillEntry entries[2];
+  uint8_t hist[CGM_HIST_MAX_SIZE];
+  uint8_t data[CGM_DATA_MAX_SIZE];
+  uint16_t hist_size = 0;
+  static const int16_t BGS[] = { 121, 120, 100 };
+  static const uint8_t DELTA_MINS[] = { 5, 5, 0 };
+
+  reset_history();
+  send_reading(100, BACKFILL_BASE_TIME);
+  make_entries(entries, 2, BACKFILL_BASE_TIME + READING_SECS, 120);
+  hist_size = hist_bytes(hist, entries, 2);
+  stub_set_time(BACKFILL_BASE_TIME + 700);
+  send_message(hist, hist_size, data, same_bytes(data, BACKFILL_BASE_TIME, BACKFILL_BASE_TIME + 700));
+
+  check_history(BGS, DELTA_MINS, 3, BACKFILL_BASE_TIME + (2 * READING_SECS));
+  CHECK(current_bg.value == 100, "SAME changed the reading", current_bg.value);
+  CHECK(current_app_time == BACKFILL_BASE_TIME + 700, "SAME didn't move the app time", (int)(current_app_time - BACKFILL_BASE_TIME));
+
+} // end func
+
+// entries at or before the newest one the watch has are skipped; a gap past 255 minutes is 255
+static void test_old_entries_and_gap(void) {
+  BackfillEntry entries[3];
+  BackfillEntry after_gap[2];
+  static const int16_t BGS[] = { 131, 130, 101, 100 };
+  static const uint8_t DELTA_MINS[] = { 5, 255, 5, 0 };
+
+  reset_history();
+  send_reading(100, BACKFILL_BASE_TIME);
+  make_entries(entries, 3, BACKFILL_BASE_TIME - READING_SECS, 99);
+  send_chunk(entries, 3);
+  CHECK(history_count_cgm == 2, "old entries went into history", history_count_cgm);
+
+  // more than 65535 seconds on, so the phone starts a new chunk
+  make_entries(after_gap, 2, BACKFILL_BASE_TIME + READING_SECS + 70000, 130);
+  send_chunk(after_gap, 2);
+
+  check_history(BGS, DELTA_MINS, 4, BACKFILL_BASE_TIME + READING_SECS + 70000 + READING_SECS);
+
+} // end func
+
+// more than HISTORY_SIZE readings: the oldest ones drop out
+static void test_history_full(void) {
+  BackfillEntry entries[9];
+  int16_t bgs[HISTORY_SIZE];
+  uint8_t delta_mins[HISTORY_SIZE];
+  uint32_t time = BACKFILL_BASE_TIME;
+
+  reset_history();
+  send_reading(100, time);
+  for (uint8_t chunk = 0; chunk < 5; chunk++) {
+    make_entries(entries, 9, time + READING_SECS, 101 + (chunk * 9));
+    send_chunk(entries, 9);
+    time = entries[8].time;
+  }
+
+  // 46 readings, 100 to 145; the newest 36 are left
+  for (uint8_t age_index = 0; age_index < HISTORY_SIZE; age_index++) {
+    bgs[age_index] = 145 - age_index;
+    delta_mins[age_index] = 5;
+  }
+  check_history(bgs, delta_mins, HISTORY_SIZE, time);
+
+} // end func
+
+int main(void) {
+
+  // watch time is local time; keep it the same as the cgm times
+  setenv("TZ", "UTC", 1);
+  tzset();
+
+  stub_set_time(BACKFILL_BASE_TIME);
+  init_cgm();
+
+  test_chunks_then_reading();
+  test_chunk_with_same();
+  test_old_entries_and_gap();
+  test_history_full();
+
+  printf("backfill: %u checks, %u failed\n", checks, failures);
+  deinit_cgm();
+  return (failures == 0) ? 0 : 1;
+} // end main
@@ -0,0 +1,485 @@
+// TESTS FOR THE BG ALERT BANDS
+// classify_bg_bands_cgm against the band edges for mg/dL and mmol, special values, thresholds moved
+// by load_values and thresholds out of order; every BG from below zero to past the top against the
+// cascade it replaced; load_bg against a copy of the old alert code, snooze and overwrite flags
+// included, over a walk of readings; and a microbenchmark of the two lookups.
+//
+// usage: test_bg_bands [-b]
+//   -b  benchmark only
+
+#include "stub_stats.h"
+#include "cgm.c"
+
+// the app's main is built as cgm_main, see the Makefile
+#undef main
+
+// CONSTANTS
+
+#define BENCH_ROUNDS 20000
+#define BENCH_BG_BOTTOM -5
+#define BENCH_BG_TOP 420
+
+// readings in each walk of test_against_baseline, and the most minutes between two of them
+#define WALK_READINGS 3000
+#define WALK_MINUTES_MAX 6
+
+#define BAND(n) (1 << (n))
+
+// VARIABLES
+
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+// the old alert state, kept apart from the app's: lastAlertTime and the overwrite flag of each band
+typedef struct {
+  uint8_t last_alert_time;
+  uint8_t overwrite[BG_BAND_COUNT];
+  uint32_t vibes;
+} BaselineAlerts;
+
+static uint32_t walk_seed = 1;
+
+#define CHECK(condition, message, units, bg) check((condition), message, units, bg, __LINE__)
+#define CHECK_BANDS(units, bg, expected) check_bands(units, bg, expected, __LINE__)
+
+// CODE START
+
+static void check(const bool condition, const char *message, const uint8_t units, const int bg, const int line) {
+  checks++;
+  if (!condition) {
+    failures++;
+    printf("line %d: %s (%s BG %d)\n", line, message, (units == BG_UNITS_MGDL) ? "mg/dL" : "mmol", bg);
+  }
+} // end func
+
+static void check_bands(const uint8_t units, const int bg, const uint8_t expected, const int line) {
+  uint8_t bands = classify_bg_bands_cgm(units, bg);
+
+  checks++;
+  if (bands != expected) {
+    failures++;
+    printf("line %d: %s BG %d is in bands 0x%02x, expected 0x%02x\n", line, (units == BG_UNITS_MGDL) ? "mg/dL" : "mmol",
+      bg, bands, expected);
+  }
+} // end func
+
+// the threshold array load_bg rebuilt for every reading before the compiled table
+static void baseline_thresholds(const uint8_t units, uint16_t *bg_ptr) {
+  const uint16_t BG_MGDL[] = {
+    SPECVALUE_BG_MGDL, SHOWLOW_BG_MGDL, HYPOLOW_BG_MGDL, BIGLOW_BG_MGDL, MIDLOW_BG_MGDL,
+    LOW_BG_MGDL, HIGH_BG_MGDL, MIDHIGH_BG_MGDL, BIGHIGH_BG_MGDL, SHOWHIGH_BG_MGDL
+  };
+  const uint16_t BG_MMOL[] = {
+    SPECVALUE_BG_MMOL, SHOWLOW_BG_MMOL, HYPOLOW_BG_MMOL, BIGLOW_BG_MMOL, MIDLOW_BG_MMOL,
+    LOW_BG_MMOL, HIGH_BG_MMOL, MIDHIGH_BG_MMOL, BIGHIGH_BG_MMOL, SHOWHIGH_BG_MMOL
+  };
+
+  memcpy(bg_ptr, (units == BG_UNITS_MGDL) ? BG_MGDL : BG_MMOL, sizeof(BG_MGDL));
+} // end func
+
+// the old cascade: every band checked, (bottom, top]; returns all bands that matched, bit n for band n
+static uint8_t cascade_bg_bands(const uint8_t units, const int bg) {
+  uint16_t bg_ptr[BG_RANGE_COUNT];
+  uint8_t bands = BG_BANDS_NONE;
+
+  baseline_thresholds(units, bg_ptr);
+  const int bottoms[BG_BAND_COUNT] = {
+    0, bg_ptr[SPECVALUE_BG_INDX], bg_ptr[HYPOLOW_BG_INDX], bg_ptr[BIGLOW_BG_INDX],
+    bg_ptr[MIDLOW_BG_INDX], bg_ptr[HIGH_BG_INDX], bg_ptr[MIDHIGH_BG_INDX], bg_ptr[BIGHIGH_BG_INDX]
+  };
+  const int tops[BG_BAND_COUNT] = {
+    bg_ptr[SPECVALUE_BG_INDX], bg_ptr[HYPOLOW_BG_INDX], bg_ptr[BIGLOW_BG_INDX], bg_ptr[MIDLOW_BG_INDX],
+    bg_ptr[LOW_BG_INDX], bg_ptr[MIDHIGH_BG_INDX], bg_ptr[BIGHIGH_BG_INDX], 1000
+  };
+
+  for (uint8_t band = 0; band < BG_BAND_COUNT; band++) {
+    if ((bg > bottoms[band]) && (bg <= tops[band])) {
+      bands |= BAND(band);
+    }
+  }
+  return bands;
+} // end func
+
+// the old bg_vibrator, on the model's state: vibrates if the BG is in (bottom, top] and snooze is out
+// or the band hasn't alerted yet; a vibe of 1 to 3 is one pattern, like alert_handler_cgm
+static void baseline_bg_vibrator(BaselineAlerts *state, const int conv_vibrator_bg, const uint16_t bg_bottom,
+    const uint16_t bg_top, const uint8_t bg_snooze, const uint8_t band, const uint8_t bg_vibe) {
+
+  if ( ( ((conv_vibrator_bg > bg_bottom) && (conv_vibrator_bg <= bg_top))
+      && ((state->last_alert_time == 0) || (state->last_alert_time > bg_snooze)) )
+    || ( ((conv_vibrator_bg > bg_bottom) && (conv_vibrator_bg <= bg_top)) && (state->overwrite[band] == 100) ) ) {
+
+    if ((state->last_alert_time == 0) || (state->overwrite[band] == 100)) {
+      if ((bg_vibe >= 1) && (bg_vibe <= 3) && (TurnOffAllVibrations == 100)) {
+        state->vibes++;
+      }
+      state->last_alert_time = 1;
+      if (state->overwrite[band] == 100) { state->overwrite[band] = 111; }
+    }
+
+    // snooze out resets every band but the high one, same as the old code
+    if (state->last_alert_time > bg_snooze) {
+      state->last_alert_time = 0;
+      for (uint8_t reset = 0; reset < BG_BAND_COUNT; reset++) {
+        if (reset != 5) {
+          state->overwrite[reset] = 100;
+        }
+      }
+    }
+  }
+} // end func
+
+// the vibrate part of the old load_bg for a BG above zero
+static void baseline_load_bg(BaselineAlerts *state, const uint8_t units, const int bg) {
+  uint16_t bg_ptr[BG_RANGE_COUNT];
+  int conv_vibrator_bg = bg;
+
+  baseline_thresholds(units, bg_ptr);
+  if ( ((units == BG_UNITS_MMOL) && (bg >= HIGH_BG_MGDL)) || ((units == BG_UNITS_MGDL) && (bg >= HIGH_BG_MMOL)) ) {
+    conv_vibrator_bg = bg + 1;
+  }
+
+  baseline_bg_vibrator(state, conv_vibrator_bg, 0, bg_ptr[SPECVALUE_BG_INDX], SPECVALUE_SNZ_MIN, 0, SPECVALUE_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[SPECVALUE_BG_INDX], bg_ptr[HYPOLOW_BG_INDX], HYPOLOW_SNZ_MIN, 1, HYPOLOWBG_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[HYPOLOW_BG_INDX], bg_ptr[BIGLOW_BG_INDX], BIGLOW_SNZ_MIN, 2, BIGLOWBG_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[BIGLOW_BG_INDX], bg_ptr[MIDLOW_BG_INDX], MIDLOW_SNZ_MIN, 3, LOWBG_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[MIDLOW_BG_INDX], bg_ptr[LOW_BG_INDX], LOW_SNZ_MIN, 4, LOWBG_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[HIGH_BG_INDX], bg_ptr[MIDHIGH_BG_INDX], HIGH_SNZ_MIN, 5, HIGHBG_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[MIDHIGH_BG_INDX], bg_ptr[BIGHIGH_BG_INDX], MIDHIGH_SNZ_MIN, 6, HIGHBG_VIBE);
+  baseline_bg_vibrator(state, conv_vibrator_bg, bg_ptr[BIGHIGH_BG_INDX], 1000, BIGHIGH_SNZ_MIN, 7, BIGHIGHBG_VIBE);
+
+  if ((bg > bg_ptr[LOW_BG_INDX]) && (bg < bg_ptr[HIGH_BG_INDX])) {
+    state->last_alert_time = 0;
+  }
+} // end func
+
+// the reading through the app's load_bg; returns the vibes it caused
+static uint32_t app_load_bg(const uint8_t units, const int bg) {
+  stub_reset_stats();
+  current_bg.value = bg;
+  current_bg.units = units;
+  load_bg();
+  stub_run_animations();
+  return stub_stats.vibes;
+} // end func
+
+// fresh alert state in the app and in the model
+static void reset_alerts(BaselineAlerts *state) {
+  lastAlertTime = 0;
+  state->last_alert_time = 0;
+  state->vibes = 0;
+  for (uint8_t band = 0; band < BG_BAND_COUNT; band++) {
+    *BG_BAND_ALERTS[band].overwrite = 100;
+    state->overwrite[band] = 100;
+  }
+} // end func
+
+// thresholds as the app starts, for both units; load_values only moves the extra ones away from these
+static void default_thresholds(void) {
+  HYPOLOW_BG_MGDL = 55;
+  BIGLOW_BG_MGDL = 60;
+  MIDLOW_BG_MGDL = 70;
+  MIDHIGH_BG_MGDL = 240;
+  BIGHIGH_BG_MGDL = 300;
+  HYPOLOW_BG_MMOL = 30;
+  BIGLOW_BG_MMOL = 33;
+  MIDLOW_BG_MMOL = 39;
+  MIDHIGH_BG_MMOL = 133;
+  BIGHIGH_BG_MMOL = 166;
+} // end func
+
+static void set_thresholds(const uint8_t units, const uint16_t low_bg, const uint16_t high_bg) {
+  CgmSettings settings = {
+    .units = units, .low_bg = low_bg, .high_bg = high_bg, .low_snooze = 15, .high_snooze = 30,
+    .low_vibe = 2, .high_vibe = 1, .vibe_pattern = 2, .time_format = 0, .raw_vibrate = 0, .cfg_version = 1
+  };
+  load_values(&settings);
+} // end func
+
+static uint32_t walk_random(const uint32_t range) {
+  walk_seed = (walk_seed * 1103515245u) + 12345u;
+  return (walk_seed >> 16) % range;
+} // end func
+
+static void test_default_edges(void) {
+
+  // mg/dL: 20 55 60 70 80 | 180 240 300 | 1000
+  CHECK_BANDS(BG_UNITS_MGDL, 1, BAND(0));
+  CHECK_BANDS(BG_UNITS_MGDL, 20, BAND(0));
+  CHECK_BANDS(BG_UNITS_MGDL, 21, BAND(1));
+  CHECK_BANDS(BG_UNITS_MGDL, 40, BAND(1));
+  CHECK_BANDS(BG_UNITS_MGDL, 55, BAND(1));
+  CHECK_BANDS(BG_UNITS_MGDL, 56, BAND(2));
+  CHECK_BANDS(BG_UNITS_MGDL, 60, BAND(2));
+  CHECK_BANDS(BG_UNITS_MGDL, 61, BAND(3));
+  CHECK_BANDS(BG_UNITS_MGDL, 70, BAND(3));
+  CHECK_BANDS(BG_UNITS_MGDL, 71, BAND(4));
+  CHECK_BANDS(BG_UNITS_MGDL, 80, BAND(4));
+  CHECK_BANDS(BG_UNITS_MGDL, 81, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MGDL, 120, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MGDL, 180, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MGDL, 181, BAND(5));
+  CHECK_BANDS(BG_UNITS_MGDL, 240, BAND(5));
+  CHECK_BANDS(BG_UNITS_MGDL, 241, BAND(6));
+  CHECK_BANDS(BG_UNITS_MGDL, 300, BAND(6));
+  CHECK_BANDS(BG_UNITS_MGDL, 301, BAND(7));
+  CHECK_BANDS(BG_UNITS_MGDL, 401, BAND(7));
+  CHECK_BANDS(BG_UNITS_MGDL, 1000, BAND(7));
+  CHECK_BANDS(BG_UNITS_MGDL, 1001, BG_BANDS_NONE);
+
+  // mmol, tenths: 11 30 33 39 44 | 100 133 166 | 1000
+  CHECK_BANDS(BG_UNITS_MMOL, 1, BAND(0));
+  CHECK_BANDS(BG_UNITS_MMOL, 11, BAND(0));
+  CHECK_BANDS(BG_UNITS_MMOL, 12, BAND(1));
+  CHECK_BANDS(BG_UNITS_MMOL, 30, BAND(1));
+  CHECK_BANDS(BG_UNITS_MMOL, 31, BAND(2));
+  CHECK_BANDS(BG_UNITS_MMOL, 33, BAND(2));
+  CHECK_BANDS(BG_UNITS_MMOL, 34, BAND(3));
+  CHECK_BANDS(BG_UNITS_MMOL, 39, BAND(3));
+  CHECK_BANDS(BG_UNITS_MMOL, 40, BAND(4));
+  CHECK_BANDS(BG_UNITS_MMOL, 44, BAND(4));
+  CHECK_BANDS(BG_UNITS_MMOL, 45, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MMOL, 100, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MMOL, 101, BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 133, BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 134, BAND(6));
+  CHECK_BANDS(BG_UNITS_MMOL, 166, BAND(6));
+  CHECK_BANDS(BG_UNITS_MMOL, 167, BAND(7));
+  CHECK_BANDS(BG_UNITS_MMOL, 1000, BAND(7));
+  CHECK_BANDS(BG_UNITS_MMOL, 1001, BG_BANDS_NONE);
+
+} // end func
+
+static void test_units(void) {
+
+  // same number, different units: 50 is a big low in mg/dL, in range in mmol (5.0)
+  CHECK_BANDS(BG_UNITS_MGDL, 50, BAND(1));
+  CHECK_BANDS(BG_UNITS_MMOL, 50, BG_BANDS_NONE);
+
+  // 150 is in range in mg/dL, a mid high in mmol (15.0)
+  CHECK_BANDS(BG_UNITS_MGDL, 150, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MMOL, 150, BAND(6));
+
+  // 15 is a special value in mg/dL, a hypo low in mmol (1.5)
+  CHECK_BANDS(BG_UNITS_MGDL, 15, BAND(0));
+  CHECK_BANDS(BG_UNITS_MMOL, 15, BAND(1));
+
+} // end func
+
+static void test_special_values(void) {
+
+  // every special value code is at or below SPECVALUE_BG; zero and below is no reading, not an alert
+  for (int bg = 1; bg <= SPECVALUE_BG_MGDL; bg++) {
+    CHECK_BANDS(BG_UNITS_MGDL, bg, BAND(0));
+  }
+  for (int bg = 1; bg <= SPECVALUE_BG_MMOL; bg++) {
+    CHECK_BANDS(BG_UNITS_MMOL, bg, BAND(0));
+  }
+  CHECK_BANDS(BG_UNITS_MGDL, 0, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MGDL, -1, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MMOL, 0, BG_BANDS_NONE);
+
+} // end func
+
+static void test_load_values(void) {
+
+  // low 65 moves the lows down to 50 55 60, high 250 moves the highs up to 300 350
+  set_thresholds(0, 65, 250);
+  CHECK_BANDS(BG_UNITS_MGDL, 50, BAND(1));
+  CHECK_BANDS(BG_UNITS_MGDL, 51, BAND(2));
+  CHECK_BANDS(BG_UNITS_MGDL, 55, BAND(2));
+  CHECK_BANDS(BG_UNITS_MGDL, 56, BAND(3));
+  CHECK_BANDS(BG_UNITS_MGDL, 60, BAND(3));
+  CHECK_BANDS(BG_UNITS_MGDL, 61, BAND(4));
+  CHECK_BANDS(BG_UNITS_MGDL, 65, BAND(4));
+  CHECK_BANDS(BG_UNITS_MGDL, 66, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MGDL, 250, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MGDL, 251, BAND(5));
+  CHECK_BANDS(BG_UNITS_MGDL, 300, BAND(5));
+  CHECK_BANDS(BG_UNITS_MGDL, 301, BAND(6));
+  CHECK_BANDS(BG_UNITS_MGDL, 350, BAND(6));
+  CHECK_BANDS(BG_UNITS_MGDL, 351, BAND(7));
+
+  // the other units keep their own thresholds
+  CHECK_BANDS(BG_UNITS_MMOL, 44, BAND(4));
+  CHECK_BANDS(BG_UNITS_MMOL, 101, BAND(5));
+
+  // mmol low 3.5 and high 14.0
+  set_thresholds(1, 35, 140);
+  CHECK_BANDS(BG_UNITS_MMOL, 28, BAND(1));
+  CHECK_BANDS(BG_UNITS_MMOL, 29, BAND(2));
+  CHECK_BANDS(BG_UNITS_MMOL, 35, BAND(4));
+  CHECK_BANDS(BG_UNITS_MMOL, 36, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MMOL, 140, BG_BANDS_NONE);
+  CHECK_BANDS(BG_UNITS_MMOL, 141, BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 166, BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 201, BAND(7));
+
+} // end func
+
+// low above high: the config page doesn't stop it, and the BGs between are in a low and a high band
+static void test_out_of_order(void) {
+  BaselineAlerts state;
+
+  default_thresholds();
+  set_thresholds(0, 200, 150);
+  set_thresholds(1, 120, 100);
+
+  CHECK_BANDS(BG_UNITS_MGDL, 150, BAND(4));
+  CHECK_BANDS(BG_UNITS_MGDL, 151, BAND(4) | BAND(5));
+  CHECK_BANDS(BG_UNITS_MGDL, 200, BAND(4) | BAND(5));
+  CHECK_BANDS(BG_UNITS_MGDL, 201, BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 100, BAND(4));
+  CHECK_BANDS(BG_UNITS_MMOL, 101, BAND(4) | BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 120, BAND(4) | BAND(5));
+  CHECK_BANDS(BG_UNITS_MMOL, 121, BAND(5));
+
+  // fresh state: the low band vibrates and sets snooze, the high band still vibrates once on its overwrite
+  reset_alerts(&state);
+  CHECK(app_load_bg(BG_UNITS_MGDL, 160) == 2, "low and high band don't both vibrate", BG_UNITS_MGDL, 160);
+  CHECK(lastAlertTime == 1, "snooze not started", BG_UNITS_MGDL, 160);
+  CHECK(low_overwrite == 111, "low band not marked alerted", BG_UNITS_MGDL, 160);
+  CHECK(high_overwrite == 111, "high band not marked alerted", BG_UNITS_MGDL, 160);
+
+  // both marked, so the next reading in snooze is quiet
+  ++lastAlertTime;
+  CHECK(app_load_bg(BG_UNITS_MGDL, 165) == 0, "vibe again in snooze", BG_UNITS_MGDL, 165);
+
+  reset_alerts(&state);
+  CHECK(app_load_bg(BG_UNITS_MMOL, 110) == 2, "low and high band don't both vibrate", BG_UNITS_MMOL, 110);
+
+  default_thresholds();
+  set_thresholds(0, 80, 180);
+  set_thresholds(1, 44, 100);
+
+} // end func
+
+// every BG, every units, a spread of thresholds the config page can send, in order and not
+static void test_against_cascade(void) {
+  static const uint16_t MGDL_SETTINGS[][2] = { { 80, 180 }, { 55, 150 }, { 65, 250 }, { 90, 240 }, { 70, 300 }, { 200, 150 }, { 130, 60 } };
+  static const uint16_t MMOL_SETTINGS[][2] = { { 44, 100 }, { 30, 120 }, { 35, 140 }, { 50, 133 }, { 39, 180 }, { 120, 100 }, { 80, 35 } };
+
+  for (uint8_t setting = 0; setting < ARRAY_LENGTH(MGDL_SETTINGS); setting++) {
+    default_thresholds();
+    set_thresholds(0, MGDL_SETTINGS[setting][0], MGDL_SETTINGS[setting][1]);
+    set_thresholds(1, MMOL_SETTINGS[setting][0], MMOL_SETTINGS[setting][1]);
+    for (uint8_t units = 0; units < BG_UNITS_COUNT; units++) {
+      for (int bg = -5; bg <= 1005; bg++) {
+        CHECK_BANDS(units, bg, cascade_bg_bands(units, bg));
+      }
+    }
+  }
+
+} // end func
+
+// load_bg against the old code over a walk of readings, a few minutes of snooze apart, jumps included:
+// same vibes, same snooze counter, same overwrite flags after every reading
+static void test_against_baseline(void) {
+  static const uint16_t MGDL_SETTINGS[][2] = { { 80, 180 }, { 65, 250 }, { 200, 150 }, { 130, 60 } };
+  static const uint16_t MMOL_SETTINGS[][2] = { { 44, 100 }, { 35, 140 }, { 120, 100 }, { 80, 35 } };
+  BaselineAlerts state;
+  uint32_t app_vibes = 0;
+  int bg = 0;
+  int bg_top = 0;
+
+  for (uint8_t setting = 0; setting < ARRAY_LENGTH(MGDL_SETTINGS); setting++) {
+    default_thresholds();
+    set_thresholds(0, MGDL_SETTINGS[setting][0], MGDL_SETTINGS[setting][1]);
+    set_thresholds(1, MMOL_SETTINGS[setting][0], MMOL_SETTINGS[setting][1]);
+
+    for (uint8_t units = 0; units < BG_UNITS_COUNT; units++) {
+      bg_top = (units == BG_UNITS_MGDL) ? 420 : 240;
+      bg = bg_top / 3;
+      reset_alerts(&state);
+      app_vibes = 0;
+
+      for (uint32_t reading = 0; reading < WALK_READINGS; reading++) {
+        // mostly small steps, sometimes a jump anywhere
+        if (walk_random(10) == 0) {
+          bg = 1 + (int)walk_random((uint32_t)bg_top);
+        }
+        else {
+          bg += (int)walk_random(21) - 10;
+          bg = (bg < 1) ? 1 : ((bg > bg_top) ? bg_top : bg);
+        }
+
+        app_vibes += app_load_bg(units, bg);
+        baseline_load_bg(&state, units, bg);
+
+        CHECK(app_vibes == state.vibes, "vibes differ from the old code", units, bg);
+        CHECK(lastAlertTime == state.last_alert_time, "snooze differs from the old code", units, bg);
+        for (uint8_t band = 0; band < BG_BAND_COUNT; band++) {
+          CHECK(*BG_BAND_ALERTS[band].overwrite == state.overwrite[band], "overwrite flag differs from the old code", units, bg);
+        }
+
+        // minutes to the next reading, each one a tick of the snooze counter
+        for (uint32_t minute = 1 + walk_random(WALK_MINUTES_MAX); minute > 0; minute--) {
+          ++lastAlertTime;
+          ++state.last_alert_time;
+        }
+      }
+    }
+  }
+
+  default_thresholds();
+  set_thresholds(0, 80, 180);
+  set_thresholds(1, 44, 100);
+
+} // end func
+
+static uint64_t cpu_time_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+} // end func
+
+static void bench(void) {
+  volatile uint8_t sink = 0;
+  uint64_t start_ns = 0, cascade_ns = 0, table_ns = 0;
+  uint32_t calls = 0;
+
+  set_thresholds(0, 80, 180);
+
+  start_ns = cpu_time_ns();
+  for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+    for (int bg = BENCH_BG_BOTTOM; bg <= BENCH_BG_TOP; bg++) {
+      sink = cascade_bg_bands(BG_UNITS_MGDL, bg);
+    }
+  }
+  cascade_ns = cpu_time_ns() - start_ns;
+
+  start_ns = cpu_time_ns();
+  for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+    for (int bg = BENCH_BG_BOTTOM; bg <= BENCH_BG_TOP; bg++) {
+      sink = classify_bg_bands_cgm(BG_UNITS_MGDL, bg);
+    }
+  }
+  table_ns = cpu_time_ns() - start_ns;
+
+  (void)sink;
+  calls = BENCH_ROUNDS * (BENCH_BG_TOP - BENCH_BG_BOTTOM + 1);
+  printf("bands: cascade %.2f ns per BG, table %.2f ns per BG, %u BGs\n",
+    (double)cascade_ns / calls, (double)table_ns / calls, calls);
+} // end func
+
+int main(int argc, char **argv) {
+
+  init_cgm();
+
+  if ((argc > 1) && (strcmp(argv[1], "-b") == 0)) {
+    bench();
+    return 0;
+  }
+
+  test_default_edges();
+  test_units();
+  test_special_values();
+  test_load_values();
+  test_out_of_order();
+  test_against_cascade();
+  test_against_baseline();
+
+  printf("bands: %u checks, %u failed\n", checks, failures);
+  deinit_cgm();
+  return (failures == 0) ? 0 : 1;
+} // end main
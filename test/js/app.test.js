@@ -0,0 +1,313 @@
+// Tests for the phone side; run with: node --test test/js/
+
+"use strict";
+
+process.env.TZ = "UTC";
+
+var test = require("node:test"),
+    assert = require("node:assert"),
+    vm = require("node:vm"),
+    harness = require("./harness"),
+    nightscout = require("./nightscout_stub");
+
+var ENDPOINT = "http://nightscout.test/pebble",
+    CGM_STATUS_READING = 0,
+    CGM_STATUS_OFF = 3,
+    CGM_STATUS_SAME = 4,
+    CGM_DATA_TCGM = 8,
+    CGM_CACHE_TTL_MS = 10000,
+    CGM_HIST_CHUNK_MAX = 9,
+    CGM_HIST_ENTRIES = 7,
+    CGM_HIST_ENTRY_SIZE = 5;
+
+// app on a fake clock, Nightscout with three readings, the newest one a minute old
+function setup(faultOptions, appOptions) {
+    var clock = new harness.FakeClock(Date.UTC(2026, 0, 1, 12, 0, 0)),
+        data = new nightscout.NightscoutData({ startMs: clock.now() - 660000 }),
+        faults = new nightscout.Faults(faultOptions),
+        options = {
+          clock: clock,
+          transport: nightscout.scriptedTransport(clock, data, faults),
+          config: harness.makeConfig(ENDPOINT),
+          quiet: true
+        };
+
+    Object.keys(appOptions || {}).forEach(function (key) { options[key] = appOptions[key]; });
+    data.addReading();
+    data.addReading();
+    data.addReading();
+    return { clock: clock, data: data, faults: faults, app: harness.loadApp(options) };
+}
+
+function watchRequest(env, last) {
+    env.app.pebble.emit("appmessage", { payload: { cfgv: 1, last: last } });
+}
+
+function sentData(env) {
+    return env.app.pebble.sent.filter(function (sent) { return sent.message.data; }).map(function (sent) {
+      return sent.message.data;
+    });
+}
+
+function readUint32(bytes, offset) {
+    return (bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (bytes[offset + 3] << 24)) >>> 0;
+}
+
+function readUint16(bytes, offset) {
+    return bytes[offset] | (bytes[offset + 1] << 8);
+}
+
+// a history chunk back to entries with their times, the way the watch reads it
+function decodeHistory(bytes) {
+    var entries = [], time = readUint32(bytes, 3), entry = 0;
+
+    assert.strictEqual(bytes.length, CGM_HIST_ENTRIES + (bytes[2] * CGM_HIST_ENTRY_SIZE));
+    for (var i = 0; i < bytes[2]; i++) {
+      entry = CGM_HIST_ENTRIES + (i * CGM_HIST_ENTRY_SIZE);
+      time += readUint16(bytes, entry);
+      entries.push({ time: time, bg: (readUint16(bytes, entry + 2) << 16) >> 16, arrow: bytes[entry + 4] & 0x0F, noise: bytes[entry + 4] >> 4 });
+    }
+    return { firstDelta: readUint16(bytes, CGM_HIST_ENTRIES), entries: entries };
+}
+
+test("reading is encoded in the watch data layout", function () {
+    var env = setup(),
+        // arrays from the app context are from another realm; copy before comparing
+        bytes = Array.from(env.app.context.encodeReading({
+          flags: 1, arrow: 7, bg: 56, delta: -3, tcgm: 0x01020304, tapp: 0x05060708,
+          battery: 80, noise: 2, calcRaw: -2, rawUnfilt: 61, name: "Christine"
+        }));
+
+    assert.deepStrictEqual(bytes.slice(0, 4), [3, CGM_STATUS_READING, 1, 7]);
+    assert.deepStrictEqual(bytes.slice(4, 8), [56, 0, 0xFD, 0xFF]);
+    assert.strictEqual(readUint32(bytes, 8), 0x01020304);
+    assert.strictEqual(readUint32(bytes, 12), 0x05060708);
+    assert.deepStrictEqual(bytes.slice(16, 22), [80, 2, 0xFE, 0xFF, 61, 0]);
+    assert.strictEqual(bytes[22], 9);
+    assert.strictEqual(bytes.length, 23 + 9);
+});
+
+test("superseded queue entries are not reported as acked", function () {
+    var env = setup(),
+        queue = env.app.context.MessageQueue,
+        acks = [],
+        superseded = [];
+
+    queue.sendAppMessage({ data: [1] }, function () { acks.push(1); }, null, function () { superseded.push(1); });
+    queue.sendAppMessage({ hist: [2] });
+    queue.sendAppMessage({ data: [3] }, function () { acks.push(3); }, null, function () { superseded.push(3); });
+    env.clock.runAll();
+
+    assert.deepStrictEqual(acks, [3]);
+    assert.deepStrictEqual(superseded, [1]);
+    assert.deepStrictEqual(sentData(env), [[3]]);
+    assert.strictEqual(queue.stats().superseded, 1);
+    assert.strictEqual(queue.stats().acked, 2);
+});
+
+test("a message out of retries doesn't stall the queue", function () {
+    var sends = 0,
+        env = setup({}, { nackRate: 0.5, random: function () { return (sends++ < 5) ? 0 : 1; } }),
+        queue = env.app.context.MessageQueue,
+        nacks = 0;
+
+    queue.sendAppMessage({ data: [1] }, null, function () { nacks++; });
+    env.clock.tick(5);
+    queue.sendAppMessage({ vals: [2] });
+    env.clock.runAll();
+
+    assert.strictEqual(nacks, 1);
+    assert.strictEqual(queue.stats().failed, 1);
+    assert.deepStrictEqual(env.app.pebble.sent.pop().message, { vals: [2] });
+    assert.strictEqual(queue.size(), 0);
+});
+
+[
+  { name: "server error", faults: { failureRate: 1, failureStatus: 500 } },
+  { name: "not found", faults: { failureRate: 1, failureStatus: 404 } },
+  { name: "not modified without a cached answer", faults: { failureRate: 1, failureStatus: 304 } },
+  { name: "network error", faults: { dropRate: 1 } }
+].forEach(function (failure) {
+    test("fetch fails at once on " + failure.name, function () {
+      var env = setup(failure.faults);
+
+      watchRequest(env, 0);
+      env.clock.tick(1000);
+
+      assert.deepStrictEqual(sentData(env), [[3, CGM_STATUS_OFF]]);
+      assert.strictEqual(env.app.context.cgmFetch.pending, null);
+    });
+});
+
+test("watch requests during a fetch share it", function () {
+    var env = setup({ latencyMs: 500 });
+
+    watchRequest(env, 0);
+    env.clock.tick(100);
+    watchRequest(env, 0);
+    env.clock.runAll();
+
+    assert.strictEqual(env.faults.stats.requests, 1);
+    assert.strictEqual(env.app.context.cgmFetch.shared, 1);
+    assert.ok(sentData(env).length >= 1);
+});
+
+test("a config change sends a whole reading even if the watch has it", function () {
+    var env = setup(),
+        tcgm = 0,
+        data = null;
+
+    watchRequest(env, 0);
+    env.clock.runAll();
+    data = sentData(env).pop();
+    assert.strictEqual(data[1], CGM_STATUS_READING);
+    tcgm = readUint32(data, CGM_DATA_TCGM);
+
+    watchRequest(env, tcgm);
+    env.clock.runAll();
+    assert.strictEqual(sentData(env).pop()[1], CGM_STATUS_SAME);
+
+    env.app.pebble.emit("webviewclosed", {
+      response: encodeURIComponent(JSON.stringify(harness.makeConfig(ENDPOINT, { t1name: "Sam" })))
+    });
+    watchRequest(env, tcgm);
+    env.clock.runAll();
+    data = sentData(env).pop();
+    assert.strictEqual(data[1], CGM_STATUS_READING);
+    assert.strictEqual(String.fromCharCode.apply(null, data.slice(23)), "Sam");
+
+    watchRequest(env, tcgm);
+    env.clock.runAll();
+    assert.strictEqual(sentData(env).pop()[1], CGM_STATUS_SAME);
+});
+
+test("a 304 reuses the kept answer without parsing it and sends only the app time", function () {
+    var env = setup(),
+        context = env.app.context,
+        appJSON = vm.runInContext("JSON", context),
+        parse = appJSON.parse,
+        config = env.app.localStorage.getItem("cgmPebble"),
+        send = context.XMLHttpRequest.prototype.send,
+        requests = [],
+        parsed = [],
+        validated = null,
+        sentBefore = 0,
+        sent = null,
+        tcgm = 0;
+
+    // headers of every request, and every JSON.parse in the app but the one for its stored config
+    context.XMLHttpRequest.prototype.send = function () {
+      requests.push(this.requestHeaders);
+      return send.apply(this, arguments);
+    };
+    appJSON.parse = function (text) {
+      if (text !== config) { parsed.push(text); }
+      return parse.apply(appJSON, arguments);
+    };
+
+    // a fresh watch asks with history, a different url; then the plain reading, 200 with an ETag
+    watchRequest(env, 0);
+    env.clock.runAll();
+    tcgm = readUint32(sentData(env).pop(), CGM_DATA_TCGM);
+    env.clock.tick(CGM_CACHE_TTL_MS + 1000);
+    parsed = [];
+    watchRequest(env, tcgm);
+    env.clock.runAll();
+    validated = context.cgmFetch.validated;
+    assert.strictEqual(env.faults.stats.ok, 2);
+    assert.strictEqual(parsed.length, 1);
+    assert.ok(validated && validated.etag);
+
+    // past the short cache, so the same url goes out again, conditional on the ETag
+    env.clock.tick(CGM_CACHE_TTL_MS + 1000);
+    parsed = [];
+    sentBefore = env.app.pebble.sent.length;
+    watchRequest(env, tcgm);
+    env.clock.runAll();
+
+    assert.strictEqual(requests.length, 3);
+    assert.strictEqual(requests[1]["if-none-match"], undefined);
+    assert.strictEqual(requests[2]["if-none-match"], validated.etag);
+    assert.strictEqual(env.faults.stats.notModified, 1);
+    assert.strictEqual(context.cgmFetch.notModified, 1);
+    assert.deepStrictEqual(parsed, []);
+    assert.strictEqual(context.cgmFetch.validated, validated);
+    assert.strictEqual(context.cgmFetch.cache.response, validated.response);
+
+    sent = env.app.pebble.sent.slice(sentBefore);
+    assert.strictEqual(sent.length, 1);
+    assert.deepStrictEqual(Object.keys(sent[0].message), ["data"]);
+    assert.strictEqual(sent[0].message.data.length, 10);
+    assert.strictEqual(sent[0].message.data[1], CGM_STATUS_SAME);
+    assert.strictEqual(readUint32(sent[0].message.data, 2), tcgm);
+});
+
+test("history is chunked at CGM_HIST_CHUNK_MAX and on gaps too long for 16 bits", function () {
+    var env = setup(),
+        entries = [],
+        chunks = null,
+        time = 1767225600;
+
+    // 12 readings, a gap of 70000 s, 3 more
+    for (var i = 0; i < 15; i++) {
+      time += (i === 12) ? 70000 : 300;
+      entries.push({ time: time, bg: 100 + i, arrow: 4, noise: (i === 0) ? 20 : 1 });
+    }
+    chunks = Array.from(env.app.context.encodeHistory(entries, 1)).map(function (chunk) { return Array.from(chunk); });
+
+    assert.deepStrictEqual(chunks.map(function (chunk) { return chunk[2]; }), [CGM_HIST_CHUNK_MAX, 3, 3]);
+    chunks.forEach(function (chunk) {
+      assert.deepStrictEqual(chunk.slice(0, 2), [3, 1]);
+      // the first entry of every chunk is at the base time
+      assert.strictEqual(decodeHistory(chunk).firstDelta, 0);
+    });
+    assert.strictEqual(readUint32(chunks[2], 3), entries[12].time);
+    assert.deepStrictEqual([].concat.apply([], chunks.map(function (chunk) { return decodeHistory(chunk).entries; })),
+      entries.map(function (entry) {
+        return { time: entry.time, bg: entry.bg, arrow: entry.arrow, noise: Math.min(15, entry.noise) };
+      }));
+    assert.deepStrictEqual(Array.from(env.app.context.encodeHistory([], 0)), []);
+});
+
+test("readings the watch missed go out as history, oldest first, before the newest reading", function () {
+    var clock = new harness.FakeClock(Date.UTC(2026, 0, 1, 12, 0, 0)),
+        data = new nightscout.NightscoutData({ startMs: clock.now() - (22 * 3600000) }),
+        faults = new nightscout.Faults(),
+        env = null,
+        readings = [],
+        watchLast = 0,
+        sent = null,
+        hist = null,
+        missed = null;
+
+    // 8 readings, a 20 hour gap, 16 more, the newest a minute old
+    for (var i = 0; i < 8; i++) { readings.push(data.addReading()); }
+    data.nextTimeMs = clock.now() - 60000 - (15 * nightscout.READING_INTERVAL_MS);
+    for (i = 0; i < 16; i++) { readings.push(data.addReading()); }
+    env = {
+      clock: clock, data: data, faults: faults,
+      app: harness.loadApp({ clock: clock, transport: nightscout.scriptedTransport(clock, data, faults),
+        config: harness.makeConfig(ENDPOINT), quiet: true })
+    };
+
+    // the watch has the first 3; the rest but the newest are missed
+    watchLast = readings[2].datetime / 1000;
+    watchRequest(env, watchLast);
+    env.clock.runAll();
+
+    sent = env.app.pebble.sent.map(function (entry) { return entry.message; });
+    hist = sent.filter(function (message) { return message.hist; }).map(function (message) { return Array.from(message.hist); });
+    missed = readings.slice(3, 23);
+
+    // one chunk up to the gap, then full chunks
+    assert.deepStrictEqual(hist.map(function (chunk) { return chunk[2]; }), [5, CGM_HIST_CHUNK_MAX, 6]);
+    assert.deepStrictEqual([].concat.apply([], hist.map(function (chunk) {
+      return decodeHistory(chunk).entries.map(function (entry) { return [entry.time, entry.bg]; });
+    })), missed.map(function (reading) { return [reading.datetime / 1000, reading.mgdl]; }));
+
+    // every chunk before the reading, which is the newest one and the last message
+    assert.strictEqual(sent.length, hist.length + 1);
+    assert.ok(sent[sent.length - 1].data);
+    assert.strictEqual(sent[sent.length - 1].data[1], CGM_STATUS_READING);
+    assert.strictEqual(readUint32(sent[sent.length - 1].data, CGM_DATA_TCGM), readings[23].datetime / 1000);
+});
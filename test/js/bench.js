@@ -0,0 +1,231 @@
+// Benchmarks for the phone side; run with: node test/js/bench.js [parse] [fetch] [queue] [--option value]
+//
+//   parse  sendCgmData on a 36 reading answer, parse and encode only, no queue
+//   fetch  watch requests against the Nightscout stand-in over real HTTP; fetch-to-send and
+//          fetch-to-ack latency, HTTP requests per watch request, messages sent by key
+//   queue  MessageQueue under a burst of messages on a fake clock; sends, merges, drops, retries
+//
+// options: --iterations (parse), --requests, --interval, --latency, --jitter, --failure-rate,
+// --drop-rate, --ack-delay (fetch), --messages, --nack-rate (queue)
+//
+// fetch runs on real time, compressed: a watch request every --interval ms instead of every minute,
+// and the phone's answer cache lives for the same share of the interval as on the phone
+
+"use strict";
+
+process.env.TZ = "UTC";
+
+var harness = require("./harness"),
+    nightscout = require("./nightscout_stub");
+
+function parseArgs(argv) {
+    var args = { benches: [], options: {} };
+    for (var i = 0; i < argv.length; i++) {
+      if (argv[i].indexOf("--") === 0) {
+        args.options[argv[i].substring(2)] = Number(argv[++i]);
+      }
+      else {
+        args.benches.push(argv[i]);
+      }
+    }
+    if (!args.benches.length) { args.benches = ["parse", "fetch", "queue"]; }
+    return args;
+}
+
+function option(options, name, defaultValue) {
+    return (options[name] === undefined || isNaN(options[name])) ? defaultValue : options[name];
+}
+
+function countKeys(sent) {
+    var counts = {};
+    sent.forEach(function (entry) {
+      Object.keys(entry.message).forEach(function (key) { counts[key] = (counts[key] || 0) + 1; });
+    });
+    return counts;
+}
+
+function report(name, values) {
+    console.log(name + ": " + Object.keys(values).map(function (key) {
+      return key + " " + values[key];
+    }).join(", "));
+}
+
+// PARSE
+
+function benchParse(options, done) {
+    var iterations = option(options, "iterations", 5000),
+        data = new nightscout.NightscoutData(),
+        app = harness.loadApp({ quiet: true, config: harness.makeConfig("http://unused/pebble") }),
+        config = harness.makeConfig("http://unused/pebble"),
+        response = null,
+        queued = 0,
+        start = 0,
+        elapsedMs = 0;
+
+    for (var r = 0; r < 36; r++) { data.addReading(); }
+    response = data.response(36, Date.now());
+
+    // parse and encode only; the queue is measured on its own
+    app.context.MessageQueue = { sendAppMessage: function () { queued++; return true; } };
+    app.context.watchLastTcgm = Math.floor(response.bgs[12].datetime / 1000);
+
+    start = process.hrtime.bigint();
+    for (var i = 0; i < iterations; i++) {
+      app.context.sendCgmData(config, response, Date.now());
+    }
+    elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+
+    report("parse", {
+      iterations: iterations,
+      "us per answer": (elapsedMs * 1000 / iterations).toFixed(2),
+      "messages per answer": (queued / iterations).toFixed(1)
+    });
+    done();
+}
+
+// FETCH
+
+function benchFetch(options, done) {
+    var requests = option(options, "requests", 20),
+        interval = option(options, "interval", 1000),
+        data = new nightscout.NightscoutData({ startMs: Date.now() - 3600000 }),
+        faults = new nightscout.Faults({
+          latencyMs: option(options, "latency", 40),
+          jitterMs: option(options, "jitter", 20),
+          failureRate: option(options, "failure-rate", 0.05),
+          dropRate: option(options, "drop-rate", 0.02)
+        });
+
+    for (var r = 0; r < 12; r++) { data.addReading(); }
+
+    nightscout.startServer(data, faults, function (endpoint, server) {
+      var app = harness.loadApp({
+            quiet: true,
+            config: harness.makeConfig(endpoint),
+            ackDelayMs: option(options, "ack-delay", 30)
+          }),
+          pebble = app.pebble,
+          waiting = [],
+          toSend = [],
+          toAck = [],
+          lastTcgm = 0,
+          issued = 0;
+
+      app.context.CGM_CACHE_TTL_MS = Math.round(app.context.CGM_CACHE_TTL_MS * interval / 60000);
+
+      // a data message answers every watch request still waiting, superseded ones included;
+      // the newest reading the watch has comes from the data messages it got
+      var sendAppMessage = pebble.sendAppMessage;
+      pebble.sendAppMessage = function (message, ack, nack) {
+        var requests = message.data ? waiting.splice(0) : [];
+        if (message.data && (message.data[1] === 0)) {
+          lastTcgm = (message.data[8] | (message.data[9] << 8) | (message.data[10] << 16) | (message.data[11] << 24)) >>> 0;
+        }
+        requests.forEach(function (request) { toSend.push(Date.now() - request); });
+        sendAppMessage.call(pebble, message, function () {
+          requests.forEach(function (request) { toAck.push(Date.now() - request); });
+          if (ack) { ack.apply(null, arguments); }
+        }, nack);
+      };
+
+      function next() {
+        if (issued >= requests) {
+          setTimeout(finish, 1000);
+          return;
+        }
+        issued++;
+        // a new reading every 5 requests; now and then two requests at once, like a watch retry
+        if (issued % 5 === 0) { data.addReading(Date.now()); }
+        waiting.push(Date.now());
+        pebble.emit("appmessage", { payload: { cfgv: 1, last: lastTcgm } });
+        if (issued % 7 === 0) {
+          waiting.push(Date.now());
+          pebble.emit("appmessage", { payload: { cfgv: 1, last: lastTcgm } });
+        }
+        setTimeout(next, interval);
+      }
+
+      function finish() {
+        report("fetch", {
+          "watch requests": issued + Math.floor(issued / 7),
+          "http requests": faults.stats.requests,
+          "not modified": faults.stats.notModified,
+          "failed": faults.stats.failures + faults.stats.drops,
+          "cache hits": app.context.cgmFetch.hits,
+          "shared": app.context.cgmFetch.shared
+        });
+        report("fetch to send ms", {
+          p50: harness.percentile(toSend, 0.5),
+          p95: harness.percentile(toSend, 0.95),
+          max: harness.percentile(toSend, 1)
+        });
+        report("fetch to ack ms", {
+          p50: harness.percentile(toAck, 0.5),
+          p95: harness.percentile(toAck, 0.95),
+          max: harness.percentile(toAck, 1)
+        });
+        report("messages sent", countKeys(pebble.sent));
+        report("fetch queue", app.context.MessageQueue.stats());
+        server.closeAllConnections();
+        server.close(done);
+      }
+
+      next();
+    });
+}
+
+// QUEUE
+
+function benchQueue(options, done) {
+    var messages = option(options, "messages", 2000),
+        clock = new harness.FakeClock(0),
+        app = harness.loadApp({
+          quiet: true,
+          clock: clock,
+          ackDelayMs: 40,
+          nackRate: option(options, "nack-rate", 0.1),
+          random: harness.makeRandom(3)
+        }),
+        queue = app.context.MessageQueue,
+        maxQueue = 0,
+        start = process.hrtime.bigint(),
+        elapsedMs = 0;
+
+    // a reading, settings now and then, history chunks after a gap; faster than the watch acks
+    for (var i = 0; i < messages; i++) {
+      if (i % 50 === 10) {
+        for (var chunk = 0; chunk < 4; chunk++) { queue.sendAppMessage({ hist: [3, 0, 9, chunk] }); }
+      }
+      if (i % 20 === 0) { queue.sendAppMessage({ vals: [3, 0, i & 0xFF] }); }
+      queue.sendAppMessage({ data: [3, 0, i & 0xFF] });
+      maxQueue = Math.max(maxQueue, queue.size());
+      clock.tick(10);
+    }
+    clock.runAll();
+    elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+
+    report("queue", queue.stats());
+    report("queue load", {
+      "max queued": maxQueue,
+      "watch sends": app.pebble.sent.length,
+      "fake ms to drain": clock.now(),
+      "real ms": elapsedMs.toFixed(1)
+    });
+    done();
+}
+
+var BENCHES = { parse: benchParse, fetch: benchFetch, queue: benchQueue };
+
+(function run() {
+    var args = parseArgs(process.argv.slice(2));
+    (function nextBench() {
+      var name = args.benches.shift();
+      if (!name) { return; }
+      if (!BENCHES[name]) {
+        console.log("unknown benchmark: " + name);
+        process.exitCode = 1;
+        return;
+      }
+      BENCHES[name](args.options, nextBench);
+    })();
+})();
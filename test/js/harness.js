@@ -0,0 +1,305 @@
+// Loads src/js/pebble-js-app.js outside the phone app, with Pebble, XMLHttpRequest,
+// window.localStorage and the timers mocked. Top level variables of the app (watchLastTcgm,
+// MessageQueue, cgmFetch, ...) are properties of the returned context.
+//
+// Timers are either the real ones, or a fake clock that only moves when the caller ticks it;
+// tests and the stream recorder use the fake clock, the benchmarks the real one.
+
+"use strict";
+
+var fs = require("fs"),
+    http = require("http"),
+    path = require("path"),
+    vm = require("vm");
+
+var APP_PATH = path.join(__dirname, "..", "..", "src", "js", "pebble-js-app.js");
+
+// FAKE CLOCK
+
+function FakeClock(startMs) {
+    this.nowMs = startMs || 0;
+    this.nextId = 1;
+    this.timers = [];
+}
+
+FakeClock.prototype.now = function () {
+    return this.nowMs;
+};
+
+FakeClock.prototype.setTimeout = function (callback, delayMs) {
+    var timer = { id: this.nextId++, due: this.nowMs + Math.max(0, delayMs || 0), callback: callback };
+    this.timers.push(timer);
+    return timer.id;
+};
+
+FakeClock.prototype.clearTimeout = function (id) {
+    this.timers = this.timers.filter(function (timer) { return timer.id !== id; });
+};
+
+// run every timer due up to now + ms, in due order; timers they set are run too if due
+FakeClock.prototype.tick = function (ms) {
+    var until = this.nowMs + ms, timer = null;
+    for (;;) {
+      timer = this.nextDue(until);
+      if (!timer) { break; }
+      this.timers.splice(this.timers.indexOf(timer), 1);
+      this.nowMs = timer.due;
+      timer.callback();
+    }
+    this.nowMs = until;
+};
+
+// run until no timers are left, at most limitMs of fake time
+FakeClock.prototype.runAll = function (limitMs) {
+    var until = this.nowMs + (limitMs || 3600000), timer = null;
+    for (;;) {
+      timer = this.nextDue(until);
+      if (!timer) { break; }
+      this.timers.splice(this.timers.indexOf(timer), 1);
+      this.nowMs = timer.due;
+      timer.callback();
+    }
+};
+
+FakeClock.prototype.nextDue = function (until) {
+    var next = null;
+    this.timers.forEach(function (timer) {
+      if ( (timer.due <= until) && ((next === null) || (timer.due < next.due)) ) { next = timer; }
+    });
+    return next;
+};
+
+// Date for the app context that reads the fake clock
+FakeClock.prototype.makeDate = function () {
+    var clock = this, RealDate = Date;
+    function FakeDate() {
+      var args = Array.prototype.slice.call(arguments);
+      if (!args.length) { args = [clock.now()]; }
+      return new (Function.prototype.bind.apply(RealDate, [null].concat(args)))();
+    }
+    FakeDate.prototype = RealDate.prototype;
+    FakeDate.now = function () { return clock.now(); };
+    FakeDate.parse = RealDate.parse;
+    FakeDate.UTC = RealDate.UTC;
+    return FakeDate;
+};
+
+// PEBBLE
+
+// records every app message; the watch acks each one after ackDelayMs, or nacks it at nackRate
+function MockPebble(timers, options) {
+    this.timers = timers;
+    this.ackDelayMs = (options.ackDelayMs === undefined) ? 20 : options.ackDelayMs;
+    this.nackRate = options.nackRate || 0;
+    this.random = options.random || Math.random;
+    this.handlers = {};
+    this.sent = [];
+    this.acks = 0;
+    this.nacks = 0;
+    this.urls = [];
+}
+
+MockPebble.prototype.addEventListener = function (name, handler) {
+    (this.handlers[name] = this.handlers[name] || []).push(handler);
+};
+
+MockPebble.prototype.emit = function (name, e) {
+    (this.handlers[name] || []).forEach(function (handler) { handler(e || {}); });
+};
+
+MockPebble.prototype.sendAppMessage = function (message, ack, nack) {
+    var pebble = this, nacked = (this.random() < this.nackRate);
+    this.sent.push({ time: this.timers.now(), message: JSON.parse(JSON.stringify(message)) });
+    this.timers.setTimeout(function () {
+      if (nacked) {
+        pebble.nacks++;
+        if (nack) { nack({ data: { transactionId: pebble.sent.length } }, "nack"); }
+      }
+      else {
+        pebble.acks++;
+        if (ack) { ack({ data: { transactionId: pebble.sent.length } }); }
+      }
+    }, this.ackDelayMs);
+};
+
+MockPebble.prototype.openURL = function (url) {
+    this.urls.push(url);
+};
+
+function MockLocalStorage() {
+    this.items = {};
+}
+
+MockLocalStorage.prototype.getItem = function (key) {
+    return Object.prototype.hasOwnProperty.call(this.items, key) ? this.items[key] : null;
+};
+
+MockLocalStorage.prototype.setItem = function (key, value) {
+    this.items[key] = String(value);
+};
+
+MockLocalStorage.prototype.removeItem = function (key) {
+    delete this.items[key];
+};
+
+// XMLHTTPREQUEST
+
+// transport(request, respond) answers a request; respond({ status, headers, body }) for a response,
+// respond(null) for a network error; it is never called for an aborted request
+function makeXMLHttpRequest(transport) {
+    function MockXMLHttpRequest() {
+      this.readyState = 0;
+      this.status = 0;
+      this.responseText = "";
+      this.requestHeaders = {};
+      this.responseHeaders = {};
+      this.aborted = false;
+      this.onload = null;
+      this.onerror = null;
+    }
+
+    MockXMLHttpRequest.prototype.open = function (method, url) {
+      this.method = method;
+      this.url = url;
+      this.readyState = 1;
+    };
+
+    MockXMLHttpRequest.prototype.setRequestHeader = function (name, value) {
+      this.requestHeaders[name.toLowerCase()] = value;
+    };
+
+    MockXMLHttpRequest.prototype.getResponseHeader = function (name) {
+      var value = this.responseHeaders[name.toLowerCase()];
+      return (value === undefined) ? null : value;
+    };
+
+    MockXMLHttpRequest.prototype.abort = function () {
+      this.aborted = true;
+      if (this.cancel) { this.cancel(); }
+    };
+
+    MockXMLHttpRequest.prototype.send = function () {
+      var req = this;
+      req.cancel = transport(req, function (response) {
+        if (req.aborted) { return; }
+        req.readyState = 4;
+        if (response === null) {
+          if (req.onerror) { req.onerror({}); }
+          return;
+        }
+        req.status = response.status;
+        req.responseText = response.body || "";
+        Object.keys(response.headers || {}).forEach(function (name) {
+          req.responseHeaders[name.toLowerCase()] = response.headers[name];
+        });
+        if (req.onload) { req.onload({}); }
+      });
+    };
+
+    return MockXMLHttpRequest;
+}
+
+// real HTTP, for the Nightscout stand-in in nightscout_stub.js
+function httpTransport(req, respond) {
+    var request = http.get(req.url, { headers: req.requestHeaders }, function (res) {
+      var body = "";
+      res.setEncoding("utf8");
+      res.on("data", function (chunk) { body += chunk; });
+      res.on("end", function () { respond({ status: res.statusCode, headers: res.headers, body: body }); });
+    });
+    request.on("error", function () { respond(null); });
+    return function () { request.destroy(); };
+}
+
+// LOADER
+
+// options: clock (FakeClock, or real timers if not set), transport (default real HTTP),
+// ackDelayMs / nackRate / random for the watch, config (stored as the phone config), quiet
+function loadApp(options) {
+    options = options || {};
+
+    var clock = options.clock || null,
+        timers = clock || {
+          now: Date.now,
+          setTimeout: function (callback, delayMs) { return setTimeout(callback, delayMs); }
+        },
+        pebble = new MockPebble(timers, options),
+        localStorage = new MockLocalStorage(),
+        logs = [],
+        context = null;
+
+    if (options.config) {
+      localStorage.setItem("cgmPebble", JSON.stringify(options.config));
+    }
+
+    context = {
+      Pebble: pebble,
+      window: { localStorage: localStorage },
+      XMLHttpRequest: makeXMLHttpRequest(options.transport || httpTransport),
+      console: {
+        log: function () {
+          var line = Array.prototype.join.call(arguments, " ");
+          logs.push(line);
+          if (!options.quiet) { console.log(line); }
+        }
+      },
+      setTimeout: clock ? clock.setTimeout.bind(clock) : setTimeout,
+      clearTimeout: clock ? clock.clearTimeout.bind(clock) : clearTimeout,
+      setInterval: setInterval
+    };
+    if (clock) {
+      context.Date = clock.makeDate();
+    }
+
+    vm.createContext(context);
+    vm.runInContext(fs.readFileSync(APP_PATH, "utf8"), context, { filename: APP_PATH });
+
+    return { context: context, pebble: pebble, localStorage: localStorage, clock: clock, logs: logs };
+}
+
+// same config the config page stores; mg/dL, Nightscout at endpoint
+function makeConfig(endpoint, overrides) {
+    var config = {
+      endpoint: endpoint,
+      radio: "mgdl_form",
+      lowbg: "80",
+      highbg: "180",
+      lowsnooze: "15",
+      highsnooze: "30",
+      lowvibe: "2",
+      highvibe: "1",
+      vibepattern: "2",
+      timeformat: "12",
+      rawvibrate: "0",
+      t1name: "Christine"
+    };
+    Object.keys(overrides || {}).forEach(function (key) { config[key] = overrides[key]; });
+    return config;
+}
+
+// small seeded generator, so failure injection and test data repeat run to run
+function makeRandom(seed) {
+    var state = (seed || 1) >>> 0;
+    return function () {
+      state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+      return state / 4294967296;
+    };
+}
+
+function percentile(values, fraction) {
+    var sorted = values.slice().sort(function (a, b) { return a - b; });
+    if (!sorted.length) { return 0; }
+    return sorted[Math.min(sorted.length - 1, Math.floor(fraction * sorted.length))];
+}
+
+module.exports = {
+    FakeClock: FakeClock,
+    MockPebble: MockPebble,
+    MockLocalStorage: MockLocalStorage,
+    makeXMLHttpRequest: makeXMLHttpRequest,
+    httpTransport: httpTransport,
+    loadApp: loadApp,
+    makeConfig: makeConfig,
+    makeRandom: makeRandom,
+    percentile: percentile
+};
@@ -0,0 +1,166 @@
+// Local stand-in for the Nightscout /pebble endpoint, with latency and failure injection.
+// The same readings can be served over real HTTP (benchmarks) or answered on a fake clock
+// through the harness transport (tests, stream recorder).
+
+"use strict";
+
+var http = require("http"),
+    harness = require("./harness");
+
+var READING_INTERVAL_MS = 300000,
+    MGDL_PER_MMOL = 18.018;
+
+// READINGS
+
+// a reading every 5 minutes; BG swings between lows and highs so every alert band gets hit
+function NightscoutData(options) {
+    options = options || {};
+    this.units = options.units || "mgdl";
+    this.name = options.name || "Christine";
+    this.random = harness.makeRandom(options.seed || 7);
+    this.readings = [];
+    this.nextTimeMs = options.startMs || Date.UTC(2026, 0, 1, 0, 0, 0);
+}
+
+NightscoutData.prototype.curveMgdl = function (timeMs) {
+    var hours = timeMs / 3600000;
+    return Math.round(140 + (110 * Math.sin(hours * Math.PI / 3)) + (25 * Math.sin(hours * Math.PI * 1.7)) +
+      ((this.random() - 0.5) * 6));
+};
+
+NightscoutData.prototype.direction = function (deltaMgdl) {
+    if (deltaMgdl >= 15) { return "DoubleUp"; }
+    if (deltaMgdl >= 10) { return "SingleUp"; }
+    if (deltaMgdl >= 5) { return "FortyFiveUp"; }
+    if (deltaMgdl > -5) { return "Flat"; }
+    if (deltaMgdl > -10) { return "FortyFiveDown"; }
+    if (deltaMgdl > -15) { return "SingleDown"; }
+    return "DoubleDown";
+};
+
+// next reading, or the reading at timeMs; sgv can be forced for special values (mg/dL)
+NightscoutData.prototype.addReading = function (timeMs, sgvMgdl) {
+    var datetime = (timeMs === undefined) ? this.nextTimeMs : timeMs,
+        last = this.readings[0],
+        mgdl = (sgvMgdl === undefined) ? Math.max(39, Math.min(401, this.curveMgdl(datetime))) : sgvMgdl,
+        delta = last ? (mgdl - last.mgdl) : 0,
+        mmol = (this.units == "mmol");
+
+    this.readings.unshift({
+      mgdl: mgdl,
+      sgv: mmol ? (mgdl / MGDL_PER_MMOL).toFixed(1) : String(mgdl),
+      bgdelta: mmol ? Number((delta / MGDL_PER_MMOL).toFixed(1)) : delta,
+      direction: (mgdl < 40 || mgdl > 400) ? "NOT COMPUTABLE" : this.direction(delta),
+      datetime: datetime,
+      battery: String(Math.max(5, 100 - Math.floor(this.readings.length / 12))),
+      noise: 1,
+      filtered: (mgdl + 3) * 1000,
+      unfiltered: (mgdl + 5) * 1000
+    });
+    this.nextTimeMs = datetime + READING_INTERVAL_MS;
+    return this.readings[0];
+};
+
+NightscoutData.prototype.response = function (count, nowMs) {
+    return {
+      status: [{ now: nowMs }],
+      bgs: this.readings.slice(0, Math.max(1, count)).map(function (reading) {
+        return {
+          sgv: reading.sgv,
+          bgdelta: reading.bgdelta,
+          trend: 0,
+          direction: reading.direction,
+          datetime: reading.datetime,
+          battery: reading.battery,
+          noise: reading.noise,
+          filtered: reading.filtered,
+          unfiltered: reading.unfiltered
+        };
+      }),
+      cals: [{ slope: 1000, intercept: 0, scale: 1 }]
+    };
+};
+
+// ANSWERS
+
+// faults: failureRate (answered with failureStatus), dropRate (connection reset, no answer)
+function Faults(options) {
+    options = options || {};
+    this.failureRate = options.failureRate || 0;
+    this.failureStatus = options.failureStatus || 500;
+    this.dropRate = options.dropRate || 0;
+    this.latencyMs = options.latencyMs || 0;
+    this.jitterMs = options.jitterMs || 0;
+    this.random = harness.makeRandom(options.seed || 11);
+    this.stats = { requests: 0, ok: 0, notModified: 0, failures: 0, drops: 0 };
+}
+
+Faults.prototype.delayMs = function () {
+    return this.latencyMs + Math.round(this.random() * this.jitterMs);
+};
+
+// null is a dropped connection
+function answer(data, faults, url, headers, nowMs) {
+    var count = Number((/[?&]count=(\d+)/.exec(url) || [0, 1])[1]),
+        newest = data.readings[0],
+        etag = "\"" + (newest ? newest.datetime : 0) + "-" + count + "\"",
+        roll = faults.random();
+
+    faults.stats.requests++;
+    if (roll < faults.dropRate) {
+      faults.stats.drops++;
+      return null;
+    }
+    if (roll < faults.dropRate + faults.failureRate) {
+      faults.stats.failures++;
+      return { status: faults.failureStatus, headers: {}, body: "" };
+    }
+    if (headers["if-none-match"] === etag) {
+      faults.stats.notModified++;
+      return { status: 304, headers: { ETag: etag }, body: "" };
+    }
+    faults.stats.ok++;
+    return {
+      status: 200,
+      headers: { "Content-Type": "application/json", ETag: etag },
+      body: JSON.stringify(data.response(count, nowMs))
+    };
+}
+
+// for harness.loadApp with a fake clock; answers after the injected latency on that clock
+function scriptedTransport(clock, data, faults) {
+    return function (req, respond) {
+      var id = clock.setTimeout(function () {
+        respond(answer(data, faults, req.url, req.requestHeaders, clock.now()));
+      }, faults.delayMs());
+      return function () { clock.clearTimeout(id); };
+    };
+}
+
+// real HTTP server on a free local port; calls back with the endpoint url
+function startServer(data, faults, callback) {
+    var server = http.createServer(function (req, res) {
+      setTimeout(function () {
+        var response = answer(data, faults, req.url, req.headers, Date.now());
+        if (response === null) {
+          req.socket.destroy();
+          return;
+        }
+        res.writeHead(response.status, response.headers);
+        res.end(response.body);
+      }, faults.delayMs());
+    });
+    server.listen(0, "127.0.0.1", function () {
+      callback("http://127.0.0.1:" + server.address().port + "/pebble", server);
+    });
+    return server;
+}
+
+module.exports = {
+    READING_INTERVAL_MS: READING_INTERVAL_MS,
+    NightscoutData: NightscoutData,
+    Faults: Faults,
+    answer: answer,
+    scriptedTransport: scriptedTransport,
+    startServer: startServer
+};
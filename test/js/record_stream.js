@@ -0,0 +1,86 @@
+// Records the messages the phone sends to the watch, for the watch side replay in test/host;
+// run with: node test/js/record_stream.js [--minutes n] [--mmol 1] [--failure-rate r] [--gap-at m --gap n]
+//
+// The watch asks for a reading every minute and the Nightscout stand-in gets a new one every
+// 5 minutes, all on a fake clock. --gap-at / --gap leave the watch out of touch for n minutes
+// from minute m, so it misses readings and gets them as history. One line per message:
+//
+//   <unix seconds> JS send message: {"data":[...]}
+//
+// which is the phone log line with the send time in front; the replay reads both.
+
+"use strict";
+
+process.env.TZ = "UTC";
+
+var harness = require("./harness"),
+    nightscout = require("./nightscout_stub");
+
+var ENDPOINT = "http://nightscout.test/pebble",
+    MINUTE_MS = 60000;
+
+function parseArgs(argv) {
+    var options = {};
+    for (var i = 0; i < argv.length; i += 2) {
+      options[argv[i].replace(/^--/, "")] = Number(argv[i + 1]);
+    }
+    return options;
+}
+
+function option(options, name, defaultValue) {
+    return (options[name] === undefined || isNaN(options[name])) ? defaultValue : options[name];
+}
+
+(function record() {
+    var options = parseArgs(process.argv.slice(2)),
+        minutes = option(options, "minutes", 180),
+        mmol = (option(options, "mmol", 0) !== 0),
+        gapAt = option(options, "gap-at", -1),
+        gap = option(options, "gap", 0),
+        clock = new harness.FakeClock(Date.UTC(2026, 0, 1, 6, 0, 0)),
+        data = new nightscout.NightscoutData({
+          units: mmol ? "mmol" : "mgdl",
+          startMs: clock.now() - (12 * nightscout.READING_INTERVAL_MS)
+        }),
+        faults = new nightscout.Faults({
+          latencyMs: 40,
+          jitterMs: 20,
+          failureRate: option(options, "failure-rate", 0)
+        }),
+        config = harness.makeConfig(ENDPOINT, mmol ? { radio: "mmol_form", lowbg: "44", highbg: "100" } : {}),
+        app = null,
+        cfgv = 0,
+        last = 0;
+
+    for (var r = 0; r < 12; r++) { data.addReading(); }
+
+    app = harness.loadApp({
+      clock: clock,
+      transport: nightscout.scriptedTransport(clock, data, faults),
+      config: config,
+      quiet: true
+    });
+
+    // print every message as the watch gets it; keep the newest reading time like the watch does
+    var sendAppMessage = app.pebble.sendAppMessage;
+    app.pebble.sendAppMessage = function (message, ack, nack) {
+      var bytes = message.data;
+      if (bytes && (bytes[1] === 0)) {
+        last = (bytes[8] | (bytes[9] << 8) | (bytes[10] << 16) | (bytes[11] << 24)) >>> 0;
+      }
+      if (message.vals) {
+        cfgv = app.context.getCfgVersion();
+      }
+      console.log(Math.floor(clock.now() / 1000) + " JS send message: " + JSON.stringify(message));
+      sendAppMessage.call(app.pebble, message, ack, nack);
+    };
+
+    for (var minute = 0; minute < minutes; minute++) {
+      if ( (minute > 0) && (minute % 5 === 0) ) { data.addReading(clock.now()); }
+      if ( (minute < gapAt) || (minute >= gapAt + gap) ) {
+        app.pebble.emit("appmessage", { payload: { cfgv: cfgv, last: last } });
+      }
+      clock.tick(MINUTE_MS);
+    }
+    clock.runAll();
+})();
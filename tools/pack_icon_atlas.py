@@ -0,0 +1,115 @@
+#!/usr/bin/env python
+#
+# Packs the watchface icons into one atlas image so the watch can decode
+# a single resource and hand out sub bitmaps for every icon.
+#
+# Run from the project root after adding or changing an icon:
+#   python tools/pack_icon_atlas.py
+#
+# Writes resources/images/iconatlas.png and src/icon_atlas.h
+# Needs the Python Imaging Library (pip install pillow)
+#
+
+import os.path
+from PIL import Image
+
+IMAGE_DIR = 'resources/images'
+ATLAS_PNG = os.path.join(IMAGE_DIR, 'iconatlas.png')
+ATLAS_HEADER = os.path.join('src', 'icon_atlas.h')
+
+# white gutter between icons so dithering in the resource build can't bleed
+GUTTER = 1
+
+# ORDER IS THE ICON INDEX ON THE WATCH; ADD NEW ICONS AT THE END
+ICONS = [
+    ('ICON_SPECVALUE_NONE', 'specvaluenone.png'),
+    ('ICON_UPUP', 'upup.png'),
+    ('ICON_UP', 'up.png'),
+    ('ICON_UP45', 'up45.png'),
+    ('ICON_FLAT', 'flat.png'),
+    ('ICON_DOWN45', 'down45.png'),
+    ('ICON_DOWN', 'down.png'),
+    ('ICON_DOWNDOWN', 'downdown.png'),
+    ('ICON_LOGO', 'logo.png'),
+    ('ICON_BROKEN_ANTENNA', 'brokenantenna.png'),
+    ('ICON_BLOOD_DROP', 'blooddrop.png'),
+    ('ICON_STOP_LIGHT', 'stoplight.png'),
+    ('ICON_HOURGLASS', 'hourglass.png'),
+    ('ICON_QUESTION_MARKS', 'questionmarks.png'),
+    ('ICON_RCVRNONE', 'rcvrnone.png'),
+    ('ICON_RCVRON', 'rcvron.png'),
+    ('ICON_RCVROFF', 'rcvroff.png'),
+    ('ICON_CLUB100', 'club100.png'),
+    ('ICON_CLUB55', 'club55.png'),
+]
+
+
+def shelf_pack(images, width, sort_key):
+    # fill rows left to right in sort_key order
+    order = sorted(range(len(images)), key=lambda i: sort_key(images[i].size))
+    rects = [None] * len(images)
+    x = y = shelf_height = 0
+    for i in order:
+        w, h = images[i].size
+        if x + w > width:
+            x = 0
+            y += shelf_height + GUTTER
+            shelf_height = 0
+        rects[i] = (x, y, w, h)
+        x += w + GUTTER
+        shelf_height = max(shelf_height, h)
+    return rects, y + shelf_height
+
+
+def decoded_bytes(width, height):
+    # 1 bit per pixel, rows padded to 32 bits on the watch
+    return ((width + 31) // 32) * 4 * height
+
+
+def main():
+    images = [Image.open(os.path.join(IMAGE_DIR, f)).convert('RGB') for _, f in ICONS]
+    widest = max(im.size[0] for im in images)
+
+    # pick the atlas width and packing order that decode to the fewest bytes
+    sort_keys = [
+        lambda size: (-size[1], -size[0]),  # tallest first
+        lambda size: (-size[0], -size[1]),  # widest first
+        lambda size: -(size[0] * size[1]),  # biggest first
+    ]
+    best = None
+    for width in range(32 * ((widest + 31) // 32), 288, 32):
+        for sort_key in sort_keys:
+            rects, height = shelf_pack(images, width, sort_key)
+            size = decoded_bytes(width, height)
+            if best is None or size < best[0]:
+                best = (size, width, height, rects)
+    size, width, height, rects = best
+
+    atlas = Image.new('RGB', (width, height), (255, 255, 255))
+    for im, (x, y, _, _) in zip(images, rects):
+        atlas.paste(im, (x, y))
+    atlas.save(ATLAS_PNG)
+
+    separate = sum(decoded_bytes(*im.size) for im in images)
+
+    with open(ATLAS_HEADER, 'w') as out:
+        out.write('#pragma once\n\n')
+        out.write('// GENERATED BY tools/pack_icon_atlas.py; DO NOT EDIT BY HAND\n')
+        out.write('// ATLAS %ix%i, DECODED %i BYTES; ALL ICONS DECODED SEPARATELY %i BYTES\n\n'
+                  % (width, height, size, separate))
+        out.write('enum IconAtlasIndex {\n')
+        for indx, (name, _) in enumerate(ICONS):
+            out.write('  %s = %i,\n' % (name, indx))
+        out.write('  ICON_ATLAS_COUNT = %i\n' % len(ICONS))
+        out.write('};\n\n')
+        out.write('// POSITION OF EACH ICON IN RESOURCE_ID_IMAGE_ICON_ATLAS\n')
+        out.write('static const GRect ICON_ATLAS_RECTS[] = {\n')
+        for (name, _), (x, y, w, h) in zip(ICONS, rects):
+            out.write('  { { %i, %i }, { %i, %i } },  // %s\n' % (x, y, w, h, name))
+        out.write('};\n')
+
+    print('atlas %ix%i, %i bytes decoded (separately: %i bytes)' % (width, height, size, separate))
+
+
+if __name__ == '__main__':
+    main()